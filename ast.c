@@ -23,7 +23,9 @@ typedef enum {
     AST_ARRAY_ACCESS,
     AST_IMPORT,
     AST_INCREMENT,
-    AST_DECREMENT
+    AST_DECREMENT,
+    AST_PARALLEL_LOOP,
+    AST_REDUCE
 } ASTNodeType;
 
 typedef struct ASTNode {
@@ -34,8 +36,28 @@ typedef struct ASTNode {
     struct ASTNode **children;
     int child_count;
     int capacity;
+    int line;
+    const char *file;
+    int site;           // primer contador de --profile-generate, o -1; en una
+                        // funcion, cuantos tiene (pgo.c)
+    unsigned int checksum; // funcion: forma para el perfil (pgo.c)
+    long long count;    // ejecuciones segun --profile-use, o -1
 } ASTNode;
 
+// Posicion que reciben los nodos nuevos: el parser la actualiza con cada
+// token (un hilo por modulo, de ahi __thread)
+__thread int ast_line;
+__thread const char *ast_file;
+
+int ast_count_nodes(ASTNode *node) {
+    if (!node) return 0;
+    int count = 1 + ast_count_nodes(node->left) + ast_count_nodes(node->right);
+    for (int i = 0; i < node->child_count; i++) {
+        count += ast_count_nodes(node->children[i]);
+    }
+    return count;
+}
+
 ASTNode* ast_create_node(ASTNodeType type, char *value) {
     ASTNode *node = (ASTNode*)malloc(sizeof(ASTNode));
     node->type = type;
@@ -46,6 +68,11 @@ ASTNode* ast_create_node(ASTNodeType type, char *value) {
     node->children = NULL;
     node->child_count = 0;
     node->capacity = 0;
+    node->line = ast_line;
+    node->file = ast_file;
+    node->site = -1;
+    node->checksum = 0;
+    node->count = -1;
     return node;
 }
 
@@ -57,3 +84,19 @@ void ast_add_child(ASTNode *parent, ASTNode *child) {
     }
     parent->children[parent->child_count++] = child;
 }
+
+// Copia profunda (el desenrollado de bucles duplica cuerpos)
+ASTNode* ast_clone(ASTNode *node) {
+    if (!node) return NULL;
+    ASTNode *copy = (ASTNode*)malloc(sizeof(ASTNode));
+    *copy = *node;
+    copy->left = ast_clone(node->left);
+    copy->right = ast_clone(node->right);
+    copy->children = NULL;
+    copy->capacity = 0;
+    copy->child_count = 0;
+    for (int i = 0; i < node->child_count; i++) {
+        ast_add_child(copy, ast_clone(node->children[i]));
+    }
+    return copy;
+}
@@ -0,0 +1,88 @@
+#!/bin/sh
+# Benchmark del compilador: genera programas con bench/gen, los compila con
+# "b asm --time-report=json" y mide lineas por segundo y memoria por linea.
+# Compara con bench/baseline.txt y falla si alguna medida empeora mas de
+# BENCH_TOLERANCE por ciento.
+#
+#   sh bench/compile_bench.sh                    medir y comparar
+#   sh bench/compile_bench.sh --update-baseline  medir y guardar la base
+#
+# Variables: BENCH_SIZES ("1000 10000"), BENCH_RUNS (3, se queda con la
+# mejor), BENCH_TOLERANCE (15).
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+B=$ROOT/b
+GEN=$ROOT/bench/gen
+OUT=$ROOT/bench/out
+BASELINE=$ROOT/bench/baseline.txt
+SHAPES="expr funcs locals strings imports"
+SIZES=${BENCH_SIZES:-"1000 10000"}
+RUNS=${BENCH_RUNS:-3}
+TOLERANCE=${BENCH_TOLERANCE:-15}
+
+mkdir -p "$OUT"
+RESULTS=$OUT/results.txt
+: > "$RESULTS"
+
+# Extrae un campo numerico de la fila "total" del informe JSON
+field() {
+    grep '"phase": "total"' "$1" | sed "s/.*\"$2\": \([0-9.]*\).*/\1/"
+}
+
+printf "%-8s %7s %8s %10s %12s %10s %11s\n" shape size lines "wall ms" "lines/s" "rss KiB" "bytes/line"
+for shape in $SHAPES; do
+    for size in $SIZES; do
+        dir=$OUT/$shape-$size
+        rm -rf "$dir"
+        mkdir -p "$dir"
+        "$GEN" "$shape" "$size" "$dir"
+        lines=$(cat "$dir"/*.b | wc -l)
+
+        best=""
+        rss=""
+        run=0
+        while [ $run -lt "$RUNS" ]; do
+            (cd "$dir" && "$B" asm main.b --time-report=json > /dev/null 2> report.json)
+            wall=$(field "$dir/report.json" wall_ms)
+            if [ -z "$best" ] || awk "BEGIN { exit !($wall < $best) }"; then
+                best=$wall
+                rss=$(field "$dir/report.json" peak_rss_kb)
+            fi
+            run=$((run + 1))
+        done
+
+        awk -v shape="$shape" -v size="$size" -v lines="$lines" -v wall="$best" -v rss="$rss" 'BEGIN {
+            printf "%-8s %7d %8d %10.1f %12.0f %10d %11.0f\n", shape, size, lines, wall,
+                   lines * 1000 / wall, rss, rss * 1024 / lines
+        }' | tee -a "$RESULTS"
+    done
+done
+
+if [ "$1" = "--update-baseline" ]; then
+    cp "$RESULTS" "$BASELINE"
+    echo "Baseline saved to bench/baseline.txt"
+    exit 0
+fi
+
+if [ ! -f "$BASELINE" ]; then
+    echo "No baseline yet: run 'make bench-baseline' to record one"
+    exit 0
+fi
+
+# Compara lineas/s y bytes/linea con la base para cada (shape, size)
+echo
+awk -v tolerance="$TOLERANCE" '
+    NR == FNR { speed[$1 " " $2] = $5; memory[$1 " " $2] = $7; next }
+    !(($1 " " $2) in speed) { next }
+    {
+        key = $1 " " $2
+        dspeed = ($5 - speed[key]) * 100 / speed[key]
+        dmemory = ($7 - memory[key]) * 100 / memory[key]
+        status = "ok"
+        if (dspeed < -tolerance || dmemory > tolerance) { status = "REGRESSION"; failed = 1 }
+        printf "%-8s %7d  lines/s %+7.1f%%  bytes/line %+7.1f%%  %s\n", $1, $2, dspeed, dmemory, status
+    }
+    END { exit failed }
+' "$BASELINE" "$RESULTS"
@@ -0,0 +1,162 @@
+// ==================== BENCH GENERATOR ====================
+// Genera programas B sinteticos de tamaño escalable para medir el
+// compilador: gen <shape> <size> <dir> escribe <dir>/main.b (y los modulos
+// que importe). Las formas estresan partes distintas del compilador:
+//   expr     expresiones profundamente anidadas
+//   funcs    muchas funciones pequeñas
+//   locals   funciones con muchas variables locales
+//   strings  literales largos, la mitad repetidos
+//   imports  un grafo de imports ancho y profundo
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EXPR_DEPTH 24
+#define LOCALS_PER_FUNC 90
+#define STRING_LENGTH 200
+#define FUNCS_PER_MODULE 8
+
+FILE* open_output(const char *dir, const char *name) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "gen: could not create %s\n", path);
+        exit(1);
+    }
+    return out;
+}
+
+void gen_expr(FILE *out, int size) {
+    fprintf(out, "func main() {\n");
+    fprintf(out, "    int x = 1\n");
+    for (int i = 0; i < size; i++) {
+        fprintf(out, "    x = ");
+        for (int d = 0; d < EXPR_DEPTH; d++) fprintf(out, "(");
+        fprintf(out, "x");
+        for (int d = 0; d < EXPR_DEPTH; d++) {
+            fprintf(out, " %s %d)", d % 3 == 0 ? "+" : d % 3 == 1 ? "*" : "-", d % 7 + 1);
+        }
+        fprintf(out, " %% 1000003\n");
+    }
+    fprintf(out, "    print(x, \"\\n\")\n");
+    fprintf(out, "}\n");
+}
+
+void gen_funcs(FILE *out, int size) {
+    for (int i = 0; i < size; i++) {
+        fprintf(out, "func f%d(int a, int b) {\n", i);
+        fprintf(out, "    int c = a * %d + b\n", i % 13 + 1);
+        fprintf(out, "    if (c > %d) {\n", i % 100);
+        fprintf(out, "        c = c - a\n");
+        fprintf(out, "    }\n");
+        fprintf(out, "    return c\n");
+        fprintf(out, "}\n");
+    }
+    fprintf(out, "func main() {\n");
+    fprintf(out, "    int t = 0\n");
+    for (int i = 0; i < size; i += size / 64 + 1) {
+        fprintf(out, "    t = t + f%d(t, %d)\n", i, i);
+    }
+    fprintf(out, "    print(t, \"\\n\")\n");
+    fprintf(out, "}\n");
+}
+
+void gen_locals(FILE *out, int size) {
+    int funcs = size / LOCALS_PER_FUNC + 1;
+    for (int f = 0; f < funcs; f++) {
+        fprintf(out, "func l%d(int seed) {\n", f);
+        fprintf(out, "    int v0 = seed\n");
+        for (int i = 1; i < LOCALS_PER_FUNC; i++) {
+            fprintf(out, "    int v%d = v%d + %d\n", i, i - 1, i);
+        }
+        fprintf(out, "    return v%d\n", LOCALS_PER_FUNC - 1);
+        fprintf(out, "}\n");
+    }
+    fprintf(out, "func main() {\n");
+    fprintf(out, "    int t = 0\n");
+    for (int f = 0; f < funcs; f++) {
+        fprintf(out, "    t = t + l%d(%d)\n", f, f);
+    }
+    fprintf(out, "    print(t, \"\\n\")\n");
+    fprintf(out, "}\n");
+}
+
+void gen_strings(FILE *out, int size) {
+    char literal[STRING_LENGTH + 1];
+    int funcs = size / LOCALS_PER_FUNC + 1;
+    for (int i = 0; i < funcs * LOCALS_PER_FUNC; i++) {
+        if (i % LOCALS_PER_FUNC == 0) fprintf(out, "func s%d() {\n", i / LOCALS_PER_FUNC);
+        // La mitad de los literales se repiten: ejercita la deduplicacion
+        int id = i % 2 == 0 ? i : i / 2;
+        for (int c = 0; c < STRING_LENGTH; c++) {
+            literal[c] = 'a' + (id * 7 + c * 13) % 26;
+        }
+        literal[STRING_LENGTH] = '\0';
+        fprintf(out, "    string v%d = \"%s\"\n", i % LOCALS_PER_FUNC, literal);
+        if (i % LOCALS_PER_FUNC == LOCALS_PER_FUNC - 1) fprintf(out, "    return 0\n}\n");
+    }
+    fprintf(out, "func main() {\n");
+    for (int f = 0; f < funcs; f++) fprintf(out, "    s%d()\n", f);
+    fprintf(out, "}\n");
+}
+
+// Cada modulo importa a sus dos hijos en un arbol binario, y ademas a un
+// modulo compartido, asi que hay caminos repetidos que deben deduplicarse
+void gen_imports(const char *dir, int size) {
+    int modules = size / (FUNCS_PER_MODULE * 5) + 1;
+    for (int m = 0; m < modules; m++) {
+        char name[64];
+        snprintf(name, sizeof(name), "m%d.b", m);
+        FILE *out = open_output(dir, name);
+        if (2 * m + 1 < modules) fprintf(out, "import \"m%d.b\"\n", 2 * m + 1);
+        if (2 * m + 2 < modules) fprintf(out, "import \"m%d.b\"\n", 2 * m + 2);
+        if (m != modules - 1) fprintf(out, "import \"m%d.b\"\n", modules - 1);
+        for (int f = 0; f < FUNCS_PER_MODULE; f++) {
+            fprintf(out, "func m%d_f%d(int x) {\n", m, f);
+            fprintf(out, "    int y = x * %d\n", f + 2);
+            fprintf(out, "    return y + %d\n", m);
+            fprintf(out, "}\n");
+        }
+        fclose(out);
+    }
+
+    FILE *out = open_output(dir, "main.b");
+    fprintf(out, "import \"m0.b\"\n");
+    fprintf(out, "func main() {\n");
+    fprintf(out, "    int t = 0\n");
+    for (int m = 0; m < modules; m += modules / 32 + 1) {
+        fprintf(out, "    t = t + m%d_f0(%d)\n", m, m);
+    }
+    fprintf(out, "    print(t, \"\\n\")\n");
+    fprintf(out, "}\n");
+    fclose(out);
+}
+
+int main(int argc, char **argv) {
+    if (argc != 4) {
+        fprintf(stderr, "usage: gen <expr|funcs|locals|strings|imports> <size> <dir>\n");
+        return 1;
+    }
+    const char *shape = argv[1];
+    int size = atoi(argv[2]);
+    const char *dir = argv[3];
+
+    if (strcmp(shape, "imports") == 0) {
+        gen_imports(dir, size);
+        return 0;
+    }
+
+    FILE *out = open_output(dir, "main.b");
+    if (strcmp(shape, "expr") == 0) gen_expr(out, size);
+    else if (strcmp(shape, "funcs") == 0) gen_funcs(out, size);
+    else if (strcmp(shape, "locals") == 0) gen_locals(out, size);
+    else if (strcmp(shape, "strings") == 0) gen_strings(out, size);
+    else {
+        fprintf(stderr, "gen: unknown shape %s\n", shape);
+        return 1;
+    }
+    fclose(out);
+    return 0;
+}
@@ -0,0 +1,10 @@
+func fib(int n) {
+    if n < 2 {
+        return n
+    }
+    return fib(n - 1) + fib(n - 2)
+}
+
+func main() {
+    print(fib(32), "\n")
+}
@@ -0,0 +1,11 @@
+#include <stdio.h>
+
+long fib(long n) {
+    if (n < 2) return n;
+    return fib(n - 1) + fib(n - 2);
+}
+
+int main() {
+    printf("%ld\n", fib(32));
+    return 0;
+}
@@ -0,0 +1,38 @@
+func main() {
+    int n = 64
+    int a[4096]
+    int b[4096]
+    int c[4096]
+    int i = 0
+    loop i < n * n {
+        a[i] = i % 7
+        b[i] = i % 5
+        i++
+    }
+    int round = 0
+    loop round < 20 {
+        i = 0
+        loop i < n {
+            int j = 0
+            loop j < n {
+                int sum = 0
+                int k = 0
+                loop k < n {
+                    sum = sum + a[i * n + k] * b[k * n + j]
+                    k++
+                }
+                c[i * n + j] = sum
+                j++
+            }
+            i++
+        }
+        round++
+    }
+    int trace = 0
+    i = 0
+    loop i < n {
+        trace = trace + c[i * n + i]
+        i++
+    }
+    print(trace, "\n")
+}
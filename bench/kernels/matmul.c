@@ -0,0 +1,26 @@
+#include <stdio.h>
+
+#define N 64
+
+long a[N * N], b[N * N], c[N * N];
+
+int main() {
+    long n = N;
+    for (long i = 0; i < n * n; i++) {
+        a[i] = i % 7;
+        b[i] = i % 5;
+    }
+    for (int round = 0; round < 20; round++) {
+        for (long i = 0; i < n; i++) {
+            for (long j = 0; j < n; j++) {
+                long sum = 0;
+                for (long k = 0; k < n; k++) sum += a[i * n + k] * b[k * n + j];
+                c[i * n + j] = sum;
+            }
+        }
+    }
+    long trace = 0;
+    for (long i = 0; i < n; i++) trace += c[i * n + i];
+    printf("%ld\n", trace);
+    return 0;
+}
@@ -0,0 +1,9 @@
+func main() {
+    int sum = 0
+    int lines = 0
+    loop eof() == 0 {
+        sum = sum + str_to_int(read_line())
+        lines++
+    }
+    print(lines, " ", sum, "\n")
+}
@@ -0,0 +1,13 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+int main() {
+    char line[256];
+    long sum = 0, lines = 0;
+    while (fgets(line, sizeof(line), stdin)) {
+        sum += strtol(line, NULL, 10);
+        lines++;
+    }
+    printf("%ld %ld\n", lines, sum);
+    return 0;
+}
@@ -0,0 +1,7 @@
+func main() {
+    int i = 0
+    loop i < 300000 {
+        print("line ", i, "\n")
+        i++
+    }
+}
@@ -0,0 +1,6 @@
+#include <stdio.h>
+
+int main() {
+    for (long i = 0; i < 300000; i++) printf("line %ld\n", i);
+    return 0;
+}
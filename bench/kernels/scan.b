@@ -0,0 +1,14 @@
+func main() {
+    int text = read_all()
+    int count = 0
+    int i = 0
+    int c = byte_at(text, 0)
+    loop c != 0 {
+        if c == 101 {
+            count++
+        }
+        i++
+        c = byte_at(text, i)
+    }
+    print(i, " ", count, "\n")
+}
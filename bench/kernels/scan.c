@@ -0,0 +1,18 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+int main() {
+    size_t cap = 1 << 20, len = 0, n;
+    char *text = malloc(cap + 1);
+    while ((n = fread(text + len, 1, cap - len, stdin)) > 0) {
+        len += n;
+        if (len == cap) text = realloc(text, (cap *= 2) + 1);
+    }
+    text[len] = 0;
+    long count = 0, i = 0;
+    for (; text[i]; i++) {
+        if (text[i] == 'e') count++;
+    }
+    printf("%ld %ld\n", i, count);
+    return 0;
+}
@@ -0,0 +1,28 @@
+func main() {
+    int n = 400000
+    int composite[400000]
+    int count = 0
+    int round = 0
+    loop round < 10 {
+        int i = 0
+        loop i < n {
+            composite[i] = 0
+            i++
+        }
+        count = 0
+        i = 2
+        loop i < n {
+            if composite[i] == 0 {
+                count++
+                int j = i * i
+                loop j < n {
+                    composite[j] = 1
+                    j = j + i
+                }
+            }
+            i++
+        }
+        round++
+    }
+    print(count, "\n")
+}
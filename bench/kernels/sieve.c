@@ -0,0 +1,20 @@
+#include <stdio.h>
+
+long composite[400000];
+
+int main() {
+    long n = 400000;
+    long count = 0;
+    for (int round = 0; round < 10; round++) {
+        for (long i = 0; i < n; i++) composite[i] = 0;
+        count = 0;
+        for (long i = 2; i < n; i++) {
+            if (composite[i] == 0) {
+                count++;
+                for (long j = i * i; j < n; j += i) composite[j] = 1;
+            }
+        }
+    }
+    printf("%ld\n", count);
+    return 0;
+}
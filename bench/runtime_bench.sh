@@ -0,0 +1,63 @@
+#!/bin/sh
+# Benchmark del codigo generado: compila cada kernel de bench/kernels con b
+# y su equivalente en C con gcc -O0 y -O2, comprueba que las salidas
+# coinciden y mide cada binario con bench/perfrun (mediana de BENCH_RUNS
+# ejecuciones; instrucciones y syscalls cuando perf_event_open lo permite).
+#
+#   sh bench/runtime_bench.sh [kernel...]
+
+set -e
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+B=$ROOT/b
+PERFRUN=$ROOT/bench/perfrun
+KERNELS=$ROOT/bench/kernels
+OUT=$ROOT/bench/out/runtime
+RUNS=${BENCH_RUNS:-5}
+CC=${CC:-gcc}
+
+mkdir -p "$OUT"
+
+# Entradas de los kernels que leen stdin
+seq 1 300000 > "$OUT/parse.in"
+: > "$OUT/scan.in"
+i=0
+while [ $i -lt 40 ]; do
+    cat "$ROOT"/*.c >> "$OUT/scan.in"
+    i=$((i + 1))
+done
+
+input() {
+    if [ -f "$OUT/$1.in" ]; then echo "$OUT/$1.in"; else echo "-"; fi
+}
+
+kernels=${*:-"fib sieve matmul scan print parse"}
+
+printf "%-7s %9s %13s %8s | %9s %9s | %7s %7s\n" kernel "b ms" "b instrs" "b sys" "C-O0 ms" "C-O2 ms" "b/O0" "b/O2"
+for k in $kernels; do
+    dir=$OUT/$k
+    mkdir -p "$dir"
+    (cd "$dir" && "$B" compile "$KERNELS/$k.b" > compile.log) || {
+        echo "$k: b compile failed (see $dir/compile.log)"
+        exit 1
+    }
+    $CC -O0 -o "$dir/c_O0" "$KERNELS/$k.c"
+    $CC -O2 -o "$dir/c_O2" "$KERNELS/$k.c"
+
+    in=$(input "$k")
+    "$PERFRUN" 1 "$in" "$dir/b.out" "$dir/program" > /dev/null
+    "$PERFRUN" 1 "$in" "$dir/c.out" "$dir/c_O2" > /dev/null
+    if ! cmp -s "$dir/b.out" "$dir/c.out"; then
+        echo "$k: output differs from C (see $dir/b.out and $dir/c.out)"
+        exit 1
+    fi
+
+    set -- $("$PERFRUN" "$RUNS" "$in" /dev/null "$dir/program")
+    b_ms=$1; b_instr=$2; b_sys=$3
+    c0_ms=$("$PERFRUN" "$RUNS" "$in" /dev/null "$dir/c_O0" | cut -d' ' -f1)
+    c2_ms=$("$PERFRUN" "$RUNS" "$in" /dev/null "$dir/c_O2" | cut -d' ' -f1)
+
+    awk -v k="$k" -v b="$b_ms" -v bi="$b_instr" -v bs="$b_sys" -v c0="$c0_ms" -v c2="$c2_ms" 'BEGIN {
+        printf "%-7s %9.2f %13s %8s | %9.2f %9.2f | %6.2fx %6.2fx\n", k, b, bi, bs, c0, c2, b / c0, b / c2
+    }'
+done
@@ -1,27 +1,231 @@
+// ==================== STRING POOL ====================
+// Los literales se guardan una sola vez (tabla hash FNV-1a) y se emiten al
+// final en .rodata como str.N; un literal que es sufijo de otro se define
+// con equ dentro del mayor. La tabla se comparte entre los hilos de
+// codegen, protegida por un mutex.
+
+typedef struct {
+    char **values;
+    int count;
+    int capacity;
+    int *buckets;
+    int bucket_count;
+    pthread_mutex_t lock;
+} StringPool;
+
+unsigned int string_hash(const char *value) {
+    unsigned int hash = 2166136261u;
+    while (*value) {
+        hash ^= (unsigned char)*value++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+StringPool* string_pool_create() {
+    StringPool *pool = (StringPool*)malloc(sizeof(StringPool));
+    pool->values = NULL;
+    pool->count = 0;
+    pool->capacity = 0;
+    pool->bucket_count = 64;
+    pool->buckets = (int*)calloc(pool->bucket_count, sizeof(int));
+    pthread_mutex_init(&pool->lock, NULL);
+    return pool;
+}
+
+void string_pool_rehash(StringPool *pool) {
+    free(pool->buckets);
+    pool->bucket_count *= 2;
+    pool->buckets = (int*)calloc(pool->bucket_count, sizeof(int));
+    for (int i = 0; i < pool->count; i++) {
+        unsigned int slot = string_hash(pool->values[i]) & (pool->bucket_count - 1);
+        while (pool->buckets[slot]) slot = (slot + 1) & (pool->bucket_count - 1);
+        pool->buckets[slot] = i + 1;
+    }
+}
+
+int string_pool_intern(StringPool *pool, const char *value) {
+    pthread_mutex_lock(&pool->lock);
+    unsigned int slot = string_hash(value) & (pool->bucket_count - 1);
+    while (pool->buckets[slot]) {
+        int index = pool->buckets[slot] - 1;
+        if (strcmp(pool->values[index], value) == 0) {
+            pthread_mutex_unlock(&pool->lock);
+            return index;
+        }
+        slot = (slot + 1) & (pool->bucket_count - 1);
+    }
+
+    if (pool->count >= pool->capacity) {
+        pool->capacity = pool->capacity == 0 ? 16 : pool->capacity * 2;
+        pool->values = (char**)realloc(pool->values, pool->capacity * sizeof(char*));
+    }
+    pool->values[pool->count] = strdup(value);
+    pool->buckets[slot] = ++pool->count;
+
+    if (pool->count * 2 > pool->bucket_count) string_pool_rehash(pool);
+    int index = pool->count - 1;
+    pthread_mutex_unlock(&pool->lock);
+    return index;
+}
+
+int string_pool_find(StringPool *pool, const char *value) {
+    unsigned int slot = string_hash(value) & (pool->bucket_count - 1);
+    while (pool->buckets[slot]) {
+        int index = pool->buckets[slot] - 1;
+        if (strcmp(pool->values[index], value) == 0) return index;
+        slot = (slot + 1) & (pool->bucket_count - 1);
+    }
+    return -1;
+}
+
+void string_pool_free(StringPool *pool) {
+    for (int i = 0; i < pool->count; i++) free(pool->values[i]);
+    free(pool->values);
+    free(pool->buckets);
+    pthread_mutex_destroy(&pool->lock);
+    free(pool);
+}
+
+// Compara dos literales leidos desde el final
+int string_compare_reversed(const char *a, const char *b) {
+    int i = strlen(a) - 1;
+    int j = strlen(b) - 1;
+    while (i >= 0 && j >= 0) {
+        if (a[i] != b[j]) return (unsigned char)a[i] - (unsigned char)b[j];
+        i--;
+        j--;
+    }
+    return (i >= 0) - (j >= 0);
+}
+
+StringPool *string_sort_pool;
+
+int string_sort_reversed(const void *a, const void *b) {
+    return string_compare_reversed(string_sort_pool->values[*(const int*)a],
+                                   string_sort_pool->values[*(const int*)b]);
+}
+
+int string_is_suffix(const char *suffix, const char *value) {
+    int a = strlen(suffix);
+    int b = strlen(value);
+    return a <= b && strcmp(value + b - a, suffix) == 0;
+}
+
+void string_pool_emit(StringPool *pool, FILE *output) {
+    if (pool->count == 0) return;
+
+    // Ordenados por su reverso, un sufijo queda justo antes de un literal
+    // que lo contiene.
+    int *order = (int*)malloc(pool->count * sizeof(int));
+    int *owner = (int*)malloc(pool->count * sizeof(int));
+    int *offset = (int*)malloc(pool->count * sizeof(int));
+    for (int i = 0; i < pool->count; i++) order[i] = i;
+    string_sort_pool = pool;
+    qsort(order, pool->count, sizeof(int), string_sort_reversed);
+
+    for (int i = pool->count - 1; i >= 0; i--) {
+        int id = order[i];
+        owner[id] = id;
+        offset[id] = 0;
+        if (i + 1 < pool->count) {
+            int next = order[i + 1];
+            if (string_is_suffix(pool->values[id], pool->values[next])) {
+                owner[id] = owner[next];
+                offset[id] = offset[next] + strlen(pool->values[next]) - strlen(pool->values[id]);
+            }
+        }
+    }
+
+    fprintf(output, "\nsection .rodata\n");
+    for (int id = 0; id < pool->count; id++) {
+        if (owner[id] != id) continue;
+        fprintf(output, "str.%d: db ", id);
+        for (const char *s = pool->values[id]; *s; s++) {
+            fprintf(output, "%d, ", (unsigned char)*s);
+        }
+        fprintf(output, "0\n");
+    }
+    for (int id = 0; id < pool->count; id++) {
+        if (owner[id] == id) continue;
+        fprintf(output, "str.%d equ str.%d + %d\n", id, owner[id], offset[id]);
+    }
+
+    free(order);
+    free(owner);
+    free(offset);
+}
+
 // ==================== CODE GENERATOR ====================
 
+// Opciones de la linea de comandos que cambian el codigo generado
+typedef struct {
+    int profile;
+    char profile_path[PATH_MAX];
+    int pgo_generate;
+    char pgo_path[PATH_MAX];
+    int debug;
+    int optimize;
+    int threaded;       // el programa tiene parallel loops (tras el tree shaking)
+} CodegenOptions;
+
+CodegenOptions codegen_options;
+
+#define CODEGEN_MAX_VARS 100    // variables, arrays y parametros por funcion
+
 typedef struct {
     FILE *output;
     int label_count;
     int stack_offset;
-    char var_names[100][256];
-    int var_offsets[100];
-    char var_types[100][64];
+    int frame_size;
+    char var_names[CODEGEN_MAX_VARS][256];
+    int var_offsets[CODEGEN_MAX_VARS];
+    char var_types[CODEGEN_MAX_VARS][64];
+    int var_outer[CODEGEN_MAX_VARS];
     int var_count;
     int loop_start_labels[50];
     int loop_end_labels[50];
     int loop_depth;
-    int string_count;
-    int array_sizes[100];
+    StringPool *strings;
+    int array_sizes[CODEGEN_MAX_VARS];
+    char func_name[256];
+    int parallel_count;
+    int in_parallel;
+    int internal;         // la funcion respeta r10 y r11 (codegen_mark_internal)
+    char **deferred;
+    int deferred_count;
+    long instruction_count;
+    int profile_loops;
+    int pgo_counters;
+    unsigned int pgo_checksum;
+    const char *section;  // seccion del codigo que se esta generando
+    char *cold;           // ramas frias de la funcion, para .text.cold
+    size_t cold_size;
+    int line;
 } CodeGen;
 
 void codegen_init(CodeGen *gen, FILE *output) {
     gen->output = output;
     gen->label_count = 0;
     gen->stack_offset = 0;
+    gen->frame_size = 0;
     gen->var_count = 0;
     gen->loop_depth = 0;
-    gen->string_count = 0;
+    gen->strings = string_pool_create();
+    gen->func_name[0] = '\0';
+    gen->parallel_count = 0;
+    gen->in_parallel = 0;
+    gen->internal = 0;
+    gen->deferred = NULL;
+    gen->deferred_count = 0;
+    gen->instruction_count = 0;
+    gen->profile_loops = 0;
+    gen->pgo_counters = 0;
+    gen->pgo_checksum = 0;
+    gen->section = ".text";
+    gen->cold = NULL;
+    gen->cold_size = 0;
+    gen->line = 0;
 }
 
 int codegen_new_label(CodeGen *gen) {
@@ -30,63 +234,214 @@ int codegen_new_label(CodeGen *gen) {
 
 void codegen_emit(CodeGen *gen, const char *instruction) {
     fprintf(gen->output, "    %s\n", instruction);
+    gen->instruction_count++;
 }
 
 void codegen_emit_label(CodeGen *gen, const char *label) {
     fprintf(gen->output, "%s:\n", label);
 }
 
-int codegen_find_var(CodeGen *gen, const char *name) {
+// Con -g, nasm convierte cada %line en una fila de .debug_line: todo lo que
+// sigue hasta el proximo %line se atribuye a esa linea del fuente
+void codegen_source_line(CodeGen *gen, const char *file, int line) {
+    if (!codegen_options.debug || !file || line == gen->line) return;
+    fprintf(gen->output, "%%line %d+0 %s\n", line, file);
+    gen->line = line;
+}
+
+void codegen_line(CodeGen *gen, ASTNode *node) {
+    codegen_source_line(gen, node->file, node->line);
+}
+
+// Simbolo global de tipo funcion con su tamaño (hasta la etiqueta .end),
+// para que perf y gdb sepan a que funcion pertenece cada direccion
+void codegen_function_symbol(CodeGen *gen, const char *name) {
+    fprintf(gen->output, "global %s:function (%s.end - %s)\n", name, name, name);
+    codegen_emit_label(gen, name);
+}
+
+int codegen_find_var_index(CodeGen *gen, const char *name) {
     for (int i = gen->var_count - 1; i >= 0; i--) {
         if (strcmp(gen->var_names[i], name) == 0) {
-            return gen->var_offsets[i];
+            return i;
         }
     }
     return -1;
 }
 
-const char* codegen_find_var_type(CodeGen *gen, const char *name) {
-    for (int i = gen->var_count - 1; i >= 0; i--) {
-        if (strcmp(gen->var_names[i], name) == 0) {
-            return gen->var_types[i];
-        }
-    }
-    return NULL;
+// Escribe en addr la direccion de la variable ("rbp-8"); las variables del
+// marco padre dentro de un cuerpo paralelo se acceden via r12.
+int codegen_find_var_address(CodeGen *gen, const char *name, char *addr) {
+    int index = codegen_find_var_index(gen, name);
+    if (index == -1) return 0;
+    sprintf(addr, "%s-%d", gen->var_outer[index] ? "r12" : "rbp", gen->var_offsets[index]);
+    return 1;
 }
 
-void codegen_add_var(CodeGen *gen, const char *name) {
-    gen->stack_offset += 8;
-    strcpy(gen->var_names[gen->var_count], name);
-    gen->var_offsets[gen->var_count] = gen->stack_offset;
-    gen->array_sizes[gen->var_count] = 1;
-    strcpy(gen->var_types[gen->var_count], "int");
-    gen->var_count++;
+const char* codegen_find_var_type(CodeGen *gen, const char *name) {
+    int index = codegen_find_var_index(gen, name);
+    return index != -1 ? gen->var_types[index] : NULL;
 }
 
-void codegen_add_var_typed(CodeGen *gen, const char *name, const char *type) {
-    if (strcmp(type, "string") == 0) {
-        gen->stack_offset += 256;
-    } else {
-        gen->stack_offset += 8;
+void codegen_push_var(CodeGen *gen, const char *name, const char *type, int bytes, int size) {
+    if (gen->var_count >= CODEGEN_MAX_VARS) {
+        error("Too many variables in function %s (max %d)", gen->func_name, CODEGEN_MAX_VARS);
     }
+    gen->stack_offset += bytes;
+    if (gen->stack_offset > gen->frame_size) gen->frame_size = gen->stack_offset;
     strcpy(gen->var_names[gen->var_count], name);
     gen->var_offsets[gen->var_count] = gen->stack_offset;
-    gen->array_sizes[gen->var_count] = 1;
+    gen->array_sizes[gen->var_count] = size;
+    gen->var_outer[gen->var_count] = 0;
     strcpy(gen->var_types[gen->var_count], type);
     gen->var_count++;
 }
 
+void codegen_add_var(CodeGen *gen, const char *name) {
+    codegen_push_var(gen, name, "int", 8, 1);
+}
+
+void codegen_add_var_typed(CodeGen *gen, const char *name, const char *type) {
+    codegen_push_var(gen, name, type, strcmp(type, "string") == 0 ? 256 : 8, 1);
+}
+
 void codegen_add_array(CodeGen *gen, const char *name, int size) {
-    gen->stack_offset += 8 * size;
-    strcpy(gen->var_names[gen->var_count], name);
-    gen->var_offsets[gen->var_count] = gen->stack_offset;
-    gen->array_sizes[gen->var_count] = size;
-    strcpy(gen->var_types[gen->var_count], "int");
-    gen->var_count++;
+    codegen_push_var(gen, name, "int", 8 * size, size);
+}
+
+// Antes de cada ret de una funcion con la convencion interna
+void codegen_internal_restore(CodeGen *gen) {
+    char buffer[64];
+    if (!gen->internal) return;
+    int offset = gen->var_offsets[codegen_find_var_index(gen, ".internal")];
+    sprintf(buffer, "mov r10, [rbp-%d]", offset);
+    codegen_emit(gen, buffer);
+    sprintf(buffer, "mov r11, [rbp-%d]", offset - 8);
+    codegen_emit(gen, buffer);
 }
 
 void codegen_expression(CodeGen *gen, ASTNode *node);
 void codegen_statement(CodeGen *gen, ASTNode *node);
+void codegen_parallel_loop(CodeGen *gen, ASTNode *node);
+void codegen_pgo_count(CodeGen *gen, int counter);
+void codegen_pgo_site(CodeGen *gen, ASTNode *node, int offset);
+
+int codegen_is_string(CodeGen *gen, ASTNode *node) {
+    if (node->type == AST_STRING) {
+        return 1;
+    }
+    if (node->type == AST_IDENTIFIER || node->type == AST_ARRAY_ACCESS) {
+        const char *var_type = codegen_find_var_type(gen, node->value);
+        return var_type && strcmp(var_type, "string") == 0;
+    }
+    if (node->type == AST_CALL) {
+        return strcmp(node->value, "input") == 0 ||
+               strcmp(node->value, "read_line") == 0 ||
+               strcmp(node->value, "read_all") == 0 ||
+               strcmp(node->value, "mmap_file") == 0;
+    }
+    return 0;
+}
+
+// mmap_file() da el mapeo entero: en un string se copiaria y cortaria a 255
+// bytes. Se guarda en un int y se lee con byte_at.
+void codegen_check_mmap(ASTNode *node, const char *name) {
+    if (node && node->type == AST_CALL && strcmp(node->value, "mmap_file") == 0) {
+        error("mmap_file() cannot be stored in string %s at line %d: keep it in an int and read it with byte_at()",
+              name, node->line);
+    }
+}
+
+void codegen_expect_args(ASTNode *node, int count) {
+    if (node->child_count != count) {
+        error("%s() expects %d argument(s), got %d", node->value, count, node->child_count);
+    }
+}
+
+// Deja en la pila la direccion de una variable int o de un elemento de array
+void codegen_address(CodeGen *gen, ASTNode *node) {
+    char buffer[512];
+    char addr[64];
+
+    if ((node->type != AST_IDENTIFIER && node->type != AST_ARRAY_ACCESS) ||
+        !codegen_find_var_address(gen, node->value, addr)) {
+        error("Expected a variable or array element as argument");
+    }
+    const char *var_type = codegen_find_var_type(gen, node->value);
+    if (strcmp(var_type, "string") == 0) {
+        error("Variable '%s' must be an int", node->value);
+    }
+
+    if (node->type == AST_ARRAY_ACCESS) {
+        codegen_expression(gen, node->left);
+        codegen_emit(gen, "pop rax");
+        sprintf(buffer, "lea r11, [%s]", addr);
+        codegen_emit(gen, buffer);
+        codegen_emit(gen, "lea rax, [r11 + rax*8]");
+    } else {
+        sprintf(buffer, "lea rax, [%s]", addr);
+        codegen_emit(gen, buffer);
+    }
+    codegen_emit(gen, "push rax");
+}
+
+// print(a, b, ...) arma un iovec en la pila con todos los argumentos y
+// lo escribe con un solo writev. Los literales apuntan a sus bytes con la
+// longitud conocida al compilar; los enteros se formatean en la pila.
+void codegen_print(CodeGen *gen, ASTNode *node) {
+    char buffer[512];
+    int count = node->child_count;
+    int ints = 0;
+
+    if (count == 0) {
+        codegen_emit(gen, "push 0");
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (!codegen_is_string(gen, node->children[i])) ints++;
+    }
+
+    int scratch = count * 16;
+    int area = (scratch + ints * 24 + 15) & ~15;
+    sprintf(buffer, "sub rsp, %d", area);
+    codegen_emit(gen, buffer);
+
+    int slot = 0;
+    for (int i = 0; i < count; i++) {
+        ASTNode *arg = node->children[i];
+        codegen_expression(gen, arg);
+
+        if (arg->type == AST_STRING) {
+            codegen_emit(gen, "pop rax");
+            sprintf(buffer, "mov qword [rsp + %d], %d", i * 16 + 8, (int)strlen(arg->value));
+            codegen_emit(gen, buffer);
+        } else if (codegen_is_string(gen, arg)) {
+            codegen_emit(gen, "pop rdi");
+            codegen_emit(gen, "call str_len");
+            sprintf(buffer, "mov [rsp + %d], rax", i * 16 + 8);
+            codegen_emit(gen, buffer);
+            codegen_emit(gen, "mov rax, rdi");
+        } else {
+            codegen_emit(gen, "pop rdi");
+            sprintf(buffer, "lea rsi, [rsp + %d]", scratch + ++slot * 24);
+            codegen_emit(gen, buffer);
+            codegen_emit(gen, "call format_int");
+            sprintf(buffer, "mov [rsp + %d], rdx", i * 16 + 8);
+            codegen_emit(gen, buffer);
+        }
+        sprintf(buffer, "mov [rsp + %d], rax", i * 16);
+        codegen_emit(gen, buffer);
+    }
+
+    codegen_emit(gen, "mov rdi, rsp");
+    sprintf(buffer, "mov rsi, %d", count);
+    codegen_emit(gen, buffer);
+    codegen_emit(gen, "call write_iov");
+    sprintf(buffer, "add rsp, %d", area);
+    codegen_emit(gen, buffer);
+    codegen_emit(gen, "push rax");
+}
 
 void codegen_expression(CodeGen *gen, ASTNode *node) {
     char buffer[512];
@@ -99,54 +454,25 @@ void codegen_expression(CodeGen *gen, ASTNode *node) {
     }
 
     if (node->type == AST_STRING) {
-        fprintf(gen->output, "section .data\n");
-        fprintf(gen->output, ".str%d: db ", gen->string_count);
-
-        // Escapar caracteres especiales para NASM
-        const char *s = node->value;
-        int first = 1;
-        while (*s) {
-            if (!first) fprintf(gen->output, ", ");
-            first = 0;
-
-            if (*s == '\n') {
-                fprintf(gen->output, "10");
-            } else if (*s == '\t') {
-                fprintf(gen->output, "9");
-            } else if (*s == '\r') {
-                fprintf(gen->output, "13");
-            } else if (*s == '"') {
-                fprintf(gen->output, "34");
-            } else if (*s == '\\') {
-                fprintf(gen->output, "92");
-            } else {
-                fprintf(gen->output, "%d", (unsigned char)*s);
-            }
-            s++;
-        }
-        fprintf(gen->output, ", 0\n");
-        fprintf(gen->output, "section .text\n");
-
-        sprintf(buffer, "lea rax, [rel .str%d]", gen->string_count);
-        gen->string_count++;
+        sprintf(buffer, "lea rax, [rel str.%d]", string_pool_intern(gen->strings, node->value));
         codegen_emit(gen, buffer);
         codegen_emit(gen, "push rax");
         return;
     }
 
     if (node->type == AST_ARRAY_ACCESS) {
-        int base_offset = codegen_find_var(gen, node->value);
-        if (base_offset != -1) {
+        char addr[64];
+        if (codegen_find_var_address(gen, node->value, addr)) {
             codegen_expression(gen, node->left);
             codegen_emit(gen, "pop rax");
 
             codegen_emit(gen, "imul rax, 8");
 
-            sprintf(buffer, "lea rbx, [rbp-%d]", base_offset);
+            sprintf(buffer, "lea r11, [%s]", addr);
             codegen_emit(gen, buffer);
-            codegen_emit(gen, "add rbx, rax");
+            codegen_emit(gen, "add r11, rax");
 
-            codegen_emit(gen, "mov rax, [rbx]");
+            codegen_emit(gen, "mov rax, [r11]");
             codegen_emit(gen, "push rax");
         } else {
             printf("Error: Array '%s' not found\n", node->value);
@@ -155,14 +481,14 @@ void codegen_expression(CodeGen *gen, ASTNode *node) {
     }
 
     if (node->type == AST_IDENTIFIER) {
-        int offset = codegen_find_var(gen, node->value);
-        if (offset != -1) {
+        char addr[64];
+        if (codegen_find_var_address(gen, node->value, addr)) {
             const char *var_type = codegen_find_var_type(gen, node->value);
             if (var_type && strcmp(var_type, "string") == 0) {
-                sprintf(buffer, "lea rax, [rbp-%d]", offset);
+                sprintf(buffer, "lea rax, [%s]", addr);
                 codegen_emit(gen, buffer);
             } else {
-                sprintf(buffer, "mov rax, [rbp-%d]", offset);
+                sprintf(buffer, "mov rax, [%s]", addr);
                 codegen_emit(gen, buffer);
             }
             codegen_emit(gen, "push rax");
@@ -193,60 +519,60 @@ void codegen_expression(CodeGen *gen, ASTNode *node) {
         codegen_expression(gen, node->left);
 
         codegen_emit(gen, "pop rax");
-        codegen_emit(gen, "pop rbx");
+        codegen_emit(gen, "pop r11");
 
         if (strcmp(node->value, "+") == 0) {
-            codegen_emit(gen, "add rax, rbx");
+            codegen_emit(gen, "add rax, r11");
             codegen_emit(gen, "push rax");
         } else if (strcmp(node->value, "-") == 0) {
-            codegen_emit(gen, "sub rax, rbx");
+            codegen_emit(gen, "sub rax, r11");
             codegen_emit(gen, "push rax");
         } else if (strcmp(node->value, "*") == 0) {
-            codegen_emit(gen, "imul rax, rbx");
+            codegen_emit(gen, "imul rax, r11");
             codegen_emit(gen, "push rax");
         } else if (strcmp(node->value, "/") == 0) {
             codegen_emit(gen, "xor rdx, rdx");
-            codegen_emit(gen, "idiv rbx");
+            codegen_emit(gen, "idiv r11");
             codegen_emit(gen, "push rax");
         } else if (strcmp(node->value, "%") == 0) {
             codegen_emit(gen, "xor rdx, rdx");
-            codegen_emit(gen, "idiv rbx");
+            codegen_emit(gen, "idiv r11");
             codegen_emit(gen, "push rdx");
         } else if (strcmp(node->value, "==") == 0) {
-            codegen_emit(gen, "cmp rax, rbx");
+            codegen_emit(gen, "cmp rax, r11");
             codegen_emit(gen, "sete al");
             codegen_emit(gen, "movzx rax, al");
             codegen_emit(gen, "push rax");
         } else if (strcmp(node->value, "!=") == 0) {
-            codegen_emit(gen, "cmp rax, rbx");
+            codegen_emit(gen, "cmp rax, r11");
             codegen_emit(gen, "setne al");
             codegen_emit(gen, "movzx rax, al");
             codegen_emit(gen, "push rax");
         } else if (strcmp(node->value, "<") == 0) {
-            codegen_emit(gen, "cmp rax, rbx");
+            codegen_emit(gen, "cmp rax, r11");
             codegen_emit(gen, "setl al");
             codegen_emit(gen, "movzx rax, al");
             codegen_emit(gen, "push rax");
         } else if (strcmp(node->value, ">") == 0) {
-            codegen_emit(gen, "cmp rax, rbx");
+            codegen_emit(gen, "cmp rax, r11");
             codegen_emit(gen, "setg al");
             codegen_emit(gen, "movzx rax, al");
             codegen_emit(gen, "push rax");
         } else if (strcmp(node->value, "<=") == 0) {
-            codegen_emit(gen, "cmp rax, rbx");
+            codegen_emit(gen, "cmp rax, r11");
             codegen_emit(gen, "setle al");
             codegen_emit(gen, "movzx rax, al");
             codegen_emit(gen, "push rax");
         } else if (strcmp(node->value, ">=") == 0) {
-            codegen_emit(gen, "cmp rax, rbx");
+            codegen_emit(gen, "cmp rax, r11");
             codegen_emit(gen, "setge al");
             codegen_emit(gen, "movzx rax, al");
             codegen_emit(gen, "push rax");
         } else if (strcmp(node->value, "&&") == 0) {
-            codegen_emit(gen, "and rax, rbx");
+            codegen_emit(gen, "and rax, r11");
             codegen_emit(gen, "push rax");
         } else if (strcmp(node->value, "||") == 0) {
-            codegen_emit(gen, "or rax, rbx");
+            codegen_emit(gen, "or rax, r11");
             codegen_emit(gen, "push rax");
         }
         return;
@@ -260,40 +586,19 @@ void codegen_expression(CodeGen *gen, ASTNode *node) {
             } else {
                 codegen_emit(gen, "mov rdi, 0");
             }
-            codegen_emit(gen, "mov rax, 60");
+            if (codegen_options.profile || codegen_options.pgo_generate) {
+                codegen_emit(gen, "push rdi");
+                if (codegen_options.profile) codegen_emit(gen, "call prof_dump");
+                if (codegen_options.pgo_generate) codegen_emit(gen, "call pgo_dump");
+                codegen_emit(gen, "pop rdi");
+            }
+            codegen_emit(gen, "mov rax, 231");
             codegen_emit(gen, "syscall");
             return;
         }
 
         if (strcmp(node->value, "print") == 0) {
-            for (int i = 0; i < node->child_count; i++) {
-                ASTNode *arg = node->children[i];
-                codegen_expression(gen, arg);
-                codegen_emit(gen, "pop rdi");
-
-                int is_string = 0;
-
-                if (arg->type == AST_STRING) {
-                    is_string = 1;
-                } else if (arg->type == AST_IDENTIFIER) {
-                    const char *var_type = codegen_find_var_type(gen, arg->value);
-                    if (var_type && strcmp(var_type, "string") == 0) {
-                        is_string = 1;
-                    }
-                } else if (arg->type == AST_ARRAY_ACCESS) {
-                    const char *var_type = codegen_find_var_type(gen, arg->value);
-                    if (var_type && strcmp(var_type, "string") == 0) {
-                        is_string = 1;
-                    }
-                }
-
-                if (is_string) {
-                    codegen_emit(gen, "call print_str_no_nl");
-                } else {
-                    codegen_emit(gen, "call print_no_nl");
-                }
-            }
-            codegen_emit(gen, "push rax");
+            codegen_print(gen, node);
             return;
         }
 
@@ -304,7 +609,18 @@ void codegen_expression(CodeGen *gen, ASTNode *node) {
                 codegen_emit(gen, "pop rdi");
                 codegen_emit(gen, "call print_str_no_nl");
             }
-            codegen_emit(gen, "call input");
+            codegen_emit(gen, "call read_line");
+            codegen_emit(gen, "push rax");
+            return;
+        }
+
+        if (strcmp(node->value, "read_line") == 0 ||
+            strcmp(node->value, "read_int") == 0 ||
+            strcmp(node->value, "read_all") == 0 ||
+            strcmp(node->value, "eof") == 0) {
+            codegen_expect_args(node, 0);
+            sprintf(buffer, "call %s", strcmp(node->value, "eof") == 0 ? "stdin_at_eof" : node->value);
+            codegen_emit(gen, buffer);
             codegen_emit(gen, "push rax");
             return;
         }
@@ -319,111 +635,633 @@ void codegen_expression(CodeGen *gen, ASTNode *node) {
             return;
         }
 
-        const char *arg_regs[] = {"rdi", "rsi", "rdx", "rcx", "r8", "r9"};
+        if (strcmp(node->value, "open") == 0) {
+            if (node->child_count < 1 || node->child_count > 3) {
+                error("open() expects 1 to 3 arguments, got %d", node->child_count);
+            }
+            for (int i = 0; i < node->child_count; i++) {
+                codegen_expression(gen, node->children[i]);
+            }
+            if (node->child_count < 2) codegen_emit(gen, "push 0");
+            if (node->child_count < 3) codegen_emit(gen, "push 420");
+            codegen_emit(gen, "pop rdx");
+            codegen_emit(gen, "pop rsi");
+            codegen_emit(gen, "pop rdi");
+            codegen_emit(gen, "mov rax, 2");
+            codegen_emit(gen, "syscall");
+            codegen_emit(gen, "push rax");
+            return;
+        }
 
-        for (int i = 0; i < node->child_count && i < 6; i++) {
-            codegen_expression(gen, node->children[i]);
-            codegen_emit(gen, "pop rax");
-            sprintf(buffer, "mov %s, rax", arg_regs[i]);
-            codegen_emit(gen, buffer);
+        if (strcmp(node->value, "close") == 0) {
+            codegen_expect_args(node, 1);
+            codegen_expression(gen, node->children[0]);
+            codegen_emit(gen, "pop rdi");
+            codegen_emit(gen, "mov rax, 3");
+            codegen_emit(gen, "syscall");
+            codegen_emit(gen, "push rax");
+            return;
         }
 
-        sprintf(buffer, "call %s", node->value);
-        codegen_emit(gen, buffer);
+        if (strcmp(node->value, "read") == 0 || strcmp(node->value, "write") == 0) {
+            codegen_expect_args(node, 3);
+            codegen_expression(gen, node->children[0]);
+            codegen_expression(gen, node->children[1]);
+            codegen_expression(gen, node->children[2]);
+            codegen_emit(gen, "pop rdx");
+            codegen_emit(gen, "pop rsi");
+            codegen_emit(gen, "pop rdi");
+            codegen_emit(gen, strcmp(node->value, "read") == 0 ? "mov rax, 0" : "mov rax, 1");
+            codegen_emit(gen, "syscall");
+            codegen_emit(gen, "push rax");
+            return;
+        }
 
-        codegen_emit(gen, "push rax");
-        return;
-    }
-}
+        if (strcmp(node->value, "mmap_file") == 0) {
+            if (node->child_count < 1 || node->child_count > 2) {
+                error("mmap_file() expects 1 or 2 arguments, got %d", node->child_count);
+            }
+            codegen_expression(gen, node->children[0]);
+            codegen_emit(gen, "pop rdi");
+            codegen_emit(gen, "call mmap_file");
+            codegen_emit(gen, "push rax");
+            if (node->child_count == 2) {
+                codegen_emit(gen, "push rdx");
+                codegen_address(gen, node->children[1]);
+                codegen_emit(gen, "pop r11");
+                codegen_emit(gen, "pop rdx");
+                codegen_emit(gen, "mov [r11], rdx");
+            }
+            return;
+        }
 
-void codegen_statement(CodeGen *gen, ASTNode *node) {
-    char buffer[512];
+        if (strcmp(node->value, "byte_at") == 0) {
+            codegen_expect_args(node, 2);
+            codegen_expression(gen, node->children[0]);
+            codegen_expression(gen, node->children[1]);
+            codegen_emit(gen, "pop rcx");
+            codegen_emit(gen, "pop rax");
+            codegen_emit(gen, "movzx rax, byte [rax + rcx]");
+            codegen_emit(gen, "push rax");
+            return;
+        }
 
-    if (node->type == AST_ARRAY_DECL) {
-        int size = atoi(node->right->value);
-        codegen_add_array(gen, node->value, size);
-        return;
-    }
+        if (strcmp(node->value, "atomic_add") == 0) {
+            codegen_expect_args(node, 2);
+            codegen_address(gen, node->children[0]);
+            codegen_expression(gen, node->children[1]);
+            codegen_emit(gen, "pop rax");
+            codegen_emit(gen, "pop r11");
+            codegen_emit(gen, "lock xadd [r11], rax");
+            codegen_emit(gen, "push rax");
+            return;
+        }
 
-    if (node->type == AST_VAR_DECL) {
-        const char *var_type = node->left->value;
-        codegen_add_var_typed(gen, node->value, var_type);
+        if (strcmp(node->value, "atomic_cas") == 0) {
+            codegen_expect_args(node, 3);
+            codegen_address(gen, node->children[0]);
+            codegen_expression(gen, node->children[1]);
+            codegen_expression(gen, node->children[2]);
+            codegen_emit(gen, "pop rcx");
+            codegen_emit(gen, "pop rax");
+            codegen_emit(gen, "pop r11");
+            codegen_emit(gen, "lock cmpxchg [r11], rcx");
+            codegen_emit(gen, "sete al");
+            codegen_emit(gen, "movzx rax, al");
+            codegen_emit(gen, "push rax");
+            return;
+        }
 
-        if (node->right != NULL) {
-            if (strcmp(var_type, "string") == 0) {
-                codegen_expression(gen, node->right);
-                codegen_emit(gen, "pop rsi");
-                sprintf(buffer, "lea rdi, [rbp-%d]", gen->var_offsets[gen->var_count - 1]);
-                codegen_emit(gen, buffer);
-                codegen_emit(gen, "call strcpy_internal");
-            } else {
-                codegen_expression(gen, node->right);
-                codegen_emit(gen, "pop rax");
-                sprintf(buffer, "mov [rbp-%d], rax", gen->var_offsets[gen->var_count - 1]);
-                codegen_emit(gen, buffer);
-            }
-        } else if (strcmp(var_type, "string") == 0) {
-            sprintf(buffer, "lea rdi, [rbp-%d]", gen->var_offsets[gen->var_count - 1]);
-            codegen_emit(gen, buffer);
-            codegen_emit(gen, "mov byte [rdi], 0");
+        // En x86-64 una carga ya tiene semantica acquire; el store usa xchg
+        // (lock implicito) para ser secuencialmente consistente.
+        if (strcmp(node->value, "atomic_load") == 0) {
+            codegen_expect_args(node, 1);
+            codegen_address(gen, node->children[0]);
+            codegen_emit(gen, "pop r11");
+            codegen_emit(gen, "mov rax, [r11]");
+            codegen_emit(gen, "push rax");
+            return;
         }
-        return;
-    }
 
-    if (node->type == AST_INCREMENT) {
-        int offset = codegen_find_var(gen, node->value);
-        if (offset != -1) {
-            sprintf(buffer, "inc qword [rbp-%d]", offset);
+        if (strcmp(node->value, "atomic_store") == 0) {
+            codegen_expect_args(node, 2);
+            codegen_address(gen, node->children[0]);
+            codegen_expression(gen, node->children[1]);
+            codegen_emit(gen, "pop rax");
+            codegen_emit(gen, "pop r11");
+            codegen_emit(gen, "xchg [r11], rax");
+            codegen_emit(gen, "push rax");
+            return;
+        }
+
+        if (strcmp(node->value, "mutex_lock") == 0 ||
+            strcmp(node->value, "mutex_unlock") == 0 ||
+            strcmp(node->value, "spin_lock") == 0 ||
+            strcmp(node->value, "spin_unlock") == 0) {
+            codegen_expect_args(node, 1);
+            codegen_address(gen, node->children[0]);
+            codegen_emit(gen, "pop rdi");
+            sprintf(buffer, "call %s", node->value);
             codegen_emit(gen, buffer);
+            codegen_emit(gen, "push rax");
+            return;
         }
-        return;
-    }
 
-    if (node->type == AST_DECREMENT) {
-        int offset = codegen_find_var(gen, node->value);
-        if (offset != -1) {
-            sprintf(buffer, "dec qword [rbp-%d]", offset);
+        // Se evaluan todos los argumentos en la pila antes de cargar los
+        // registros (una llamada anidada los pisaria). Del septimo en
+        // adelante van en la pila, el septimo en la cima.
+        const char *arg_regs[] = {"rdi", "rsi", "rdx", "rcx", "r8", "r9"};
+        int count = node->child_count;
+        int stack_args = count > 6 ? count - 6 : 0;
+
+        for (int i = 0; i < count; i++) {
+            codegen_expression(gen, node->children[i]);
+        }
+        for (int k = 0; k < stack_args; k++) {
+            sprintf(buffer, "push qword [rsp + %d]", 16 * k);
+            codegen_emit(gen, buffer);
+        }
+        for (int i = 0; i < count && i < 6; i++) {
+            sprintf(buffer, "mov %s, [rsp + %d]", arg_regs[i], 8 * (stack_args + count - 1 - i));
             codegen_emit(gen, buffer);
         }
-        return;
-    }
 
-    if (node->type == AST_CONTINUE) {
-        if (gen->loop_depth > 0) {
-            sprintf(buffer, "jmp .L%d", gen->loop_start_labels[gen->loop_depth - 1]);
+        codegen_pgo_site(gen, node, 0);
+        sprintf(buffer, "call %s", node->value);
+        codegen_emit(gen, buffer);
+
+        if (count > 0) {
+            sprintf(buffer, "add rsp, %d", 8 * (count + stack_args));
             codegen_emit(gen, buffer);
-        } else {
-            printf("Error: continue outside of loop\n");
         }
+        codegen_emit(gen, "push rax");
         return;
     }
+}
 
-    if (node->type == AST_ASSIGNMENT) {
-        if (node->left != NULL) {
-            int base_offset = codegen_find_var(gen, node->value);
-            if (base_offset != -1) {
-                codegen_expression(gen, node->right);
-                codegen_emit(gen, "pop rbx");
+// ==================== PROFILING ====================
+// Con --profile cada funcion reserva [rbp-8] (rdtsc de entrada) y [rbp-16]
+// (ciclos de las funciones que llama). Al salir suma su tiempo total al
+// [rbp-16] del llamador y su tiempo propio a su registro. Los registros
+// (llamadas/iteraciones, ciclos, nombre, tipo, impreso) van en la seccion
+// bprof de cada objeto; ld la junta entre __start_bprof y __stop_bprof.
 
-                codegen_expression(gen, node->left);
-                codegen_emit(gen, "pop rax");
+#define PROF_RECORD_SIZE 40
 
-                codegen_emit(gen, "imul rax, 8");
+void codegen_profile_entry(CodeGen *gen) {
+    char buffer[512];
+    if (!codegen_options.profile) return;
+    sprintf(buffer, "lock add qword [rel prof.%s], 1", gen->func_name);
+    codegen_emit(gen, buffer);
+    codegen_emit(gen, "mov qword [rbp-16], 0");
+    codegen_emit(gen, "rdtsc");
+    codegen_emit(gen, "shl rdx, 32");
+    codegen_emit(gen, "or rax, rdx");
+    codegen_emit(gen, "mov [rbp-8], rax");
+}
+
+// Conserva rax (valor de retorno)
+void codegen_profile_exit(CodeGen *gen) {
+    char buffer[512];
+    if (!codegen_options.profile) return;
+    codegen_emit(gen, "mov rcx, rax");
+    codegen_emit(gen, "rdtsc");
+    codegen_emit(gen, "shl rdx, 32");
+    codegen_emit(gen, "or rax, rdx");
+    codegen_emit(gen, "sub rax, [rbp-8]");
+    codegen_emit(gen, "mov rdx, [rbp]");
+    codegen_emit(gen, "add [rdx-16], rax");
+    codegen_emit(gen, "sub rax, [rbp-16]");
+    sprintf(buffer, "lock add [rel prof.%s + 8], rax", gen->func_name);
+    codegen_emit(gen, buffer);
+    codegen_emit(gen, "mov rax, rcx");
+}
+
+// Una iteracion mas del bucle actual. Atomico si el programa tiene parallel
+// loops: el bucle puede estar en una funcion llamada desde uno
+void codegen_profile_loop(CodeGen *gen) {
+    char buffer[512];
+    if (!codegen_options.profile) return;
+    sprintf(buffer, "%sadd qword [rel prof.%s.%d], 1", codegen_options.threaded ? "lock " : "",
+            gen->func_name, gen->profile_loops++);
+    codegen_emit(gen, buffer);
+}
+
+void codegen_profile_name(CodeGen *gen, const char *label, const char *name) {
+    fprintf(gen->output, "%s.name: db ", label);
+    for (const char *s = name; *s; s++) {
+        fprintf(gen->output, "%d, ", (unsigned char)*s);
+    }
+    fprintf(gen->output, "0\n");
+}
+
+void codegen_profile_records(CodeGen *gen) {
+    char label[300];
+    char name[300];
+    if (!codegen_options.profile) return;
+
+    fprintf(gen->output, "section bprof progbits alloc noexec write align=8\n");
+    fprintf(gen->output, "prof.%s: dq 0, 0, prof.%s.name, 0, 0\n", gen->func_name, gen->func_name);
+    for (int i = 0; i < gen->profile_loops; i++) {
+        fprintf(gen->output, "prof.%s.%d: dq 0, 0, prof.%s.%d.name, 1, 0\n",
+                gen->func_name, i, gen->func_name, i);
+    }
+    fprintf(gen->output, "section .rodata\n");
+    sprintf(label, "prof.%s", gen->func_name);
+    codegen_profile_name(gen, label, gen->func_name);
+    for (int i = 0; i < gen->profile_loops; i++) {
+        sprintf(label, "prof.%s.%d", gen->func_name, i);
+        sprintf(name, "%s loop %d", gen->func_name, i + 1);
+        codegen_profile_name(gen, label, name);
+    }
+    fprintf(gen->output, "section .text\n\n");
+}
+
+// Con --profile-generate los contadores de la funcion (ver pgo.c) van en la
+// seccion bpgo tras una cabecera {numero, "nombre checksum "}
+void codegen_pgo_count(CodeGen *gen, int counter) {
+    char buffer[512];
+    if (!codegen_options.pgo_generate) return;
+    sprintf(buffer, "%sadd qword [rel pgo.%s + %d], 1", codegen_options.threaded ? "lock " : "",
+            gen->func_name, 16 + 8 * counter);
+    codegen_emit(gen, buffer);
+}
+
+// Contador offset del nodo; los creados tras numerar no tienen
+void codegen_pgo_site(CodeGen *gen, ASTNode *node, int offset) {
+    if (node->site >= 0) codegen_pgo_count(gen, node->site + offset);
+}
+
+void codegen_pgo_records(CodeGen *gen) {
+    char label[300];
+    char name[300];
+    if (!codegen_options.pgo_generate) return;
+
+    fprintf(gen->output, "section bpgo progbits alloc noexec write align=8\n");
+    fprintf(gen->output, "pgo.%s: dq %d, pgo.%s.name\n", gen->func_name, gen->pgo_counters, gen->func_name);
+    fprintf(gen->output, "    times %d dq 0\n", gen->pgo_counters);
+    fprintf(gen->output, "section .rodata\n");
+    sprintf(label, "pgo.%s", gen->func_name);
+    sprintf(name, "%s %08x ", gen->func_name, gen->pgo_checksum);
+    codegen_profile_name(gen, label, name);
+    fprintf(gen->output, "section .text\n\n");
+}
+
+// ==================== SWITCH ====================
+// Los casos se ordenan por valor y se despachan en un arbol de busqueda
+// binaria; un tramo denso (al menos un tercio de los valores del rango
+// presentes) se resuelve con una tabla de saltos en .rodata. El valor llega
+// en rax; rcx se usa como temporal. Las etiquetas destino son prefix+numero
+// (.L del generador directo, .B de los bloques del IR).
+
+#define SWITCH_TABLE_MIN 4
+#define SWITCH_TABLE_MAX 4096
+
+typedef struct {
+    long long value;
+    int target;
+    int line;
+} SwitchCase;
+
+int switch_case_compare(const void *a, const void *b) {
+    long long x = ((const SwitchCase*)a)->value, y = ((const SwitchCase*)b)->value;
+    return (x > y) - (x < y);
+}
+
+// Valores de todos los case de node; targets[i] es el destino del hijo i.
+// Devuelve el numero de valores, ordenados
+int codegen_switch_cases(ASTNode *node, const int *targets, SwitchCase **out) {
+    int count = 0;
+    for (int i = 0; i < node->child_count; i++) count += node->children[i]->child_count;
+    SwitchCase *cases = (SwitchCase*)malloc((count + 1) * sizeof(SwitchCase));
+    count = 0;
+    for (int i = 0; i < node->child_count; i++) {
+        ASTNode *item = node->children[i];
+        for (int j = 0; j < item->child_count; j++) {
+            cases[count].value = strtoll(item->children[j]->value, NULL, 10);
+            cases[count].target = targets[i];
+            cases[count].line = item->line;
+            count++;
+        }
+    }
+    qsort(cases, count, sizeof(SwitchCase), switch_case_compare);
+    for (int i = 1; i < count; i++) {
+        if (cases[i].value == cases[i - 1].value) {
+            error("Duplicate case value %lld at line %d", cases[i].value, cases[i].line);
+        }
+    }
+    *out = cases;
+    return count;
+}
+
+void codegen_switch_compare(CodeGen *gen, long long value) {
+    char buffer[128];
+    if (value >= INT_MIN && value <= INT_MAX) {
+        sprintf(buffer, "cmp rax, %lld", value);
+    } else {
+        sprintf(buffer, "mov rcx, %lld", value);
+        codegen_emit(gen, buffer);
+        strcpy(buffer, "cmp rax, rcx");
+    }
+    codegen_emit(gen, buffer);
+}
+
+void codegen_switch_range(CodeGen *gen, SwitchCase *cases, int count, const char *prefix, int default_target) {
+    char buffer[512];
+    unsigned long long range = (unsigned long long)cases[count - 1].value - cases[0].value + 1;
+
+    if (count >= SWITCH_TABLE_MIN && range <= SWITCH_TABLE_MAX && range <= (unsigned long long)count * 3) {
+        int table = codegen_new_label(gen);
+        if (cases[0].value != 0) {
+            if (cases[0].value >= INT_MIN && cases[0].value <= INT_MAX) {
+                sprintf(buffer, "sub rax, %lld", cases[0].value);
+            } else {
+                sprintf(buffer, "mov rcx, %lld", cases[0].value);
+                codegen_emit(gen, buffer);
+                strcpy(buffer, "sub rax, rcx");
+            }
+            codegen_emit(gen, buffer);
+        }
+        // Sin signo: tambien descarta los valores por debajo del minimo
+        sprintf(buffer, "cmp rax, %llu", range - 1);
+        codegen_emit(gen, buffer);
+        sprintf(buffer, "ja %s%d", prefix, default_target);
+        codegen_emit(gen, buffer);
+        sprintf(buffer, "lea rcx, [rel .L%d]", table);
+        codegen_emit(gen, buffer);
+        codegen_emit(gen, "jmp [rcx + rax*8]");
+
+        fprintf(gen->output, "section .rodata\n");
+        fprintf(gen->output, "align 8\n");
+        fprintf(gen->output, ".L%d:\n", table);
+        int next = 0;
+        for (unsigned long long slot = 0; slot < range; slot++) {
+            int target = default_target;
+            if ((unsigned long long)(cases[next].value - cases[0].value) == slot) target = cases[next++].target;
+            fprintf(gen->output, "    dq %s%d\n", prefix, target);
+        }
+        fprintf(gen->output, "section %s\n", gen->section);
+        return;
+    }
+
+    if (count <= 3) {
+        for (int i = 0; i < count; i++) {
+            codegen_switch_compare(gen, cases[i].value);
+            sprintf(buffer, "je %s%d", prefix, cases[i].target);
+            codegen_emit(gen, buffer);
+        }
+        sprintf(buffer, "jmp %s%d", prefix, default_target);
+        codegen_emit(gen, buffer);
+        return;
+    }
+
+    int mid = count / 2;
+    int lower = codegen_new_label(gen);
+    codegen_switch_compare(gen, cases[mid].value);
+    sprintf(buffer, "je %s%d", prefix, cases[mid].target);
+    codegen_emit(gen, buffer);
+    sprintf(buffer, "jl .L%d", lower);
+    codegen_emit(gen, buffer);
+    codegen_switch_range(gen, cases + mid + 1, count - mid - 1, prefix, default_target);
+    sprintf(buffer, ".L%d", lower);
+    codegen_emit_label(gen, buffer);
+    codegen_switch_range(gen, cases, mid, prefix, default_target);
+}
+
+void codegen_switch_dispatch(CodeGen *gen, SwitchCase *cases, int count, const char *prefix, int default_target) {
+    char buffer[64];
+    if (count == 0) {
+        sprintf(buffer, "jmp %s%d", prefix, default_target);
+        codegen_emit(gen, buffer);
+        return;
+    }
+    codegen_switch_range(gen, cases, count, prefix, default_target);
+}
+
+void codegen_switch(CodeGen *gen, ASTNode *node) {
+    char buffer[64];
+    int end_label = codegen_new_label(gen);
+    int default_label = end_label;
+    int *labels = (int*)malloc((node->child_count + 1) * sizeof(int));
+    for (int i = 0; i < node->child_count; i++) {
+        labels[i] = codegen_new_label(gen);
+        if (strcmp(node->children[i]->value, "default") == 0) default_label = labels[i];
+    }
+
+    SwitchCase *cases;
+    int count = codegen_switch_cases(node, labels, &cases);
+    codegen_expression(gen, node->left);
+    codegen_emit(gen, "pop rax");
+    codegen_switch_dispatch(gen, cases, count, ".L", default_label);
+
+    for (int i = 0; i < node->child_count; i++) {
+        sprintf(buffer, ".L%d", labels[i]);
+        codegen_emit_label(gen, buffer);
+        ASTNode *body = node->children[i]->right;
+        for (int j = 0; j < body->child_count; j++) {
+            codegen_statement(gen, body->children[j]);
+        }
+        if (i + 1 < node->child_count) {
+            sprintf(buffer, "jmp .L%d", end_label);
+            codegen_emit(gen, buffer);
+        }
+    }
+    sprintf(buffer, ".L%d", end_label);
+    codegen_emit_label(gen, buffer);
+    free(cases);
+    free(labels);
+}
+
+// Contenido de una tabla calculada en compilacion (int t[N] = f) como .L<label>
+void codegen_emit_table(CodeGen *gen, int label, ASTNode *table) {
+    fprintf(gen->output, "section .rodata\n");
+    fprintf(gen->output, "align 8\n");
+    fprintf(gen->output, ".L%d:", label);
+    for (int i = 0; i < table->child_count; i++) {
+        fprintf(gen->output, "%s%s", i % 8 ? ", " : "\n    dq ", table->children[i]->value);
+    }
+    fprintf(gen->output, "\nsection %s\n", gen->section);
+}
+
+// ==================== HOT/COLD ====================
+// Una rama de un if es fria si se ha marcado (if likely / if unlikely),
+// si llama a exit() o si con --profile-use no se ha ejecutado nunca (y el
+// if si). Se genera aparte y va al final de la funcion en .text.cold; el
+// camino caliente queda compacto y sin saltos tomados.
+
+int codegen_calls_exit(ASTNode *block) {
+    for (int i = 0; i < block->child_count; i++) {
+        ASTNode *child = block->children[i];
+        if (child->type == AST_CALL && strcmp(child->value, "exit") == 0) return 1;
+    }
+    return 0;
+}
+
+int codegen_is_cold(ASTNode *node, int branch) {
+    if (branch >= node->child_count) return 0;
+    ASTNode *block = node->children[branch];
+    if (strcmp(node->value, branch == 0 ? "unlikely" : "likely") == 0) return 1;
+    if (node->count > 0 && block->count == 0) return 1;
+    return codegen_calls_exit(block);
+}
+
+// Rama fria del if (0 then, 1 else) o -1; si lo son las dos, ninguna
+int codegen_if_cold(ASTNode *node) {
+    int then_cold = codegen_is_cold(node, 0);
+    int else_cold = codegen_is_cold(node, 1);
+    if (then_cold == else_cold) return -1;
+    return then_cold ? 0 : 1;
+}
+
+// En el generador directo no se parte dentro de una rama ya fria ni en el
+// cuerpo de un parallel loop (que es otra funcion)
+int codegen_cold_branch(CodeGen *gen, ASTNode *node) {
+    if (gen->in_parallel || strcmp(gen->section, ".text") != 0) return -1;
+    return codegen_if_cold(node);
+}
+
+// Genera el bloque como .L<label> (contador de PGO opcional) seguido de un
+// salto a .L<end_label>, y lo guarda para codegen_flush_cold
+void codegen_cold(CodeGen *gen, ASTNode *block, int label, int end_label, int counter) {
+    char buffer[64];
+    char *text;
+    size_t len;
+    FILE *output = gen->output;
+    gen->output = open_memstream(&text, &len);
+    gen->section = ".text.cold";
+    gen->line = 0;
+    sprintf(buffer, ".L%d", label);
+    codegen_emit_label(gen, buffer);
+    if (counter >= 0) codegen_pgo_count(gen, counter);
+    for (int i = 0; i < block->child_count; i++) {
+        codegen_statement(gen, block->children[i]);
+    }
+    sprintf(buffer, "jmp .L%d", end_label);
+    codegen_emit(gen, buffer);
+    fclose(gen->output);
+    gen->output = output;
+    gen->section = ".text";
+    gen->line = 0;
+
+    gen->cold = (char*)realloc(gen->cold, gen->cold_size + len + 1);
+    memcpy(gen->cold + gen->cold_size, text, len + 1);
+    gen->cold_size += len;
+    free(text);
+}
+
+void codegen_flush_cold(CodeGen *gen) {
+    if (!gen->cold) return;
+    fprintf(gen->output, "section .text.cold\n");
+    fwrite(gen->cold, 1, gen->cold_size, gen->output);
+    fprintf(gen->output, "section .text\n");
+    free(gen->cold);
+    gen->cold = NULL;
+    gen->cold_size = 0;
+}
+
+void codegen_statement(CodeGen *gen, ASTNode *node) {
+    char buffer[512];
+    codegen_line(gen, node);
+
+    if (node->type == AST_ARRAY_DECL) {
+        int size = atoi(node->right->value);
+        codegen_add_array(gen, node->value, size);
+        if (node->child_count > 0) {
+            char addr[64];
+            int table = codegen_new_label(gen);
+            codegen_find_var_address(gen, node->value, addr);
+            sprintf(buffer, "lea rsi, [rel .L%d]", table);
+            codegen_emit(gen, buffer);
+            sprintf(buffer, "lea rdi, [%s]", addr);
+            codegen_emit(gen, buffer);
+            sprintf(buffer, "mov ecx, %d", size);
+            codegen_emit(gen, buffer);
+            codegen_emit(gen, "rep movsq");
+            codegen_emit_table(gen, table, node->children[0]);
+        }
+        return;
+    }
+
+    if (node->type == AST_VAR_DECL) {
+        const char *var_type = node->left->value;
+        codegen_add_var_typed(gen, node->value, var_type);
+
+        if (node->right != NULL) {
+            if (strcmp(var_type, "string") == 0) {
+                codegen_check_mmap(node->right, node->value);
+                codegen_expression(gen, node->right);
+                codegen_emit(gen, "pop rsi");
+                sprintf(buffer, "lea rdi, [rbp-%d]", gen->var_offsets[gen->var_count - 1]);
+                codegen_emit(gen, buffer);
+                codegen_emit(gen, "call strcpy_internal");
+            } else {
+                codegen_expression(gen, node->right);
+                codegen_emit(gen, "pop rax");
+                sprintf(buffer, "mov [rbp-%d], rax", gen->var_offsets[gen->var_count - 1]);
+                codegen_emit(gen, buffer);
+            }
+        } else if (strcmp(var_type, "string") == 0) {
+            sprintf(buffer, "lea rdi, [rbp-%d]", gen->var_offsets[gen->var_count - 1]);
+            codegen_emit(gen, buffer);
+            codegen_emit(gen, "mov byte [rdi], 0");
+        }
+        return;
+    }
+
+    if (node->type == AST_INCREMENT) {
+        char addr[64];
+        if (codegen_find_var_address(gen, node->value, addr)) {
+            sprintf(buffer, "inc qword [%s]", addr);
+            codegen_emit(gen, buffer);
+        }
+        return;
+    }
+
+    if (node->type == AST_DECREMENT) {
+        char addr[64];
+        if (codegen_find_var_address(gen, node->value, addr)) {
+            sprintf(buffer, "dec qword [%s]", addr);
+            codegen_emit(gen, buffer);
+        }
+        return;
+    }
+
+    if (node->type == AST_CONTINUE) {
+        if (gen->loop_depth > 0) {
+            sprintf(buffer, "jmp .L%d", gen->loop_start_labels[gen->loop_depth - 1]);
+            codegen_emit(gen, buffer);
+        } else {
+            printf("Error: continue outside of loop\n");
+        }
+        return;
+    }
+
+    if (node->type == AST_ASSIGNMENT) {
+        char addr[64];
+        if (node->left != NULL) {
+            if (codegen_find_var_address(gen, node->value, addr)) {
+                codegen_expression(gen, node->right);
+                codegen_expression(gen, node->left);
+                codegen_emit(gen, "pop rax");
+                codegen_emit(gen, "pop r11");
+
+                codegen_emit(gen, "imul rax, 8");
 
-                sprintf(buffer, "lea rcx, [rbp-%d]", base_offset);
+                sprintf(buffer, "lea rcx, [%s]", addr);
                 codegen_emit(gen, buffer);
                 codegen_emit(gen, "add rcx, rax");
 
-                codegen_emit(gen, "mov [rcx], rbx");
+                codegen_emit(gen, "mov [rcx], r11");
             }
             return;
         }
 
-        int offset = codegen_find_var(gen, node->value);
-        if (offset != -1) {
+        if (codegen_find_var_address(gen, node->value, addr)) {
+            const char *var_type = codegen_find_var_type(gen, node->value);
+            if (var_type && strcmp(var_type, "string") == 0) codegen_check_mmap(node->right, node->value);
             codegen_expression(gen, node->right);
             codegen_emit(gen, "pop rax");
-            sprintf(buffer, "mov [rbp-%d], rax", offset);
+            sprintf(buffer, "mov [%s], rax", addr);
             codegen_emit(gen, buffer);
         } else {
             printf("Error: Variable '%s' not found\n", node->value);
@@ -432,13 +1270,18 @@ void codegen_statement(CodeGen *gen, ASTNode *node) {
     }
 
     if (node->type == AST_RETURN) {
+        if (gen->in_parallel) {
+            error("return is not allowed inside a parallel loop");
+        }
         if (node->left != NULL) {
             codegen_expression(gen, node->left);
             codegen_emit(gen, "pop rax");
         } else {
             codegen_emit(gen, "mov rax, 0");
         }
-        codegen_emit(gen, "add rsp, 256");
+        codegen_profile_exit(gen);
+        codegen_internal_restore(gen);
+        codegen_emit(gen, "mov rsp, rbp");
         codegen_emit(gen, "pop rbp");
         codegen_emit(gen, "ret");
         return;
@@ -448,13 +1291,59 @@ void codegen_statement(CodeGen *gen, ASTNode *node) {
         int else_label = codegen_new_label(gen);
         int end_label = codegen_new_label(gen);
 
+        codegen_pgo_site(gen, node, 0);
         codegen_expression(gen, node->left);
         codegen_emit(gen, "pop rax");
         codegen_emit(gen, "cmp rax, 0");
+
+        // Rama fria fuera de linea: el resto del if cae sin saltos
+        ASTNode *then_block = node->children[0];
+        int cold = codegen_cold_branch(gen, node);
+        if (cold >= 0) {
+            int cold_label = codegen_new_label(gen);
+            sprintf(buffer, "%s .L%d", cold == 0 ? "jne" : "je", cold_label);
+            codegen_emit(gen, buffer);
+            if (cold == 1) codegen_pgo_site(gen, node, 1);
+            ASTNode *hot_block = node->children[1 - cold];
+            if (cold == 1 || node->child_count > 1) {
+                for (int i = 0; i < hot_block->child_count; i++) {
+                    codegen_statement(gen, hot_block->children[i]);
+                }
+            }
+            sprintf(buffer, ".L%d", end_label);
+            codegen_emit_label(gen, buffer);
+            codegen_cold(gen, node->children[cold], cold_label, end_label,
+                         cold == 0 && node->site >= 0 ? node->site + 1 : -1);
+            return;
+        }
+
+        // Con --profile-use, si el else es mas frecuente va primero y el
+        // then queda detras (el camino caliente no salta)
+        if (node->child_count > 1 && node->children[1]->count > then_block->count) {
+            int then_label = codegen_new_label(gen);
+            sprintf(buffer, "jne .L%d", then_label);
+            codegen_emit(gen, buffer);
+            ASTNode *else_block = node->children[1];
+            for (int i = 0; i < else_block->child_count; i++) {
+                codegen_statement(gen, else_block->children[i]);
+            }
+            sprintf(buffer, "jmp .L%d", end_label);
+            codegen_emit(gen, buffer);
+            sprintf(buffer, ".L%d", then_label);
+            codegen_emit_label(gen, buffer);
+            codegen_pgo_site(gen, node, 1);
+            for (int i = 0; i < then_block->child_count; i++) {
+                codegen_statement(gen, then_block->children[i]);
+            }
+            sprintf(buffer, ".L%d", end_label);
+            codegen_emit_label(gen, buffer);
+            return;
+        }
+
         sprintf(buffer, "je .L%d", else_label);
         codegen_emit(gen, buffer);
+        codegen_pgo_site(gen, node, 1);
 
-        ASTNode *then_block = node->children[0];
         for (int i = 0; i < then_block->child_count; i++) {
             codegen_statement(gen, then_block->children[i]);
         }
@@ -485,6 +1374,7 @@ void codegen_statement(CodeGen *gen, ASTNode *node) {
         gen->loop_end_labels[gen->loop_depth] = end_label;
         gen->loop_depth++;
 
+        codegen_pgo_site(gen, node, 0);
         sprintf(buffer, ".L%d", start_label);
         codegen_emit_label(gen, buffer);
 
@@ -493,6 +1383,8 @@ void codegen_statement(CodeGen *gen, ASTNode *node) {
         codegen_emit(gen, "cmp rax, 0");
         sprintf(buffer, "je .L%d", end_label);
         codegen_emit(gen, buffer);
+        codegen_profile_loop(gen);
+        codegen_pgo_site(gen, node, 1);
 
         ASTNode *body = node->right;
         for (int i = 0; i < body->child_count; i++) {
@@ -511,6 +1403,9 @@ void codegen_statement(CodeGen *gen, ASTNode *node) {
 
     if (node->type == AST_BREAK) {
         if (gen->loop_depth > 0) {
+            if (gen->loop_end_labels[gen->loop_depth - 1] == -1) {
+                error("break is not allowed inside a parallel loop");
+            }
             sprintf(buffer, "jmp .L%d", gen->loop_end_labels[gen->loop_depth - 1]);
             codegen_emit(gen, buffer);
         } else {
@@ -519,6 +1414,16 @@ void codegen_statement(CodeGen *gen, ASTNode *node) {
         return;
     }
 
+    if (node->type == AST_PARALLEL_LOOP) {
+        codegen_parallel_loop(gen, node);
+        return;
+    }
+
+    if (node->type == AST_SWITCH) {
+        codegen_switch(gen, node);
+        return;
+    }
+
     if (node->type == AST_CALL || node->type == AST_BINARY_OP) {
         codegen_expression(gen, node);
         codegen_emit(gen, "pop rax");
@@ -526,192 +1431,1662 @@ void codegen_statement(CodeGen *gen, ASTNode *node) {
     }
 }
 
-void codegen_function(CodeGen *gen, ASTNode *node) {
+int codegen_frame_bytes(CodeGen *gen) {
+    return (gen->frame_size + 15) & ~15;
+}
+
+void codegen_flush_deferred(CodeGen *gen) {
+    for (int i = 0; i < gen->deferred_count; i++) {
+        fputs(gen->deferred[i], gen->output);
+        free(gen->deferred[i]);
+    }
+    free(gen->deferred);
+    gen->deferred = NULL;
+    gen->deferred_count = 0;
+}
+
+void codegen_reduce_combine(CodeGen *gen, const char *op, int private_offset, const char *shared) {
     char buffer[512];
 
-    sprintf(buffer, "%s", node->value);
+    if (strcmp(op, "+") == 0) {
+        sprintf(buffer, "mov rax, [rbp-%d]", private_offset);
+        codegen_emit(gen, buffer);
+        sprintf(buffer, "lock add [%s], rax", shared);
+        codegen_emit(gen, buffer);
+        return;
+    }
+
+    int retry_label = codegen_new_label(gen);
+    int done_label = codegen_new_label(gen);
+
+    sprintf(buffer, "mov rcx, [rbp-%d]", private_offset);
+    codegen_emit(gen, buffer);
+    sprintf(buffer, "mov rax, [%s]", shared);
+    codegen_emit(gen, buffer);
+    sprintf(buffer, ".L%d", retry_label);
     codegen_emit_label(gen, buffer);
+    codegen_emit(gen, "cmp rax, rcx");
+    sprintf(buffer, "%s .L%d", strcmp(op, "min") == 0 ? "jle" : "jge", done_label);
+    codegen_emit(gen, buffer);
+    sprintf(buffer, "lock cmpxchg [%s], rcx", shared);
+    codegen_emit(gen, buffer);
+    sprintf(buffer, "jne .L%d", retry_label);
+    codegen_emit(gen, buffer);
+    sprintf(buffer, ".L%d", done_label);
+    codegen_emit_label(gen, buffer);
+}
 
-    codegen_emit(gen, "push rbp");
-    codegen_emit(gen, "mov rbp, rsp");
+// Recorre [rdi, rsi) con el indice y los acumuladores de reduccion privados,
+// y al final combina cada acumulador de forma atomica con la variable compartida.
+void codegen_parallel_range(CodeGen *gen, ASTNode *node) {
+    char buffer[512];
+    char shared[16][64];
+    int private_offsets[16];
 
-    int saved_stack_offset = gen->stack_offset;
-    int saved_var_count = gen->var_count;
-    gen->stack_offset = 0;
-    gen->var_count = 0;
+    if (node->child_count > 16) {
+        error("Too many reduction variables in parallel loop");
+    }
 
-    ASTNode *params = node->children[0];
-    for (int i = 0; i < params->child_count; i++) {
-        ASTNode *param = params->children[i];
-        codegen_add_var_typed(gen, param->value, param->left->value);
+    for (int i = 0; i < node->child_count; i++) {
+        const char *var = node->children[i]->left->value;
+        int index = codegen_find_var_index(gen, var);
+        if (index == -1) {
+            error("Reduction variable '%s' not found", var);
+        }
+        if (strcmp(gen->var_types[index], "string") == 0 || gen->array_sizes[index] != 1) {
+            error("Reduction variable '%s' must be an int", var);
+        }
+        codegen_find_var_address(gen, var, shared[i]);
     }
 
-    codegen_emit(gen, "sub rsp, 256");
+    codegen_add_var(gen, node->value);
+    int index_offset = gen->var_offsets[gen->var_count - 1];
+    sprintf(buffer, "mov [rbp-%d], rdi", index_offset);
+    codegen_emit(gen, buffer);
 
-    const char *param_regs[] = {"rdi", "rsi", "rdx", "rcx", "r8", "r9"};
-    for (int i = 0; i < params->child_count && i < 6; i++) {
-        sprintf(buffer, "mov [rbp-%d], %s", gen->var_offsets[i], param_regs[i]);
+    codegen_add_var(gen, ".end");
+    int end_offset = gen->var_offsets[gen->var_count - 1];
+    sprintf(buffer, "mov [rbp-%d], rsi", end_offset);
+    codegen_emit(gen, buffer);
+
+    for (int i = 0; i < node->child_count; i++) {
+        const char *op = node->children[i]->value;
+        codegen_add_var(gen, node->children[i]->left->value);
+        private_offsets[i] = gen->var_offsets[gen->var_count - 1];
+
+        if (strcmp(op, "min") == 0) {
+            codegen_emit(gen, "mov rax, 0x7fffffffffffffff");
+        } else if (strcmp(op, "max") == 0) {
+            codegen_emit(gen, "mov rax, 0x8000000000000000");
+        } else {
+            codegen_emit(gen, "xor rax, rax");
+        }
+        sprintf(buffer, "mov [rbp-%d], rax", private_offsets[i]);
         codegen_emit(gen, buffer);
     }
 
-    ASTNode *body = node->children[1];
+    int start_label = codegen_new_label(gen);
+    int next_label = codegen_new_label(gen);
+    int end_label = codegen_new_label(gen);
+
+    gen->loop_start_labels[gen->loop_depth] = next_label;
+    gen->loop_end_labels[gen->loop_depth] = -1;
+    gen->loop_depth++;
+
+    sprintf(buffer, ".L%d", start_label);
+    codegen_emit_label(gen, buffer);
+    sprintf(buffer, "mov rax, [rbp-%d]", index_offset);
+    codegen_emit(gen, buffer);
+    sprintf(buffer, "cmp rax, [rbp-%d]", end_offset);
+    codegen_emit(gen, buffer);
+    sprintf(buffer, "jge .L%d", end_label);
+    codegen_emit(gen, buffer);
+    codegen_profile_loop(gen);
+
+    ASTNode *body = node->right;
     for (int i = 0; i < body->child_count; i++) {
         codegen_statement(gen, body->children[i]);
     }
 
-    codegen_emit(gen, "mov rax, 0");
-    codegen_emit(gen, "add rsp, 256");
-    codegen_emit(gen, "pop rbp");
-    codegen_emit(gen, "ret");
+    gen->loop_depth--;
 
-    fprintf(gen->output, "\n");
+    sprintf(buffer, ".L%d", next_label);
+    codegen_emit_label(gen, buffer);
+    sprintf(buffer, "inc qword [rbp-%d]", index_offset);
+    codegen_emit(gen, buffer);
+    sprintf(buffer, "jmp .L%d", start_label);
+    codegen_emit(gen, buffer);
+    sprintf(buffer, ".L%d", end_label);
+    codegen_emit_label(gen, buffer);
 
-    gen->stack_offset = saved_stack_offset;
-    gen->var_count = saved_var_count;
+    for (int i = 0; i < node->child_count; i++) {
+        codegen_reduce_combine(gen, node->children[i]->value, private_offsets[i], shared[i]);
+    }
 }
 
-void codegen_program(CodeGen *gen, ASTNode *node) {
-    fprintf(gen->output, "section .data\n");
-    fprintf(gen->output, "    digit_buffer db '0000000000', 10\n");
-    fprintf(gen->output, "    digit_count dq 0\n");
-    fprintf(gen->output, "    input_buffer times 256 db 0\n");
-    fprintf(gen->output, "    newline db 10\n\n");
-
-    fprintf(gen->output, "section .text\n");
-    fprintf(gen->output, "global _start\n\n");
+void codegen_parallel_loop(CodeGen *gen, ASTNode *node) {
+    char buffer[512];
 
-    fprintf(gen->output, "print_no_nl:\n");
-    codegen_emit(gen, "push rbp");
+    if (gen->in_parallel) {
+        // Anidado: el bucle interior se ejecuta en el hilo del exterior
+        int saved_var_count = gen->var_count;
+        codegen_expression(gen, node->left);
+        codegen_emit(gen, "pop rsi");
+        codegen_emit(gen, "xor rdi, rdi");
+        codegen_parallel_range(gen, node);
+        gen->var_count = saved_var_count;
+        return;
+    }
+
+    char name[300];
+    sprintf(name, "__par_%s_%d", gen->func_name, gen->parallel_count++);
+
+    // El cuerpo se genera como una funcion aparte que recibe el rango en
+    // rdi/rsi y el marco del padre en rdx (guardado en r12).
+    CodeGen *body = (CodeGen*)malloc(sizeof(CodeGen));
+    *body = *gen;
+    for (int i = 0; i < body->var_count; i++) {
+        body->var_outer[i] = 1;
+    }
+    body->stack_offset = 0;
+    body->frame_size = 0;
+    body->loop_depth = 0;
+    body->in_parallel = 1;
+    body->line = 0;
+    if (codegen_options.profile) {
+        codegen_push_var(body, ".prof", "int", 16, 1);
+    }
+
+    char *text;
+    size_t len;
+    body->output = open_memstream(&text, &len);
+    if (codegen_options.profile) {
+        // Las funciones llamadas desde el cuerpo suman su tiempo en [rbp-16]
+        codegen_emit(body, "mov qword [rbp-16], 0");
+    }
+    codegen_parallel_range(body, node);
+    fclose(body->output);
+
+    char *fn_text;
+    size_t fn_len;
+    body->output = open_memstream(&fn_text, &fn_len);
+    body->line = 0;
+    codegen_line(body, node);
+    codegen_function_symbol(body, name);
+    codegen_emit(body, "push r12");
+    codegen_emit(body, "push rbp");
+    codegen_emit(body, "mov rbp, rsp");
+    if (codegen_frame_bytes(body) > 0) {
+        sprintf(buffer, "sub rsp, %d", codegen_frame_bytes(body));
+        codegen_emit(body, buffer);
+    }
+    codegen_emit(body, "mov r12, rdx");
+    fwrite(text, 1, len, body->output);
+    codegen_emit(body, "mov rsp, rbp");
+    codegen_emit(body, "pop rbp");
+    codegen_emit(body, "pop r12");
+    codegen_emit(body, "ret");
+    fprintf(body->output, ".end:\n\n");
+    fclose(body->output);
+    free(text);
+
+    gen->label_count = body->label_count;
+    gen->profile_loops = body->profile_loops;
+    gen->deferred = (char**)realloc(gen->deferred, (gen->deferred_count + 1) * sizeof(char*));
+    gen->deferred[gen->deferred_count++] = fn_text;
+    free(body);
+
+    codegen_expression(gen, node->left);
+    codegen_emit(gen, "pop rdx");
+    sprintf(buffer, "lea rdi, [rel %s]", name);
+    codegen_emit(gen, buffer);
+    codegen_emit(gen, "mov rsi, rbp");
+    codegen_emit(gen, "call par_run");
+}
+
+// Con -O las funciones pasan por el IR (ir.c); si no se pueden bajar se
+// usa el generador directo
+int codegen_ir_function(CodeGen *gen, ASTNode *node);
+int codegen_is_internal(const char *name);
+
+void codegen_function(CodeGen *gen, ASTNode *node) {
+    char buffer[512];
+    FILE *output = gen->output;
+    char *text;
+    size_t len;
+
+    if (codegen_options.optimize && !codegen_options.profile && !codegen_options.pgo_generate &&
+        codegen_ir_function(gen, node)) return;
+
+    int saved_stack_offset = gen->stack_offset;
+    int saved_var_count = gen->var_count;
+    gen->stack_offset = 0;
+    gen->frame_size = 0;
+    gen->var_count = 0;
+    gen->parallel_count = 0;
+    gen->profile_loops = 0;
+    gen->line = 0;
+    strcpy(gen->func_name, node->value);
+    if (codegen_options.pgo_generate) {
+        gen->pgo_counters = node->site > 0 ? node->site : 1;
+        gen->pgo_checksum = node->checksum;
+    }
+
+    // El cuerpo se genera aparte: el tamaño del marco se conoce al final
+    gen->output = open_memstream(&text, &len);
+
+    if (codegen_options.profile) {
+        codegen_push_var(gen, ".prof", "int", 16, 1);
+    }
+    int first_param = gen->var_count;
+    ASTNode *params = node->children[0];
+    for (int i = 0; i < params->child_count; i++) {
+        ASTNode *param = params->children[i];
+        codegen_add_var_typed(gen, param->value, param->left->value);
+    }
+
+    const char *param_regs[] = {"rdi", "rsi", "rdx", "rcx", "r8", "r9"};
+    for (int i = 0; i < params->child_count && i < 6; i++) {
+        sprintf(buffer, "mov [rbp-%d], %s", gen->var_offsets[first_param + i], param_regs[i]);
+        codegen_emit(gen, buffer);
+    }
+    // Los parametros a partir del septimo llegan en la pila del llamador
+    for (int i = 6; i < params->child_count; i++) {
+        sprintf(buffer, "mov rax, [rbp + %d]", 16 + 8 * (i - 6));
+        codegen_emit(gen, buffer);
+        sprintf(buffer, "mov [rbp-%d], rax", gen->var_offsets[first_param + i]);
+        codegen_emit(gen, buffer);
+    }
+    // Con la convencion interna r10 y r11 se devuelven como llegaron
+    gen->internal = codegen_is_internal(node->value);
+    if (gen->internal) {
+        codegen_push_var(gen, ".internal", "int", 16, 1);
+        sprintf(buffer, "mov [rbp-%d], r10", gen->var_offsets[gen->var_count - 1]);
+        codegen_emit(gen, buffer);
+        sprintf(buffer, "mov [rbp-%d], r11", gen->var_offsets[gen->var_count - 1] - 8);
+        codegen_emit(gen, buffer);
+    }
+    codegen_profile_entry(gen);
+    codegen_pgo_count(gen, 0);
+
+    ASTNode *body = node->children[1];
+    for (int i = 0; i < body->child_count; i++) {
+        codegen_statement(gen, body->children[i]);
+    }
+
+    fclose(gen->output);
+    gen->output = output;
+
+    gen->line = 0;
+    codegen_line(gen, node);
+    codegen_function_symbol(gen, node->value);
+    codegen_emit(gen, "push rbp");
+    codegen_emit(gen, "mov rbp, rsp");
+    if (codegen_frame_bytes(gen) > 0) {
+        sprintf(buffer, "sub rsp, %d", codegen_frame_bytes(gen));
+        codegen_emit(gen, buffer);
+    }
+    fwrite(text, 1, len, output);
+    free(text);
+
+    codegen_emit(gen, "mov rax, 0");
+    codegen_profile_exit(gen);
+    codegen_internal_restore(gen);
+    codegen_emit(gen, "mov rsp, rbp");
+    codegen_emit(gen, "pop rbp");
+    codegen_emit(gen, "ret");
+
+    fprintf(gen->output, ".end:\n\n");
+    codegen_flush_cold(gen);
+
+    codegen_profile_records(gen);
+    codegen_pgo_records(gen);
+    codegen_flush_deferred(gen);
+
+    gen->stack_offset = saved_stack_offset;
+    gen->var_count = saved_var_count;
+}
+
+// ==================== STDIN RUNTIME ====================
+// Lector de stdin con un buffer de 64 KiB: stdin_fill compacta lo pendiente
+// al inicio y lee un bloque nuevo. read_line devuelve la linea dentro del
+// propio buffer (terminada en 0 en lugar del '\n'); la busqueda del salto
+// de linea usa SSE2, 16 bytes por iteracion.
+
+#define STDIN_BUFFER_SIZE 65536
+
+void codegen_runtime_stdin(CodeGen *gen) {
+    char buffer[512];
+
+    fprintf(gen->output, "stdin_fill:\n");
+    codegen_emit(gen, "push rbp");
     codegen_emit(gen, "mov rbp, rsp");
+    codegen_emit(gen, "mov rcx, [rel stdin_len]");
+    codegen_emit(gen, "sub rcx, [rel stdin_pos]");
+    codegen_emit(gen, "lea rdi, [rel stdin_buffer]");
+    codegen_emit(gen, "mov rsi, rdi");
+    codegen_emit(gen, "add rsi, [rel stdin_pos]");
+    codegen_emit(gen, "mov [rel stdin_len], rcx");
+    codegen_emit(gen, "mov qword [rel stdin_pos], 0");
+    codegen_emit(gen, "cld");
+    codegen_emit(gen, "rep movsb");
+    fprintf(gen->output, ".read:\n");
+    sprintf(buffer, "mov rdx, %d", STDIN_BUFFER_SIZE);
+    codegen_emit(gen, buffer);
+    codegen_emit(gen, "sub rdx, [rel stdin_len]");
+    codegen_emit(gen, "jz .none");
+    codegen_emit(gen, "xor eax, eax");
+    codegen_emit(gen, "xor edi, edi");
+    codegen_emit(gen, "lea rsi, [rel stdin_buffer]");
+    codegen_emit(gen, "add rsi, [rel stdin_len]");
+    codegen_emit(gen, "syscall");
+    codegen_emit(gen, "cmp rax, -4");
+    codegen_emit(gen, "je .read");
+    codegen_emit(gen, "test rax, rax");
+    codegen_emit(gen, "jle .eof");
+    codegen_emit(gen, "add [rel stdin_len], rax");
+    codegen_emit(gen, "pop rbp");
+    codegen_emit(gen, "ret");
+    fprintf(gen->output, ".eof:\n");
+    codegen_emit(gen, "mov qword [rel stdin_eof], 1");
+    fprintf(gen->output, ".none:\n");
+    codegen_emit(gen, "xor eax, eax");
+    codegen_emit(gen, "pop rbp");
+    codegen_emit(gen, "ret\n");
+
+    // find_newline(rdi=ptr, rsi=len) -> rax = indice del '\n' o -1
+    fprintf(gen->output, "find_newline:\n");
+    codegen_emit(gen, "mov eax, 0x0a0a0a0a");
+    codegen_emit(gen, "movd xmm1, eax");
+    codegen_emit(gen, "pshufd xmm1, xmm1, 0");
+    codegen_emit(gen, "xor rcx, rcx");
+    fprintf(gen->output, ".block:\n");
+    codegen_emit(gen, "cmp rcx, rsi");
+    codegen_emit(gen, "jge .missing");
+    codegen_emit(gen, "movdqu xmm0, [rdi + rcx]");
+    codegen_emit(gen, "pcmpeqb xmm0, xmm1");
+    codegen_emit(gen, "pmovmskb eax, xmm0");
+    codegen_emit(gen, "test eax, eax");
+    codegen_emit(gen, "jnz .found");
+    codegen_emit(gen, "add rcx, 16");
+    codegen_emit(gen, "jmp .block");
+    fprintf(gen->output, ".found:\n");
+    codegen_emit(gen, "bsf eax, eax");
+    codegen_emit(gen, "add rax, rcx");
+    codegen_emit(gen, "cmp rax, rsi");
+    codegen_emit(gen, "jge .missing");
+    codegen_emit(gen, "ret");
+    fprintf(gen->output, ".missing:\n");
+    codegen_emit(gen, "mov rax, -1");
+    codegen_emit(gen, "ret\n");
+
+    fprintf(gen->output, "read_line:\n");
+    codegen_emit(gen, "push rbp");
+    codegen_emit(gen, "mov rbp, rsp");
+    codegen_emit(gen, "push rbx");
+    codegen_emit(gen, "xor rbx, rbx");
+    fprintf(gen->output, ".scan:\n");
+    codegen_emit(gen, "lea rdi, [rel stdin_buffer]");
+    codegen_emit(gen, "add rdi, [rel stdin_pos]");
+    codegen_emit(gen, "mov rsi, [rel stdin_len]");
+    codegen_emit(gen, "sub rsi, [rel stdin_pos]");
+    codegen_emit(gen, "sub rsi, rbx");
+    codegen_emit(gen, "add rdi, rbx");
+    codegen_emit(gen, "call find_newline");
+    codegen_emit(gen, "cmp rax, -1");
+    codegen_emit(gen, "je .more");
+    codegen_emit(gen, "add rax, rbx");
+    codegen_emit(gen, "add rax, [rel stdin_pos]");
+    codegen_emit(gen, "jmp .cut");
+    fprintf(gen->output, ".more:\n");
+    codegen_emit(gen, "mov rbx, [rel stdin_len]");
+    codegen_emit(gen, "sub rbx, [rel stdin_pos]");
+    codegen_emit(gen, "cmp qword [rel stdin_eof], 0");
+    codegen_emit(gen, "jne .last");
+    sprintf(buffer, "cmp rbx, %d", STDIN_BUFFER_SIZE);
+    codegen_emit(gen, buffer);
+    codegen_emit(gen, "je .last");
+    codegen_emit(gen, "call stdin_fill");
+    codegen_emit(gen, "jmp .scan");
+    fprintf(gen->output, ".last:\n");
+    codegen_emit(gen, "mov rax, [rel stdin_len]");
+    codegen_emit(gen, "lea rdi, [rel stdin_buffer]");
+    codegen_emit(gen, "mov byte [rdi + rax], 0");
+    codegen_emit(gen, "mov rdx, rax");
+    codegen_emit(gen, "jmp .done");
+    fprintf(gen->output, ".cut:\n");
+    codegen_emit(gen, "lea rdi, [rel stdin_buffer]");
+    codegen_emit(gen, "mov byte [rdi + rax], 0");
+    codegen_emit(gen, "lea rdx, [rax + 1]");
+    fprintf(gen->output, ".done:\n");
     codegen_emit(gen, "mov rax, rdi");
-    codegen_emit(gen, "mov rcx, 10");
-    codegen_emit(gen, "lea rsi, [rel digit_buffer]");
-    codegen_emit(gen, "add rsi, 9");
-    codegen_emit(gen, "mov qword [rel digit_count], 0");
+    codegen_emit(gen, "add rax, [rel stdin_pos]");
+    codegen_emit(gen, "mov [rel stdin_pos], rdx");
+    codegen_emit(gen, "pop rbx");
+    codegen_emit(gen, "pop rbp");
+    codegen_emit(gen, "ret\n");
 
+    fprintf(gen->output, "read_int:\n");
+    codegen_emit(gen, "push rbp");
+    codegen_emit(gen, "mov rbp, rsp");
+    codegen_emit(gen, "push rbx");
+    codegen_emit(gen, "push r12");
+    codegen_emit(gen, "xor rbx, rbx");
+    codegen_emit(gen, "xor r12, r12");
+    fprintf(gen->output, ".skip:\n");
+    codegen_emit(gen, "mov rcx, [rel stdin_pos]");
+    codegen_emit(gen, "cmp rcx, [rel stdin_len]");
+    codegen_emit(gen, "jl .skip_byte");
+    codegen_emit(gen, "call stdin_fill");
     codegen_emit(gen, "test rax, rax");
-    codegen_emit(gen, "jns .positive");
+    codegen_emit(gen, "jz .done");
+    codegen_emit(gen, "jmp .skip");
+    fprintf(gen->output, ".skip_byte:\n");
+    codegen_emit(gen, "lea rdx, [rel stdin_buffer]");
+    codegen_emit(gen, "movzx eax, byte [rdx + rcx]");
+    codegen_emit(gen, "cmp al, ' '");
+    codegen_emit(gen, "je .blank");
+    codegen_emit(gen, "cmp al, 9");
+    codegen_emit(gen, "jb .sign");
+    codegen_emit(gen, "cmp al, 13");
+    codegen_emit(gen, "ja .sign");
+    fprintf(gen->output, ".blank:\n");
+    codegen_emit(gen, "inc qword [rel stdin_pos]");
+    codegen_emit(gen, "jmp .skip");
+    fprintf(gen->output, ".sign:\n");
+    codegen_emit(gen, "cmp al, '-'");
+    codegen_emit(gen, "jne .digits");
+    codegen_emit(gen, "mov r12, 1");
+    codegen_emit(gen, "inc qword [rel stdin_pos]");
+    fprintf(gen->output, ".digits:\n");
+    codegen_emit(gen, "mov rcx, [rel stdin_pos]");
+    codegen_emit(gen, "mov rsi, [rel stdin_len]");
+    codegen_emit(gen, "lea rdx, [rel stdin_buffer]");
+    fprintf(gen->output, ".digit:\n");
+    codegen_emit(gen, "cmp rcx, rsi");
+    codegen_emit(gen, "jge .refill");
+    codegen_emit(gen, "movzx eax, byte [rdx + rcx]");
+    codegen_emit(gen, "sub eax, '0'");
+    codegen_emit(gen, "cmp eax, 9");
+    codegen_emit(gen, "ja .end");
+    codegen_emit(gen, "imul rbx, rbx, 10");
+    codegen_emit(gen, "add rbx, rax");
+    codegen_emit(gen, "inc rcx");
+    codegen_emit(gen, "jmp .digit");
+    fprintf(gen->output, ".refill:\n");
+    codegen_emit(gen, "mov [rel stdin_pos], rcx");
+    codegen_emit(gen, "call stdin_fill");
+    codegen_emit(gen, "test rax, rax");
+    codegen_emit(gen, "jnz .digits");
+    codegen_emit(gen, "jmp .done");
+    fprintf(gen->output, ".end:\n");
+    codegen_emit(gen, "mov [rel stdin_pos], rcx");
+    fprintf(gen->output, ".done:\n");
+    codegen_emit(gen, "mov rax, rbx");
+    codegen_emit(gen, "test r12, r12");
+    codegen_emit(gen, "jz .positive");
     codegen_emit(gen, "neg rax");
-    codegen_emit(gen, "push rax");
+    fprintf(gen->output, ".positive:\n");
+    codegen_emit(gen, "pop r12");
+    codegen_emit(gen, "pop rbx");
+    codegen_emit(gen, "pop rbp");
+    codegen_emit(gen, "ret\n");
+
+    // read_all: lo pendiente del buffer y el resto de stdin en una region
+    // mmap que crece con mremap; se lee directamente sobre ella.
+    fprintf(gen->output, "read_all:\n");
+    codegen_emit(gen, "push rbp");
+    codegen_emit(gen, "mov rbp, rsp");
+    codegen_emit(gen, "push rbx");
+    codegen_emit(gen, "push r12");
+    codegen_emit(gen, "push r13");
+    codegen_emit(gen, "mov r13, 1048576");
+    codegen_emit(gen, "mov rax, 9");
+    codegen_emit(gen, "xor rdi, rdi");
+    codegen_emit(gen, "mov rsi, r13");
+    codegen_emit(gen, "mov rdx, 3");
+    codegen_emit(gen, "mov r10, 0x22");
+    codegen_emit(gen, "mov r8, -1");
+    codegen_emit(gen, "xor r9, r9");
+    codegen_emit(gen, "syscall");
+    codegen_emit(gen, "test rax, rax");
+    codegen_emit(gen, "js .failed");
+    codegen_emit(gen, "mov rbx, rax");
+    codegen_emit(gen, "mov rcx, [rel stdin_len]");
+    codegen_emit(gen, "sub rcx, [rel stdin_pos]");
+    codegen_emit(gen, "mov r12, rcx");
+    codegen_emit(gen, "mov rdi, rbx");
+    codegen_emit(gen, "lea rsi, [rel stdin_buffer]");
+    codegen_emit(gen, "add rsi, [rel stdin_pos]");
+    codegen_emit(gen, "cld");
+    codegen_emit(gen, "rep movsb");
+    codegen_emit(gen, "mov rax, [rel stdin_len]");
+    codegen_emit(gen, "mov [rel stdin_pos], rax");
+    fprintf(gen->output, ".read:\n");
+    codegen_emit(gen, "cmp qword [rel stdin_eof], 0");
+    codegen_emit(gen, "jne .end");
+    codegen_emit(gen, "mov rdx, r13");
+    codegen_emit(gen, "sub rdx, r12");
+    codegen_emit(gen, "dec rdx");
+    codegen_emit(gen, "jnz .chunk");
+    codegen_emit(gen, "mov rax, 25");
+    codegen_emit(gen, "mov rdi, rbx");
+    codegen_emit(gen, "mov rsi, r13");
+    codegen_emit(gen, "lea rdx, [r13 + r13]");
+    codegen_emit(gen, "mov r10, 1");
+    codegen_emit(gen, "syscall");
+    codegen_emit(gen, "test rax, rax");
+    codegen_emit(gen, "js .end");
+    codegen_emit(gen, "mov rbx, rax");
+    codegen_emit(gen, "add r13, r13");
+    codegen_emit(gen, "jmp .read");
+    fprintf(gen->output, ".chunk:\n");
+    codegen_emit(gen, "xor eax, eax");
+    codegen_emit(gen, "xor edi, edi");
+    codegen_emit(gen, "lea rsi, [rbx + r12]");
+    codegen_emit(gen, "syscall");
+    codegen_emit(gen, "cmp rax, -4");
+    codegen_emit(gen, "je .read");
+    codegen_emit(gen, "test rax, rax");
+    codegen_emit(gen, "jle .eof");
+    codegen_emit(gen, "add r12, rax");
+    codegen_emit(gen, "jmp .read");
+    fprintf(gen->output, ".eof:\n");
+    codegen_emit(gen, "mov qword [rel stdin_eof], 1");
+    fprintf(gen->output, ".end:\n");
+    codegen_emit(gen, "mov byte [rbx + r12], 0");
+    codegen_emit(gen, "mov rax, rbx");
+    codegen_emit(gen, "jmp .done");
+    fprintf(gen->output, ".failed:\n");
+    codegen_emit(gen, "lea rax, [rel stdin_buffer]");
+    codegen_emit(gen, "add rax, [rel stdin_len]");
+    codegen_emit(gen, "mov byte [rax], 0");
+    fprintf(gen->output, ".done:\n");
+    codegen_emit(gen, "pop r13");
+    codegen_emit(gen, "pop r12");
+    codegen_emit(gen, "pop rbx");
+    codegen_emit(gen, "pop rbp");
+    codegen_emit(gen, "ret\n");
+
+    fprintf(gen->output, "stdin_at_eof:\n");
+    codegen_emit(gen, "mov rax, [rel stdin_pos]");
+    codegen_emit(gen, "cmp rax, [rel stdin_len]");
+    codegen_emit(gen, "jl .more");
+    codegen_emit(gen, "call stdin_fill");
+    codegen_emit(gen, "test rax, rax");
+    codegen_emit(gen, "jnz .more");
     codegen_emit(gen, "mov rax, 1");
-    codegen_emit(gen, "mov rdi, 1");
-    codegen_emit(gen, "lea rsi, [rel .minus]");
+    codegen_emit(gen, "ret");
+    fprintf(gen->output, ".more:\n");
+    codegen_emit(gen, "xor eax, eax");
+    codegen_emit(gen, "ret\n");
+}
+
+// ==================== FILE RUNTIME ====================
+// mmap_file(rdi=ruta) -> rax = mapeo de solo lectura, rdx = tamaño.
+// Se reserva una pagina anonima extra tras el fichero para que el mapeo
+// termine siempre en 0; rax = 0 si no se puede abrir. En B el resultado va
+// en un int y se lee con byte_at (en un string se copiaria).
+
+void codegen_runtime_file(CodeGen *gen) {
+    fprintf(gen->output, "mmap_file:\n");
+    codegen_emit(gen, "push rbp");
+    codegen_emit(gen, "mov rbp, rsp");
+    codegen_emit(gen, "push rbx");
+    codegen_emit(gen, "push r12");
+    codegen_emit(gen, "push r13");
+    codegen_emit(gen, "sub rsp, 152");
+    codegen_emit(gen, "mov rax, 2");
+    codegen_emit(gen, "xor rsi, rsi");
+    codegen_emit(gen, "syscall");
+    codegen_emit(gen, "test rax, rax");
+    codegen_emit(gen, "js .failed");
+    codegen_emit(gen, "mov rbx, rax");
+    codegen_emit(gen, "mov rax, 5");
+    codegen_emit(gen, "mov rdi, rbx");
+    codegen_emit(gen, "mov rsi, rsp");
+    codegen_emit(gen, "syscall");
+    codegen_emit(gen, "test rax, rax");
+    codegen_emit(gen, "js .close");
+    codegen_emit(gen, "mov r12, [rsp + 48]");
+    codegen_emit(gen, "mov rax, 9");
+    codegen_emit(gen, "xor rdi, rdi");
+    codegen_emit(gen, "lea rsi, [r12 + 4096]");
     codegen_emit(gen, "mov rdx, 1");
+    codegen_emit(gen, "mov r10, 0x22");
+    codegen_emit(gen, "mov r8, -1");
+    codegen_emit(gen, "xor r9, r9");
     codegen_emit(gen, "syscall");
-    codegen_emit(gen, "pop rax");
+    codegen_emit(gen, "test rax, rax");
+    codegen_emit(gen, "js .close");
+    codegen_emit(gen, "mov r13, rax");
+    codegen_emit(gen, "test r12, r12");
+    codegen_emit(gen, "jz .mapped");
+    codegen_emit(gen, "mov rax, 9");
+    codegen_emit(gen, "mov rdi, r13");
+    codegen_emit(gen, "mov rsi, r12");
+    codegen_emit(gen, "mov rdx, 1");
+    codegen_emit(gen, "mov r10, 0x12");
+    codegen_emit(gen, "mov r8, rbx");
+    codegen_emit(gen, "xor r9, r9");
+    codegen_emit(gen, "syscall");
+    codegen_emit(gen, "test rax, rax");
+    codegen_emit(gen, "js .unmap");
+    fprintf(gen->output, ".mapped:\n");
+    codegen_emit(gen, "mov rax, 3");
+    codegen_emit(gen, "mov rdi, rbx");
+    codegen_emit(gen, "syscall");
+    codegen_emit(gen, "mov rax, r13");
+    codegen_emit(gen, "mov rdx, r12");
+    codegen_emit(gen, "jmp .done");
+    // Falla el mapeo del fichero: se suelta la reserva anonima
+    fprintf(gen->output, ".unmap:\n");
+    codegen_emit(gen, "mov rax, 11");
+    codegen_emit(gen, "mov rdi, r13");
+    codegen_emit(gen, "lea rsi, [r12 + 4096]");
+    codegen_emit(gen, "syscall");
+    fprintf(gen->output, ".close:\n");
+    codegen_emit(gen, "mov rax, 3");
+    codegen_emit(gen, "mov rdi, rbx");
+    codegen_emit(gen, "syscall");
+    fprintf(gen->output, ".failed:\n");
+    codegen_emit(gen, "xor eax, eax");
+    codegen_emit(gen, "xor edx, edx");
+    fprintf(gen->output, ".done:\n");
+    codegen_emit(gen, "add rsp, 152");
+    codegen_emit(gen, "pop r13");
+    codegen_emit(gen, "pop r12");
+    codegen_emit(gen, "pop rbx");
+    codegen_emit(gen, "pop rbp");
+    codegen_emit(gen, "ret\n");
+}
 
-    fprintf(gen->output, ".positive:\n");
-    codegen_emit(gen, "xor r8, r8");
+// ==================== PARALLEL RUNTIME ====================
+// par_run(rdi=cuerpo, rsi=marco, rdx=n) reparte [0, n) en bloques que los
+// hilos toman con lock xadd; los trabajadores esperan en un futex sobre
+// par_gen y el hilo principal en par_pending hasta que todos terminan.
+
+#define PAR_MAX_THREADS 64
+#define PAR_STACK_SIZE (1 << 20)
 
-    fprintf(gen->output, ".convert_loop:\n");
+void codegen_runtime_parallel(CodeGen *gen) {
+    char buffer[512];
+
+    fprintf(gen->output, "par_run:\n");
+    codegen_emit(gen, "push rbp");
+    codegen_emit(gen, "mov rbp, rsp");
+    codegen_emit(gen, "test rdx, rdx");
+    codegen_emit(gen, "jle .done");
+    codegen_emit(gen, "cmp qword [rel par_active], 0");
+    codegen_emit(gen, "jne .serial");
+    codegen_emit(gen, "cmp qword [rel par_threads], 0");
+    codegen_emit(gen, "jne .ready");
+    codegen_emit(gen, "push rdi");
+    codegen_emit(gen, "push rsi");
+    codegen_emit(gen, "push rdx");
+    codegen_emit(gen, "call par_init");
+    codegen_emit(gen, "pop rdx");
+    codegen_emit(gen, "pop rsi");
+    codegen_emit(gen, "pop rdi");
+    fprintf(gen->output, ".ready:\n");
+    codegen_emit(gen, "cmp qword [rel par_threads], 1");
+    codegen_emit(gen, "je .serial");
+    codegen_emit(gen, "cmp rdx, 1");
+    codegen_emit(gen, "je .serial");
+    codegen_emit(gen, "mov [rel par_fn], rdi");
+    codegen_emit(gen, "mov [rel par_frame], rsi");
+    codegen_emit(gen, "mov [rel par_end], rdx");
+    codegen_emit(gen, "mov qword [rel par_next], 0");
+    codegen_emit(gen, "mov rax, rdx");
     codegen_emit(gen, "xor rdx, rdx");
+    codegen_emit(gen, "mov rcx, [rel par_threads]");
+    codegen_emit(gen, "shl rcx, 2");
     codegen_emit(gen, "div rcx");
-    codegen_emit(gen, "add dl, '0'");
-    codegen_emit(gen, "mov [rsi], dl");
-    codegen_emit(gen, "dec rsi");
-    codegen_emit(gen, "inc r8");
     codegen_emit(gen, "test rax, rax");
-    codegen_emit(gen, "jnz .convert_loop");
-
-    codegen_emit(gen, "inc rsi");
+    codegen_emit(gen, "jnz .chunk");
     codegen_emit(gen, "mov rax, 1");
-    codegen_emit(gen, "mov rdi, 1");
-    codegen_emit(gen, "mov rdx, r8");
+    fprintf(gen->output, ".chunk:\n");
+    codegen_emit(gen, "mov [rel par_chunk], rax");
+    codegen_emit(gen, "mov qword [rel par_active], 1");
+    codegen_emit(gen, "mov rax, [rel par_threads]");
+    codegen_emit(gen, "dec rax");
+    codegen_emit(gen, "mov [rel par_pending], eax");
+    codegen_emit(gen, "lock inc dword [rel par_gen]");
+    codegen_emit(gen, "mov rax, 202");
+    codegen_emit(gen, "lea rdi, [rel par_gen]");
+    codegen_emit(gen, "mov rsi, 129");
+    codegen_emit(gen, "mov rdx, 0x7fffffff");
     codegen_emit(gen, "syscall");
-
+    codegen_emit(gen, "call par_work");
+    fprintf(gen->output, ".join:\n");
+    codegen_emit(gen, "mov edx, [rel par_pending]");
+    codegen_emit(gen, "test edx, edx");
+    codegen_emit(gen, "jz .joined");
+    codegen_emit(gen, "mov rax, 202");
+    codegen_emit(gen, "lea rdi, [rel par_pending]");
+    codegen_emit(gen, "mov rsi, 128");
+    codegen_emit(gen, "xor r10, r10");
+    codegen_emit(gen, "syscall");
+    codegen_emit(gen, "jmp .join");
+    fprintf(gen->output, ".joined:\n");
+    codegen_emit(gen, "mov qword [rel par_active], 0");
+    codegen_emit(gen, "jmp .done");
+    fprintf(gen->output, ".serial:\n");
+    codegen_emit(gen, "mov rax, rdi");
+    codegen_emit(gen, "xchg rsi, rdx");
+    codegen_emit(gen, "xor rdi, rdi");
+    codegen_emit(gen, "call rax");
+    fprintf(gen->output, ".done:\n");
     codegen_emit(gen, "pop rbp");
-    codegen_emit(gen, "ret");
-    fprintf(gen->output, ".minus: db '-'\n\n");
+    codegen_emit(gen, "ret\n");
 
-    fprintf(gen->output, "print_str_no_nl:\n");
+    fprintf(gen->output, "par_work:\n");
     codegen_emit(gen, "push rbp");
     codegen_emit(gen, "mov rbp, rsp");
-    codegen_emit(gen, "mov rsi, rdi");
-    codegen_emit(gen, "xor rdx, rdx");
-
-    fprintf(gen->output, ".strlen:\n");
-    codegen_emit(gen, "cmp byte [rsi + rdx], 0");
-    codegen_emit(gen, "je .print");
-    codegen_emit(gen, "inc rdx");
-    codegen_emit(gen, "jmp .strlen");
+    fprintf(gen->output, ".next:\n");
+    codegen_emit(gen, "mov rax, [rel par_chunk]");
+    codegen_emit(gen, "lock xadd [rel par_next], rax");
+    codegen_emit(gen, "mov rsi, [rel par_end]");
+    codegen_emit(gen, "cmp rax, rsi");
+    codegen_emit(gen, "jge .done");
+    codegen_emit(gen, "mov rdi, rax");
+    codegen_emit(gen, "add rax, [rel par_chunk]");
+    codegen_emit(gen, "cmp rax, rsi");
+    codegen_emit(gen, "cmovl rsi, rax");
+    codegen_emit(gen, "mov rdx, [rel par_frame]");
+    codegen_emit(gen, "call qword [rel par_fn]");
+    codegen_emit(gen, "jmp .next");
+    fprintf(gen->output, ".done:\n");
+    codegen_emit(gen, "pop rbp");
+    codegen_emit(gen, "ret\n");
 
-    fprintf(gen->output, ".print:\n");
-    codegen_emit(gen, "mov rax, 1");
-    codegen_emit(gen, "mov rdi, 1");
+    // El hilo entra por jmp con rsp alineado a 16 (no hay direccion de
+    // retorno): se reservan 16 para que par_work reciba la pila alineada
+    fprintf(gen->output, "par_worker:\n");
+    codegen_emit(gen, "sub rsp, 16");
+    codegen_emit(gen, "mov dword [rsp], 0");
+    fprintf(gen->output, ".wait:\n");
+    codegen_emit(gen, "mov eax, [rel par_gen]");
+    codegen_emit(gen, "cmp eax, [rsp]");
+    codegen_emit(gen, "jne .run");
+    codegen_emit(gen, "mov rax, 202");
+    codegen_emit(gen, "lea rdi, [rel par_gen]");
+    codegen_emit(gen, "mov rsi, 128");
+    codegen_emit(gen, "mov edx, [rsp]");
+    codegen_emit(gen, "xor r10, r10");
     codegen_emit(gen, "syscall");
+    codegen_emit(gen, "jmp .wait");
+    fprintf(gen->output, ".run:\n");
+    codegen_emit(gen, "mov [rsp], eax");
+    codegen_emit(gen, "call par_work");
+    codegen_emit(gen, "lock dec dword [rel par_pending]");
+    codegen_emit(gen, "jnz .wait");
+    codegen_emit(gen, "mov rax, 202");
+    codegen_emit(gen, "lea rdi, [rel par_pending]");
+    codegen_emit(gen, "mov rsi, 129");
+    codegen_emit(gen, "mov rdx, 1");
+    codegen_emit(gen, "syscall");
+    codegen_emit(gen, "jmp .wait\n");
 
+    fprintf(gen->output, "par_init:\n");
+    codegen_emit(gen, "push rbp");
+    codegen_emit(gen, "mov rbp, rsp");
+    codegen_emit(gen, "push rbx");
+    codegen_emit(gen, "push r12");
+    codegen_emit(gen, "mov rax, 204");
+    codegen_emit(gen, "xor rdi, rdi");
+    codegen_emit(gen, "mov rsi, 128");
+    codegen_emit(gen, "lea rdx, [rel par_cpuset]");
+    codegen_emit(gen, "syscall");
+    codegen_emit(gen, "xor rbx, rbx");
+    codegen_emit(gen, "test rax, rax");
+    codegen_emit(gen, "jle .counted");
+    codegen_emit(gen, "shr rax, 3");
+    codegen_emit(gen, "lea rdi, [rel par_cpuset]");
+    codegen_emit(gen, "xor rcx, rcx");
+    fprintf(gen->output, ".count_word:\n");
+    codegen_emit(gen, "mov rdx, [rdi + rcx*8]");
+    fprintf(gen->output, ".count_bit:\n");
+    codegen_emit(gen, "test rdx, rdx");
+    codegen_emit(gen, "jz .word_done");
+    codegen_emit(gen, "lea r8, [rdx - 1]");
+    codegen_emit(gen, "and rdx, r8");
+    codegen_emit(gen, "inc rbx");
+    codegen_emit(gen, "jmp .count_bit");
+    fprintf(gen->output, ".word_done:\n");
+    codegen_emit(gen, "inc rcx");
+    codegen_emit(gen, "cmp rcx, rax");
+    codegen_emit(gen, "jl .count_word");
+    fprintf(gen->output, ".counted:\n");
+    codegen_emit(gen, "test rbx, rbx");
+    codegen_emit(gen, "jnz .some");
+    codegen_emit(gen, "mov rbx, 1");
+    fprintf(gen->output, ".some:\n");
+    sprintf(buffer, "cmp rbx, %d", PAR_MAX_THREADS);
+    codegen_emit(gen, buffer);
+    codegen_emit(gen, "jle .capped");
+    sprintf(buffer, "mov rbx, %d", PAR_MAX_THREADS);
+    codegen_emit(gen, buffer);
+    fprintf(gen->output, ".capped:\n");
+    codegen_emit(gen, "mov [rel par_threads], rbx");
+    codegen_emit(gen, "mov r12, 1");
+    fprintf(gen->output, ".spawn:\n");
+    codegen_emit(gen, "cmp r12, rbx");
+    codegen_emit(gen, "jge .spawned");
+    codegen_emit(gen, "mov rax, 9");
+    codegen_emit(gen, "xor rdi, rdi");
+    sprintf(buffer, "mov rsi, %d", PAR_STACK_SIZE);
+    codegen_emit(gen, buffer);
+    codegen_emit(gen, "mov rdx, 3");
+    codegen_emit(gen, "mov r10, 0x20022");
+    codegen_emit(gen, "mov r8, -1");
+    codegen_emit(gen, "xor r9, r9");
+    codegen_emit(gen, "syscall");
+    codegen_emit(gen, "test rax, rax");
+    codegen_emit(gen, "js .failed");
+    sprintf(buffer, "lea rsi, [rax + %d]", PAR_STACK_SIZE);
+    codegen_emit(gen, buffer);
+    codegen_emit(gen, "mov rax, 56");
+    codegen_emit(gen, "mov rdi, 0x50f00");
+    codegen_emit(gen, "xor rdx, rdx");
+    codegen_emit(gen, "xor r10, r10");
+    codegen_emit(gen, "xor r8, r8");
+    codegen_emit(gen, "syscall");
+    codegen_emit(gen, "test rax, rax");
+    codegen_emit(gen, "jz par_worker");
+    codegen_emit(gen, "js .failed");
+    codegen_emit(gen, "inc r12");
+    codegen_emit(gen, "jmp .spawn");
+    fprintf(gen->output, ".failed:\n");
+    codegen_emit(gen, "mov [rel par_threads], r12");
+    fprintf(gen->output, ".spawned:\n");
+    codegen_emit(gen, "pop r12");
+    codegen_emit(gen, "pop rbx");
     codegen_emit(gen, "pop rbp");
     codegen_emit(gen, "ret\n");
+}
 
-    fprintf(gen->output, "input:\n");
-    codegen_emit(gen, "push rbp");
-    codegen_emit(gen, "mov rbp, rsp");
-    codegen_emit(gen, "mov rax, 0");
-    codegen_emit(gen, "mov rdi, 0");
-    codegen_emit(gen, "lea rsi, [rel input_buffer]");
-    codegen_emit(gen, "mov rdx, 255");
+// ==================== SYNC RUNTIME ====================
+// mutex_lock/unlock: mutex de futex de tres estados (0 libre, 1 tomado,
+// 2 tomado con esperas); solo entra al kernel si hay contencion.
+// spin_lock/unlock: test-and-test-and-set con pause.
+
+void codegen_runtime_sync(CodeGen *gen) {
+    fprintf(gen->output, "mutex_lock:\n");
+    codegen_emit(gen, "xor eax, eax");
+    codegen_emit(gen, "mov ecx, 1");
+    codegen_emit(gen, "lock cmpxchg [rdi], ecx");
+    codegen_emit(gen, "jz .done");
+    fprintf(gen->output, ".contended:\n");
+    codegen_emit(gen, "mov eax, 2");
+    codegen_emit(gen, "xchg [rdi], eax");
+    codegen_emit(gen, "test eax, eax");
+    codegen_emit(gen, "jz .done");
+    codegen_emit(gen, "mov rax, 202");
+    codegen_emit(gen, "mov rsi, 128");
+    codegen_emit(gen, "mov rdx, 2");
+    codegen_emit(gen, "xor r10, r10");
     codegen_emit(gen, "syscall");
+    codegen_emit(gen, "jmp .contended");
+    fprintf(gen->output, ".done:\n");
+    codegen_emit(gen, "xor rax, rax");
+    codegen_emit(gen, "ret\n");
 
-    codegen_emit(gen, "dec rax");
-    codegen_emit(gen, "lea rdi, [rel input_buffer]");
-    codegen_emit(gen, "add rdi, rax");
-    codegen_emit(gen, "mov byte [rdi], 0");
+    fprintf(gen->output, "mutex_unlock:\n");
+    codegen_emit(gen, "lock dec dword [rdi]");
+    codegen_emit(gen, "jz .done");
+    codegen_emit(gen, "mov dword [rdi], 0");
+    codegen_emit(gen, "mov rax, 202");
+    codegen_emit(gen, "mov rsi, 129");
+    codegen_emit(gen, "mov rdx, 1");
+    codegen_emit(gen, "syscall");
+    fprintf(gen->output, ".done:\n");
+    codegen_emit(gen, "xor rax, rax");
+    codegen_emit(gen, "ret\n");
 
-    codegen_emit(gen, "lea rax, [rel input_buffer]");
-    codegen_emit(gen, "pop rbp");
+    fprintf(gen->output, "spin_lock:\n");
+    codegen_emit(gen, "mov rax, 1");
+    codegen_emit(gen, "xchg [rdi], rax");
+    codegen_emit(gen, "test rax, rax");
+    codegen_emit(gen, "jz .done");
+    fprintf(gen->output, ".spin:\n");
+    codegen_emit(gen, "pause");
+    codegen_emit(gen, "cmp qword [rdi], 0");
+    codegen_emit(gen, "jne .spin");
+    codegen_emit(gen, "jmp spin_lock");
+    fprintf(gen->output, ".done:\n");
     codegen_emit(gen, "ret\n");
 
-    fprintf(gen->output, "str_to_int:\n");
-    codegen_emit(gen, "push rbp");
-    codegen_emit(gen, "mov rbp, rsp");
+    fprintf(gen->output, "spin_unlock:\n");
+    codegen_emit(gen, "mov qword [rdi], 0");
     codegen_emit(gen, "xor rax, rax");
-    codegen_emit(gen, "xor rcx, rcx");
-    codegen_emit(gen, "mov r8, 10");
+    codegen_emit(gen, "ret\n");
+}
+
+// ==================== PROFILE RUNTIME ====================
+// prof_dump escribe el perfil plano al salir: funciones por ciclos propios
+// y bucles por iteraciones, de mayor a menor (seleccion repetida marcando
+// cada registro como impreso). Va a stderr, o al fichero de --profile=.
 
+#define PROF_LINE_SIZE 320
+
+void codegen_runtime_profile(CodeGen *gen) {
+    char buffer[512];
+
+    // prof_line(rbx=registro, r13=tipo, r14=ciclos propios totales, r15=fd)
+    fprintf(gen->output, "prof_line:\n");
+    codegen_emit(gen, "push r12");
+    codegen_emit(gen, "lea rdi, [rel prof_buffer]");
+    codegen_emit(gen, "mov al, ' '");
+    codegen_emit(gen, "mov rcx, 48");
+    codegen_emit(gen, "rep stosb");
+    codegen_emit(gen, "test r13, r13");
+    codegen_emit(gen, "jnz .loop");
+    // Porcentaje con dos decimales: self * 10000 / total
+    codegen_emit(gen, "mov rax, [rbx + 8]");
+    codegen_emit(gen, "mov rcx, 10000");
+    codegen_emit(gen, "mul rcx");
+    codegen_emit(gen, "cmp rdx, r14");
+    codegen_emit(gen, "jb .percent");
+    codegen_emit(gen, "xor eax, eax");
+    codegen_emit(gen, "xor edx, edx");
+    codegen_emit(gen, "jmp .split");
+    fprintf(gen->output, ".percent:\n");
+    codegen_emit(gen, "div r14");
+    fprintf(gen->output, ".split:\n");
+    codegen_emit(gen, "xor edx, edx");
+    codegen_emit(gen, "mov rcx, 100");
+    codegen_emit(gen, "div rcx");
+    codegen_emit(gen, "mov r12, rax");
+    codegen_emit(gen, "lea rdi, [rdx + 100]");
+    codegen_emit(gen, "lea rsi, [rel prof_buffer + 8]");
+    codegen_emit(gen, "call format_int");
+    codegen_emit(gen, "mov byte [rel prof_buffer + 5], '.'");
+    codegen_emit(gen, "mov byte [rel prof_buffer + 8], '%'");
+    codegen_emit(gen, "mov rdi, r12");
+    codegen_emit(gen, "lea rsi, [rel prof_buffer + 5]");
+    codegen_emit(gen, "call format_int");
+    codegen_emit(gen, "mov rdi, [rbx + 8]");
+    codegen_emit(gen, "lea rsi, [rel prof_buffer + 28]");
+    codegen_emit(gen, "call format_int");
+    codegen_emit(gen, "mov rdi, [rbx]");
+    codegen_emit(gen, "lea rsi, [rel prof_buffer + 44]");
+    codegen_emit(gen, "call format_int");
+    codegen_emit(gen, "mov rsi, 46");
+    codegen_emit(gen, "jmp .copy");
     fprintf(gen->output, ".loop:\n");
-    codegen_emit(gen, "movzx rdx, byte [rdi + rcx]");
-    codegen_emit(gen, "cmp dl, 0");
-    codegen_emit(gen, "je .done");
-    codegen_emit(gen, "cmp dl, '0'");
-    codegen_emit(gen, "jl .done");
-    codegen_emit(gen, "cmp dl, '9'");
-    codegen_emit(gen, "jg .done");
-    codegen_emit(gen, "sub dl, '0'");
-    codegen_emit(gen, "imul rax, r8");
-    codegen_emit(gen, "add rax, rdx");
+    codegen_emit(gen, "mov rdi, [rbx]");
+    codegen_emit(gen, "lea rsi, [rel prof_buffer + 28]");
+    codegen_emit(gen, "call format_int");
+    codegen_emit(gen, "mov rsi, 30");
+    fprintf(gen->output, ".copy:\n");
+    codegen_emit(gen, "lea rdi, [rel prof_buffer]");
+    codegen_emit(gen, "mov rcx, [rbx + 16]");
+    fprintf(gen->output, ".char:\n");
+    codegen_emit(gen, "mov al, [rcx]");
+    codegen_emit(gen, "test al, al");
+    codegen_emit(gen, "jz .write");
+    sprintf(buffer, "cmp rsi, %d", PROF_LINE_SIZE - 1);
+    codegen_emit(gen, buffer);
+    codegen_emit(gen, "jae .write");
+    codegen_emit(gen, "mov [rdi + rsi], al");
+    codegen_emit(gen, "inc rsi");
     codegen_emit(gen, "inc rcx");
-    codegen_emit(gen, "jmp .loop");
+    codegen_emit(gen, "jmp .char");
+    fprintf(gen->output, ".write:\n");
+    codegen_emit(gen, "mov byte [rdi + rsi], 10");
+    codegen_emit(gen, "lea rdx, [rsi + 1]");
+    codegen_emit(gen, "mov rsi, rdi");
+    codegen_emit(gen, "mov rdi, r15");
+    codegen_emit(gen, "mov rax, 1");
+    codegen_emit(gen, "syscall");
+    codegen_emit(gen, "pop r12");
+    codegen_emit(gen, "ret\n");
 
+    fprintf(gen->output, "prof_dump:\n");
+    codegen_emit(gen, "push rbx");
+    codegen_emit(gen, "push r12");
+    codegen_emit(gen, "push r13");
+    codegen_emit(gen, "push r14");
+    codegen_emit(gen, "push r15");
+    codegen_emit(gen, "mov r15, 2");
+    if (codegen_options.profile_path[0]) {
+        codegen_emit(gen, "lea rdi, [rel prof_path]");
+        codegen_emit(gen, "mov rsi, 0x241");
+        codegen_emit(gen, "mov rdx, 420");
+        codegen_emit(gen, "mov rax, 2");
+        codegen_emit(gen, "syscall");
+        codegen_emit(gen, "test rax, rax");
+        codegen_emit(gen, "js .total");
+        codegen_emit(gen, "mov r15, rax");
+    }
+    fprintf(gen->output, ".total:\n");
+    codegen_emit(gen, "xor r14, r14");
+    codegen_emit(gen, "lea rbx, [rel __start_bprof]");
+    fprintf(gen->output, ".sum:\n");
+    codegen_emit(gen, "lea rax, [rel __stop_bprof]");
+    codegen_emit(gen, "cmp rbx, rax");
+    codegen_emit(gen, "jae .summed");
+    codegen_emit(gen, "cmp qword [rbx + 24], 0");
+    codegen_emit(gen, "jne .sum_next");
+    codegen_emit(gen, "add r14, [rbx + 8]");
+    fprintf(gen->output, ".sum_next:\n");
+    sprintf(buffer, "add rbx, %d", PROF_RECORD_SIZE);
+    codegen_emit(gen, buffer);
+    codegen_emit(gen, "jmp .sum");
+    fprintf(gen->output, ".summed:\n");
+    codegen_emit(gen, "xor r13, r13");
+    fprintf(gen->output, ".kind:\n");
+    codegen_emit(gen, "lea rsi, [rel prof_head_functions]");
+    codegen_emit(gen, "mov rdx, prof_head_functions.len");
+    codegen_emit(gen, "test r13, r13");
+    codegen_emit(gen, "jz .head");
+    codegen_emit(gen, "lea rsi, [rel prof_head_loops]");
+    codegen_emit(gen, "mov rdx, prof_head_loops.len");
+    fprintf(gen->output, ".head:\n");
+    codegen_emit(gen, "mov rdi, r15");
+    codegen_emit(gen, "mov rax, 1");
+    codegen_emit(gen, "syscall");
+    // Siguiente registro sin imprimir de este tipo con la mayor clave
+    fprintf(gen->output, ".select:\n");
+    codegen_emit(gen, "xor r12, r12");
+    codegen_emit(gen, "lea rbx, [rel __start_bprof]");
+    fprintf(gen->output, ".scan:\n");
+    codegen_emit(gen, "lea rax, [rel __stop_bprof]");
+    codegen_emit(gen, "cmp rbx, rax");
+    codegen_emit(gen, "jae .scanned");
+    codegen_emit(gen, "cmp [rbx + 24], r13");
+    codegen_emit(gen, "jne .next");
+    codegen_emit(gen, "cmp qword [rbx + 32], 0");
+    codegen_emit(gen, "jne .next");
+    codegen_emit(gen, "cmp qword [rbx], 0");
+    codegen_emit(gen, "je .next");
+    codegen_emit(gen, "mov rax, [rbx]");
+    codegen_emit(gen, "test r13, r13");
+    codegen_emit(gen, "jnz .key");
+    codegen_emit(gen, "mov rax, [rbx + 8]");
+    fprintf(gen->output, ".key:\n");
+    codegen_emit(gen, "test r12, r12");
+    codegen_emit(gen, "jz .take");
+    codegen_emit(gen, "cmp rax, r9");
+    codegen_emit(gen, "jbe .next");
+    fprintf(gen->output, ".take:\n");
+    codegen_emit(gen, "mov r12, rbx");
+    codegen_emit(gen, "mov r9, rax");
+    fprintf(gen->output, ".next:\n");
+    sprintf(buffer, "add rbx, %d", PROF_RECORD_SIZE);
+    codegen_emit(gen, buffer);
+    codegen_emit(gen, "jmp .scan");
+    fprintf(gen->output, ".scanned:\n");
+    codegen_emit(gen, "test r12, r12");
+    codegen_emit(gen, "jz .kind_done");
+    codegen_emit(gen, "mov qword [r12 + 32], 1");
+    codegen_emit(gen, "mov rbx, r12");
+    codegen_emit(gen, "call prof_line");
+    codegen_emit(gen, "jmp .select");
+    fprintf(gen->output, ".kind_done:\n");
+    codegen_emit(gen, "inc r13");
+    codegen_emit(gen, "cmp r13, 2");
+    codegen_emit(gen, "jb .kind");
+    codegen_emit(gen, "cmp r15, 2");
+    codegen_emit(gen, "je .done");
+    codegen_emit(gen, "mov rdi, r15");
+    codegen_emit(gen, "mov rax, 3");
+    codegen_emit(gen, "syscall");
     fprintf(gen->output, ".done:\n");
-    codegen_emit(gen, "pop rbp");
+    codegen_emit(gen, "pop r15");
+    codegen_emit(gen, "pop r14");
+    codegen_emit(gen, "pop r13");
+    codegen_emit(gen, "pop r12");
+    codegen_emit(gen, "pop rbx");
     codegen_emit(gen, "ret\n");
+}
 
-    fprintf(gen->output, "strcpy_internal:\n");
-    codegen_emit(gen, "push rbp");
-    codegen_emit(gen, "mov rbp, rsp");
-    codegen_emit(gen, "xor rcx, rcx");
+// pgo_dump añade al fichero de --profile-generate una linea por contador:
+// el nombre de la cabecera (funcion y checksum), el indice y el valor.
+// pgo_append(rdi=valor, r13=cursor) escribe el numero y avanza r13.
+void codegen_runtime_pgo(CodeGen *gen) {
+    fprintf(gen->output, "pgo_append:\n");
+    codegen_emit(gen, "lea rsi, [rel pgo_digits + 24]");
+    codegen_emit(gen, "call format_int");
+    codegen_emit(gen, "mov rsi, rax");
+    codegen_emit(gen, "mov rdi, r13");
+    codegen_emit(gen, "mov rcx, rdx");
+    codegen_emit(gen, "rep movsb");
+    codegen_emit(gen, "mov r13, rdi");
+    codegen_emit(gen, "ret\n");
 
-    fprintf(gen->output, ".copy_loop:\n");
-    codegen_emit(gen, "mov al, byte [rsi + rcx]");
-    codegen_emit(gen, "mov byte [rdi + rcx], al");
+    fprintf(gen->output, "pgo_dump:\n");
+    codegen_emit(gen, "push rbx");
+    codegen_emit(gen, "push r12");
+    codegen_emit(gen, "push r13");
+    codegen_emit(gen, "push r14");
+    codegen_emit(gen, "lea rdi, [rel pgo_path]");
+    codegen_emit(gen, "mov rsi, 0x441");
+    codegen_emit(gen, "mov rdx, 420");
+    codegen_emit(gen, "mov rax, 2");
+    codegen_emit(gen, "syscall");
+    codegen_emit(gen, "test rax, rax");
+    codegen_emit(gen, "js .done");
+    codegen_emit(gen, "mov r14, rax");
+    codegen_emit(gen, "lea rbx, [rel __start_bpgo]");
+    fprintf(gen->output, ".record:\n");
+    codegen_emit(gen, "lea rax, [rel __stop_bpgo]");
+    codegen_emit(gen, "cmp rbx, rax");
+    codegen_emit(gen, "jae .close");
+    codegen_emit(gen, "xor r12, r12");
+    fprintf(gen->output, ".counter:\n");
+    codegen_emit(gen, "cmp r12, [rbx]");
+    codegen_emit(gen, "jae .next");
+    codegen_emit(gen, "lea rdi, [rel pgo_buffer]");
+    codegen_emit(gen, "mov rsi, [rbx + 8]");
+    fprintf(gen->output, ".name:\n");
+    codegen_emit(gen, "mov al, [rsi]");
     codegen_emit(gen, "test al, al");
-    codegen_emit(gen, "je .copy_done");
-    codegen_emit(gen, "inc rcx");
-    codegen_emit(gen, "jmp .copy_loop");
-
-    fprintf(gen->output, ".copy_done:\n");
-    codegen_emit(gen, "pop rbp");
+    codegen_emit(gen, "jz .values");
+    codegen_emit(gen, "mov [rdi], al");
+    codegen_emit(gen, "inc rdi");
+    codegen_emit(gen, "inc rsi");
+    codegen_emit(gen, "jmp .name");
+    fprintf(gen->output, ".values:\n");
+    codegen_emit(gen, "mov r13, rdi");
+    codegen_emit(gen, "mov rdi, r12");
+    codegen_emit(gen, "call pgo_append");
+    codegen_emit(gen, "mov byte [r13], ' '");
+    codegen_emit(gen, "inc r13");
+    codegen_emit(gen, "mov rdi, [rbx + 16 + r12*8]");
+    codegen_emit(gen, "call pgo_append");
+    codegen_emit(gen, "mov byte [r13], 10");
+    codegen_emit(gen, "inc r13");
+    codegen_emit(gen, "mov rdi, r14");
+    codegen_emit(gen, "lea rsi, [rel pgo_buffer]");
+    codegen_emit(gen, "mov rdx, r13");
+    codegen_emit(gen, "sub rdx, rsi");
+    codegen_emit(gen, "mov rax, 1");
+    codegen_emit(gen, "syscall");
+    codegen_emit(gen, "inc r12");
+    codegen_emit(gen, "jmp .counter");
+    fprintf(gen->output, ".next:\n");
+    codegen_emit(gen, "lea rbx, [rbx + 16 + r12*8]");
+    codegen_emit(gen, "jmp .record");
+    fprintf(gen->output, ".close:\n");
+    codegen_emit(gen, "mov rdi, r14");
+    codegen_emit(gen, "mov rax, 3");
+    codegen_emit(gen, "syscall");
+    fprintf(gen->output, ".done:\n");
+    codegen_emit(gen, "pop r14");
+    codegen_emit(gen, "pop r13");
+    codegen_emit(gen, "pop r12");
+    codegen_emit(gen, "pop rbx");
     codegen_emit(gen, "ret\n");
+}
+
+void codegen_profile_string(FILE *output, const char *label, const char *text) {
+    fprintf(output, "%s: db ", label);
+    for (const char *s = text; *s; s++) {
+        fprintf(output, "%d, ", (unsigned char)*s);
+    }
+    fprintf(output, "0\n");
+    fprintf(output, "%s.len equ %d\n", label, (int)strlen(text));
+}
+
+void codegen_profile_data(CodeGen *gen) {
+    fprintf(gen->output, "\nsection .rodata\n");
+    codegen_profile_string(gen->output, "prof_head_functions",
+        "\nFlat profile (self time):\n"
+        "        %        self cycles           calls  function\n");
+    codegen_profile_string(gen->output, "prof_head_loops",
+        "\nLoop iterations:\n"
+        "                  iterations  loop\n");
+    codegen_profile_string(gen->output, "prof_path", codegen_options.profile_path);
+}
+
+// ==================== FUNCTION WORKERS ====================
+// Cada funcion se genera en su propio buffer, con una copia del CodeGen y
+// etiquetas .L locales a la funcion, repartidas entre varios hilos. Los
+// buffers se escriben despues en el orden del fuente. Los literales se
+// registran antes en orden del AST, asi los str.N no dependen de que hilo
+// llegue primero.
+
+typedef struct {
+    CodeGen *gen;
+    ASTNode **functions;
+    char **texts;
+    size_t *lengths;
+    int count;
+    int next;
+    long instruction_count;
+} FunctionJobs;
+
+void codegen_collect_strings(ASTNode *node, StringPool *strings) {
+    if (!node) return;
+    if (node->type == AST_STRING) string_pool_intern(strings, node->value);
+    codegen_collect_strings(node->left, strings);
+    codegen_collect_strings(node->right, strings);
+    for (int i = 0; i < node->child_count; i++) {
+        codegen_collect_strings(node->children[i], strings);
+    }
+}
+
+void* codegen_function_worker(void *arg) {
+    FunctionJobs *jobs = (FunctionJobs*)arg;
+    CodeGen *gen = (CodeGen*)malloc(sizeof(CodeGen));
+    for (;;) {
+        int i = __atomic_fetch_add(&jobs->next, 1, __ATOMIC_RELAXED);
+        if (i >= jobs->count) break;
+        memcpy(gen, jobs->gen, sizeof(CodeGen));
+        gen->label_count = 0;
+        gen->deferred = NULL;
+        gen->deferred_count = 0;
+        gen->instruction_count = 0;
+        gen->output = open_memstream(&jobs->texts[i], &jobs->lengths[i]);
+        codegen_function(gen, jobs->functions[i]);
+        fclose(gen->output);
+        __atomic_fetch_add(&jobs->instruction_count, gen->instruction_count, __ATOMIC_RELAXED);
+    }
+    free(gen);
+    return NULL;
+}
+
+void codegen_functions(CodeGen *gen, ASTNode *program) {
+    FunctionJobs jobs;
+    jobs.gen = gen;
+    jobs.functions = (ASTNode**)malloc(program->child_count * sizeof(ASTNode*));
+    jobs.count = 0;
+    jobs.next = 0;
+    jobs.instruction_count = 0;
+    for (int i = 0; i < program->child_count; i++) {
+        if (program->children[i]->type == AST_FUNCTION) {
+            jobs.functions[jobs.count++] = program->children[i];
+            codegen_collect_strings(program->children[i], gen->strings);
+        }
+    }
+    jobs.texts = (char**)calloc(jobs.count, sizeof(char*));
+    jobs.lengths = (size_t*)calloc(jobs.count, sizeof(size_t));
+
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > jobs.count / 16) threads = jobs.count / 16;
+    if (threads <= 1) {
+        codegen_function_worker(&jobs);
+    } else {
+        pthread_t *workers = (pthread_t*)malloc(threads * sizeof(pthread_t));
+        for (int i = 0; i < threads; i++) {
+            pthread_create(&workers[i], NULL, codegen_function_worker, &jobs);
+        }
+        for (int i = 0; i < threads; i++) {
+            pthread_join(workers[i], NULL);
+        }
+        free(workers);
+    }
+
+    gen->instruction_count += jobs.instruction_count;
+    for (int i = 0; i < jobs.count; i++) {
+        fwrite(jobs.texts[i], 1, jobs.lengths[i], gen->output);
+        free(jobs.texts[i]);
+    }
+    free(jobs.texts);
+    free(jobs.lengths);
+    free(jobs.functions);
+}
+
+// ==================== SYMBOLS ====================
+// Cada modulo importado se ensambla en su propio objeto: las funciones son
+// globales, y lo que un modulo usa sin definir (otras funciones o rutinas
+// del runtime, que solo viven en el objeto principal) se declara extern.
+
+// Unidades del runtime: cada una se emite entera o no se emite
+#define RUNTIME_FORMAT_INT (1 << 0)
+#define RUNTIME_STR_LEN    (1 << 1)
+#define RUNTIME_WRITE_IOV  (1 << 2)
+#define RUNTIME_PRINT_STR  (1 << 3)
+#define RUNTIME_STR_TO_INT (1 << 4)
+#define RUNTIME_STRCPY     (1 << 5)
+#define RUNTIME_STDIN      (1 << 6)
+#define RUNTIME_FILE       (1 << 7)
+#define RUNTIME_PARALLEL   (1 << 8)
+#define RUNTIME_SYNC       (1 << 9)
+#define RUNTIME_PROFILE    (1 << 10)
+#define RUNTIME_PGO        (1 << 11)
+#define RUNTIME_ALL        ((1 << 12) - 1)
+#define RUNTIME_OPTIONAL   (RUNTIME_PROFILE | RUNTIME_PGO)
+
+typedef struct {
+    const char *name;
+    int unit;
+} RuntimeSymbol;
+
+const RuntimeSymbol runtime_symbols[] = {
+    {"format_int", RUNTIME_FORMAT_INT}, {"str_len", RUNTIME_STR_LEN},
+    {"write_iov", RUNTIME_WRITE_IOV}, {"print_str_no_nl", RUNTIME_PRINT_STR},
+    {"str_to_int", RUNTIME_STR_TO_INT}, {"strcpy_internal", RUNTIME_STRCPY},
+    {"read_line", RUNTIME_STDIN}, {"read_int", RUNTIME_STDIN}, {"read_all", RUNTIME_STDIN},
+    {"stdin_at_eof", RUNTIME_STDIN}, {"mmap_file", RUNTIME_FILE}, {"par_run", RUNTIME_PARALLEL},
+    {"mutex_lock", RUNTIME_SYNC}, {"mutex_unlock", RUNTIME_SYNC}, {"spin_lock", RUNTIME_SYNC},
+    {"spin_unlock", RUNTIME_SYNC}, {"prof_dump", RUNTIME_PROFILE},
+    {"pgo_dump", RUNTIME_PGO}, {NULL, 0}
+};
+
+// Rutinas que emite el objeto principal; el tree shaking deja solo las usadas
+int codegen_runtime_units = RUNTIME_ALL & ~RUNTIME_OPTIONAL;
+
+const char *builtin_names[] = {
+    "exit", "print", "input", "str_to_int", "read_line", "read_int",
+    "read_all", "eof", "open", "close", "read", "write", "mmap_file",
+    "byte_at", "atomic_add", "atomic_cas", "atomic_load", "atomic_store",
+    "mutex_lock", "mutex_unlock", "spin_lock", "spin_unlock", NULL
+};
+
+int codegen_is_builtin(const char *name) {
+    for (int i = 0; builtin_names[i]; i++) {
+        if (strcmp(builtin_names[i], name) == 0) return 1;
+    }
+    return 0;
+}
+
+void codegen_collect_calls(ASTNode *node, StringPool *calls) {
+    if (!node) return;
+    if (node->type == AST_CALL && !codegen_is_builtin(node->value)) {
+        string_pool_intern(calls, node->value);
+    }
+    codegen_collect_calls(node->left, calls);
+    codegen_collect_calls(node->right, calls);
+    for (int i = 0; i < node->child_count; i++) {
+        codegen_collect_calls(node->children[i], calls);
+    }
+}
+
+// Unidades del runtime que usa el codigo de node
+int codegen_runtime_uses(ASTNode *node) {
+    if (!node) return 0;
+    int units = 0;
+    if (node->type == AST_CALL) {
+        const char *name = node->value;
+        if (strcmp(name, "print") == 0) {
+            units |= RUNTIME_FORMAT_INT | RUNTIME_STR_LEN | RUNTIME_WRITE_IOV;
+        } else if (strcmp(name, "input") == 0) {
+            units |= RUNTIME_PRINT_STR | RUNTIME_STDIN;
+        } else if (strcmp(name, "read_line") == 0 || strcmp(name, "read_int") == 0 ||
+                   strcmp(name, "read_all") == 0 || strcmp(name, "eof") == 0) {
+            units |= RUNTIME_STDIN;
+        } else if (strcmp(name, "str_to_int") == 0) {
+            units |= RUNTIME_STR_TO_INT;
+        } else if (strcmp(name, "mmap_file") == 0) {
+            units |= RUNTIME_FILE;
+        } else if (strncmp(name, "mutex_", 6) == 0 || strncmp(name, "spin_", 5) == 0) {
+            units |= RUNTIME_SYNC;
+        }
+    } else if (node->type == AST_VAR_DECL && strcmp(node->left->value, "string") == 0) {
+        units |= RUNTIME_STRCPY;
+    } else if (node->type == AST_PARALLEL_LOOP) {
+        units |= RUNTIME_PARALLEL;
+    }
+    units |= codegen_runtime_uses(node->left) | codegen_runtime_uses(node->right);
+    for (int i = 0; i < node->child_count; i++) {
+        units |= codegen_runtime_uses(node->children[i]);
+    }
+    return units;
+}
+
+void codegen_declare_externs(CodeGen *gen, ASTNode *program) {
+    StringPool *defined = string_pool_create();
+    StringPool *calls = string_pool_create();
+    for (int i = 0; i < program->child_count; i++) {
+        if (program->children[i]->type == AST_FUNCTION) {
+            string_pool_intern(defined, program->children[i]->value);
+            codegen_collect_calls(program->children[i], calls);
+        }
+    }
+    for (int i = 0; i < calls->count; i++) {
+        if (string_pool_find(defined, calls->values[i]) < 0) {
+            fprintf(gen->output, "extern %s\n", calls->values[i]);
+        }
+    }
+    fprintf(gen->output, "\n");
+    string_pool_free(defined);
+    string_pool_free(calls);
+}
+
+// Emite las rutinas del runtime indicadas en units
+void codegen_runtime(CodeGen *gen, int units) {
+    if (units & RUNTIME_FORMAT_INT) {
+        // format_int(rdi=valor, rsi=fin del buffer) -> rax = inicio, rdx = longitud
+        fprintf(gen->output, "format_int:\n");
+        codegen_emit(gen, "mov rax, rdi");
+        codegen_emit(gen, "mov r8, rsi");
+        codegen_emit(gen, "mov rcx, 10");
+        codegen_emit(gen, "test rax, rax");
+        codegen_emit(gen, "jns .convert");
+        codegen_emit(gen, "neg rax");
+        fprintf(gen->output, ".convert:\n");
+        codegen_emit(gen, "xor edx, edx");
+        codegen_emit(gen, "div rcx");
+        codegen_emit(gen, "add dl, '0'");
+        codegen_emit(gen, "dec rsi");
+        codegen_emit(gen, "mov [rsi], dl");
+        codegen_emit(gen, "test rax, rax");
+        codegen_emit(gen, "jnz .convert");
+        codegen_emit(gen, "test rdi, rdi");
+        codegen_emit(gen, "jns .done");
+        codegen_emit(gen, "dec rsi");
+        codegen_emit(gen, "mov byte [rsi], '-'");
+        fprintf(gen->output, ".done:\n");
+        codegen_emit(gen, "mov rax, rsi");
+        codegen_emit(gen, "mov rdx, r8");
+        codegen_emit(gen, "sub rdx, rsi");
+        codegen_emit(gen, "ret\n");
+    }
+
+    if (units & RUNTIME_STR_LEN) {
+        fprintf(gen->output, "str_len:\n");
+        codegen_emit(gen, "xor eax, eax");
+        fprintf(gen->output, ".scan:\n");
+        codegen_emit(gen, "cmp byte [rdi + rax], 0");
+        codegen_emit(gen, "je .done");
+        codegen_emit(gen, "inc rax");
+        codegen_emit(gen, "jmp .scan");
+        fprintf(gen->output, ".done:\n");
+        codegen_emit(gen, "ret\n");
+    }
+
+    if (units & RUNTIME_WRITE_IOV) {
+        // write_iov(rdi=iovec, rsi=n): writev a stdout, reintentando tras
+        // escrituras parciales y en bloques de como mucho 1024 entradas.
+        fprintf(gen->output, "write_iov:\n");
+        codegen_emit(gen, "push rbx");
+        codegen_emit(gen, "push r12");
+        codegen_emit(gen, "mov rbx, rdi");
+        codegen_emit(gen, "mov r12, rsi");
+        fprintf(gen->output, ".again:\n");
+        codegen_emit(gen, "test r12, r12");
+        codegen_emit(gen, "jz .done");
+        codegen_emit(gen, "mov rdx, r12");
+        codegen_emit(gen, "cmp rdx, 1024");
+        codegen_emit(gen, "jbe .write");
+        codegen_emit(gen, "mov rdx, 1024");
+        fprintf(gen->output, ".write:\n");
+        codegen_emit(gen, "mov rax, 20");
+        codegen_emit(gen, "mov rdi, 1");
+        codegen_emit(gen, "mov rsi, rbx");
+        codegen_emit(gen, "syscall");
+        codegen_emit(gen, "cmp rax, -4");
+        codegen_emit(gen, "je .again");
+        codegen_emit(gen, "test rax, rax");
+        codegen_emit(gen, "js .done");
+        fprintf(gen->output, ".consume:\n");
+        codegen_emit(gen, "test r12, r12");
+        codegen_emit(gen, "jz .done");
+        codegen_emit(gen, "mov rcx, [rbx + 8]");
+        codegen_emit(gen, "cmp rax, rcx");
+        codegen_emit(gen, "jb .partial");
+        codegen_emit(gen, "sub rax, rcx");
+        codegen_emit(gen, "add rbx, 16");
+        codegen_emit(gen, "dec r12");
+        codegen_emit(gen, "jmp .consume");
+        fprintf(gen->output, ".partial:\n");
+        codegen_emit(gen, "add [rbx], rax");
+        codegen_emit(gen, "sub [rbx + 8], rax");
+        codegen_emit(gen, "jmp .again");
+        fprintf(gen->output, ".done:\n");
+        codegen_emit(gen, "pop r12");
+        codegen_emit(gen, "pop rbx");
+        codegen_emit(gen, "ret\n");
+    }
+
+    if (units & RUNTIME_PRINT_STR) {
+        fprintf(gen->output, "print_str_no_nl:\n");
+        codegen_emit(gen, "push rbp");
+        codegen_emit(gen, "mov rbp, rsp");
+        codegen_emit(gen, "mov rsi, rdi");
+        codegen_emit(gen, "xor rdx, rdx");
+
+        fprintf(gen->output, ".strlen:\n");
+        codegen_emit(gen, "cmp byte [rsi + rdx], 0");
+        codegen_emit(gen, "je .print");
+        codegen_emit(gen, "inc rdx");
+        codegen_emit(gen, "jmp .strlen");
+
+        fprintf(gen->output, ".print:\n");
+        codegen_emit(gen, "mov rax, 1");
+        codegen_emit(gen, "mov rdi, 1");
+        codegen_emit(gen, "syscall");
+
+        codegen_emit(gen, "pop rbp");
+        codegen_emit(gen, "ret\n");
+    }
+
+    if (units & RUNTIME_STR_TO_INT) {
+        fprintf(gen->output, "str_to_int:\n");
+        codegen_emit(gen, "push rbp");
+        codegen_emit(gen, "mov rbp, rsp");
+        codegen_emit(gen, "xor rax, rax");
+        codegen_emit(gen, "xor rcx, rcx");
+        codegen_emit(gen, "mov r8, 10");
+
+        fprintf(gen->output, ".loop:\n");
+        codegen_emit(gen, "movzx rdx, byte [rdi + rcx]");
+        codegen_emit(gen, "cmp dl, 0");
+        codegen_emit(gen, "je .done");
+        codegen_emit(gen, "cmp dl, '0'");
+        codegen_emit(gen, "jl .done");
+        codegen_emit(gen, "cmp dl, '9'");
+        codegen_emit(gen, "jg .done");
+        codegen_emit(gen, "sub dl, '0'");
+        codegen_emit(gen, "imul rax, r8");
+        codegen_emit(gen, "add rax, rdx");
+        codegen_emit(gen, "inc rcx");
+        codegen_emit(gen, "jmp .loop");
+
+        fprintf(gen->output, ".done:\n");
+        codegen_emit(gen, "pop rbp");
+        codegen_emit(gen, "ret\n");
+    }
+
+    if (units & RUNTIME_STRCPY) {
+        fprintf(gen->output, "strcpy_internal:\n");
+        codegen_emit(gen, "push rbp");
+        codegen_emit(gen, "mov rbp, rsp");
+        codegen_emit(gen, "xor rcx, rcx");
+
+        fprintf(gen->output, ".copy_loop:\n");
+        codegen_emit(gen, "cmp rcx, 255");
+        codegen_emit(gen, "je .copy_limit");
+        codegen_emit(gen, "mov al, byte [rsi + rcx]");
+        codegen_emit(gen, "mov byte [rdi + rcx], al");
+        codegen_emit(gen, "test al, al");
+        codegen_emit(gen, "je .copy_done");
+        codegen_emit(gen, "inc rcx");
+        codegen_emit(gen, "jmp .copy_loop");
+
+        fprintf(gen->output, ".copy_limit:\n");
+        codegen_emit(gen, "mov byte [rdi + rcx], 0");
+        fprintf(gen->output, ".copy_done:\n");
+        codegen_emit(gen, "pop rbp");
+        codegen_emit(gen, "ret\n");
+    }
+
+    if (units & RUNTIME_STDIN) codegen_runtime_stdin(gen);
+    if (units & RUNTIME_FILE) codegen_runtime_file(gen);
+    if (units & RUNTIME_PARALLEL) codegen_runtime_parallel(gen);
+    if (units & RUNTIME_SYNC) codegen_runtime_sync(gen);
+    if (units & RUNTIME_PROFILE) codegen_runtime_profile(gen);
+    if (units & RUNTIME_PGO) codegen_runtime_pgo(gen);
+}
+
+// Objeto de un modulo importado: solo sus funciones y sus literales
+void codegen_module(CodeGen *gen, ASTNode *node) {
+    fprintf(gen->output, "section .text\n");
+    int units = codegen_options.profile ? RUNTIME_PROFILE : 0;
+    if (codegen_options.pgo_generate) units |= RUNTIME_PGO;
+    for (int i = 0; i < node->child_count; i++) {
+        if (node->children[i]->type == AST_FUNCTION) units |= codegen_runtime_uses(node->children[i]);
+    }
+    for (int i = 0; runtime_symbols[i].name; i++) {
+        if (units & runtime_symbols[i].unit) {
+            fprintf(gen->output, "extern %s\n", runtime_symbols[i].name);
+        }
+    }
+    codegen_declare_externs(gen, node);
+    codegen_functions(gen, node);
+
+    string_pool_emit(gen->strings, gen->output);
+}
+
+void codegen_program(CodeGen *gen, ASTNode *node) {
+    int units = codegen_runtime_units;
+    if (codegen_options.profile) units |= RUNTIME_PROFILE | RUNTIME_FORMAT_INT;
+    if (codegen_options.pgo_generate) units |= RUNTIME_PGO | RUNTIME_FORMAT_INT;
+
+    fprintf(gen->output, "section .data\n");
+    fprintf(gen->output, "    newline db 10\n\n");
+
+    fprintf(gen->output, "section .bss\n");
+    if (units & RUNTIME_PARALLEL) {
+        fprintf(gen->output, "    par_threads resq 1\n");
+        fprintf(gen->output, "    par_active resq 1\n");
+        fprintf(gen->output, "    par_fn resq 1\n");
+        fprintf(gen->output, "    par_frame resq 1\n");
+        fprintf(gen->output, "    par_next resq 1\n");
+        fprintf(gen->output, "    par_end resq 1\n");
+        fprintf(gen->output, "    par_chunk resq 1\n");
+        fprintf(gen->output, "    par_gen resd 1\n");
+        fprintf(gen->output, "    par_pending resd 1\n");
+        fprintf(gen->output, "    par_cpuset resq 16\n");
+    }
+    if (units & RUNTIME_STDIN) {
+        fprintf(gen->output, "    stdin_pos resq 1\n");
+        fprintf(gen->output, "    stdin_len resq 1\n");
+        fprintf(gen->output, "    stdin_eof resq 1\n");
+        fprintf(gen->output, "    stdin_buffer resb %d\n", STDIN_BUFFER_SIZE + 32);
+    }
+    if (codegen_options.profile) {
+        fprintf(gen->output, "    prof_root resq 2\n");
+        fprintf(gen->output, "    prof_buffer resb %d\n", PROF_LINE_SIZE);
+    }
+    if (codegen_options.pgo_generate) {
+        fprintf(gen->output, "    pgo_buffer resb %d\n", PROF_LINE_SIZE);
+        fprintf(gen->output, "    pgo_digits resb 24\n");
+    }
+    fprintf(gen->output, "\n");
+
+    fprintf(gen->output, "section .text\n");
+    fprintf(gen->output, "global _start\n");
+    for (int i = 0; runtime_symbols[i].name; i++) {
+        if (units & runtime_symbols[i].unit) {
+            fprintf(gen->output, "global %s\n", runtime_symbols[i].name);
+        }
+    }
+    codegen_declare_externs(gen, node);
+
+    codegen_runtime(gen, units);
 
     int has_main = 0;
     for (int i = 0; i < node->child_count; i++) {
-        if (node->children[i]->type == AST_FUNCTION) {
-            if (strcmp(node->children[i]->value, "main") == 0) {
-                has_main = 1;
-            }
-            codegen_function(gen, node->children[i]);
+        if (node->children[i]->type == AST_FUNCTION &&
+            strcmp(node->children[i]->value, "main") == 0) {
+            has_main = 1;
         }
     }
+    codegen_functions(gen, node);
 
     if (!has_main) {
         printf("Error: No 'main' function found\n");
@@ -719,8 +3094,211 @@ void codegen_program(CodeGen *gen, ASTNode *node) {
     }
 
     fprintf(gen->output, "_start:\n");
-    codegen_emit(gen, "call main");
-    codegen_emit(gen, "mov rdi, rax");
-    codegen_emit(gen, "mov rax, 60");
+    if (codegen_options.profile) {
+        // main suma su tiempo en el [rbp-16] de su llamador: prof_root
+        codegen_emit(gen, "lea rbp, [rel prof_root + 16]");
+    }
+    if (codegen_options.profile || codegen_options.pgo_generate) {
+        codegen_emit(gen, "call main");
+        codegen_emit(gen, "push rax");
+        if (codegen_options.profile) codegen_emit(gen, "call prof_dump");
+        if (codegen_options.pgo_generate) codegen_emit(gen, "call pgo_dump");
+        codegen_emit(gen, "pop rdi");
+    } else {
+        codegen_emit(gen, "call main");
+        codegen_emit(gen, "mov rdi, rax");
+    }
+    codegen_emit(gen, "mov rax, 231");
     codegen_emit(gen, "syscall");
+
+    string_pool_emit(gen->strings, gen->output);
+    if (codegen_options.profile) {
+        codegen_profile_data(gen);
+    }
+    if (codegen_options.pgo_generate) {
+        fprintf(gen->output, "\nsection .rodata\n");
+        codegen_profile_string(gen->output, "pgo_path", codegen_options.pgo_path);
+    }
+}
+
+// ==================== TREE SHAKING ====================
+// Antes de generar codigo se recorre el grafo de llamadas desde main sobre
+// todos los modulos: las funciones a las que no se llega se quitan del AST
+// y el objeto principal solo lleva las rutinas del runtime que usa alguna
+// funcion viva.
+
+typedef struct {
+    int functions;        // funciones eliminadas
+    int runtime;          // unidades del runtime eliminadas
+    long instructions;    // instrucciones que habrian generado (con measure)
+} ShakeReport;
+
+void codegen_tree_shake(ASTNode **programs, int count, int measure, ShakeReport *report) {
+    memset(report, 0, sizeof(ShakeReport));
+    StringPool *defined = string_pool_create();
+    ASTNode **functions = NULL;
+    for (int m = 0; m < count; m++) {
+        for (int i = 0; i < programs[m]->child_count; i++) {
+            ASTNode *child = programs[m]->children[i];
+            if (child->type != AST_FUNCTION || string_pool_find(defined, child->value) >= 0) continue;
+            int index = string_pool_intern(defined, child->value);
+            functions = (ASTNode**)realloc(functions, (index + 1) * sizeof(ASTNode*));
+            functions[index] = child;
+        }
+    }
+
+    // Sin main no hay raiz: codegen_program dara el error
+    int root = string_pool_find(defined, "main");
+    if (root < 0) {
+        string_pool_free(defined);
+        free(functions);
+        return;
+    }
+
+    char *live = (char*)calloc(defined->count, 1);
+    int *worklist = (int*)malloc(defined->count * sizeof(int));
+    int top = 0;
+    int units = 0;
+    live[root] = 1;
+    worklist[top++] = root;
+    while (top > 0) {
+        ASTNode *function = functions[worklist[--top]];
+        units |= codegen_runtime_uses(function);
+        StringPool *calls = string_pool_create();
+        codegen_collect_calls(function, calls);
+        for (int i = 0; i < calls->count; i++) {
+            int callee = string_pool_find(defined, calls->values[i]);
+            if (callee >= 0 && !live[callee]) {
+                live[callee] = 1;
+                worklist[top++] = callee;
+            }
+        }
+        string_pool_free(calls);
+    }
+
+    int removed_units = RUNTIME_ALL & ~RUNTIME_OPTIONAL & ~units;
+    for (int bit = 0; bit < 32; bit++) {
+        if (removed_units & (1 << bit)) report->runtime++;
+    }
+
+    // Solo para el informe: se genera lo eliminado a un buffer para contarlo
+    CodeGen measured;
+    char *text = NULL;
+    size_t len = 0;
+    int remarks_saved = remarks_mode;
+    if (measure) {
+        remarks_mode = REMARKS_OFF;     // lo eliminado no lleva remarks
+        codegen_init(&measured, open_memstream(&text, &len));
+        codegen_runtime(&measured, removed_units);
+    }
+
+    for (int m = 0; m < count; m++) {
+        ASTNode *program = programs[m];
+        int kept = 0;
+        for (int i = 0; i < program->child_count; i++) {
+            ASTNode *child = program->children[i];
+            if (child->type == AST_FUNCTION) {
+                int index = string_pool_find(defined, child->value);
+                if (!live[index]) {
+                    report->functions++;
+                    if (measure) codegen_function(&measured, child);
+                    continue;
+                }
+            }
+            program->children[kept++] = child;
+        }
+        program->child_count = kept;
+    }
+
+    if (measure) {
+        fclose(measured.output);
+        free(text);
+        string_pool_free(measured.strings);
+        report->instructions = measured.instruction_count;
+        remarks_mode = remarks_saved;
+    }
+    codegen_runtime_units = units;
+    string_pool_free(defined);
+    free(functions);
+    free(live);
+    free(worklist);
+}
+
+// ==================== INTERNAL CALLS ====================
+// Con -O, una funcion a la que solo se llama desde su propio modulo y a la
+// que se llama a menudo (desde un bucle o, con --profile-use, mas veces de
+// las que se entra en quien la llama) usa una convencion interna: respeta
+// tambien r10 y r11. Quien la llama desde el IR deja ahi valores vivos a
+// traves de la llamada sin guardar nada, y ella solo los guarda si los usa
+// o llama a su vez a algo que no los respeta. Las poco llamadas siguen con
+// System V, que deja r10 y r11 libres para el llamado. Argumentos, retorno
+// y pila no cambian: llamarla como System V sigue siendo valido.
+
+StringPool *codegen_internal;
+
+int codegen_is_internal(const char *name) {
+    return codegen_internal && string_pool_find(codegen_internal, name) >= 0;
+}
+
+typedef struct {
+    StringPool *defined;
+    int *module;          // funcion -> modulo que la define
+    char *external;       // llamada desde otro modulo
+    char *hot;            // llamada desde un bucle o muchas veces
+} InternalCalls;
+
+void codegen_internal_walk(InternalCalls *calls, ASTNode *node, ASTNode *caller, int module, int loops) {
+    if (!node) return;
+    if (node->type == AST_CALL && !codegen_is_builtin(node->value)) {
+        int callee = string_pool_find(calls->defined, node->value);
+        if (callee >= 0) {
+            if (calls->module[callee] != module) calls->external[callee] = 1;
+            int hot = node->count >= 0 && caller->count >= 0 ? node->count > caller->count : loops > 0;
+            if (hot) calls->hot[callee] = 1;
+        }
+    }
+    if (node->type == AST_LOOP || node->type == AST_PARALLEL_LOOP) loops++;
+    codegen_internal_walk(calls, node->left, caller, module, loops);
+    codegen_internal_walk(calls, node->right, caller, module, loops);
+    for (int i = 0; i < node->child_count; i++) {
+        codegen_internal_walk(calls, node->children[i], caller, module, loops);
+    }
+}
+
+// Solo cuando las funciones pasan por el IR, que es quien lo aprovecha
+void codegen_mark_internal(ASTNode **programs, int count) {
+    if (codegen_internal) string_pool_free(codegen_internal);
+    codegen_internal = NULL;
+    if (!codegen_options.optimize || codegen_options.profile || codegen_options.pgo_generate) return;
+
+    InternalCalls calls;
+    calls.defined = string_pool_create();
+    int capacity = 0;
+    for (int m = 0; m < count; m++) capacity += programs[m]->child_count;
+    calls.module = (int*)calloc(capacity + 1, sizeof(int));
+    calls.external = (char*)calloc(capacity + 1, 1);
+    calls.hot = (char*)calloc(capacity + 1, 1);
+    for (int m = 0; m < count; m++) {
+        for (int i = 0; i < programs[m]->child_count; i++) {
+            ASTNode *child = programs[m]->children[i];
+            if (child->type == AST_FUNCTION) calls.module[string_pool_intern(calls.defined, child->value)] = m;
+        }
+    }
+    for (int m = 0; m < count; m++) {
+        for (int i = 0; i < programs[m]->child_count; i++) {
+            ASTNode *child = programs[m]->children[i];
+            if (child->type == AST_FUNCTION) codegen_internal_walk(&calls, child->children[1], child, m, 0);
+        }
+    }
+    codegen_internal = string_pool_create();
+    for (int i = 0; i < calls.defined->count; i++) {
+        const char *name = calls.defined->values[i];
+        if (calls.hot[i] && !calls.external[i] && strcmp(name, "main") != 0) {
+            string_pool_intern(codegen_internal, name);
+        }
+    }
+    string_pool_free(calls.defined);
+    free(calls.module);
+    free(calls.external);
+    free(calls.hot);
 }
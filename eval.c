@@ -0,0 +1,745 @@
+// ==================== CONST EVAL ====================
+// Evaluacion en tiempo de compilacion: un interprete del AST ejecuta las
+// funciones puras cuando todos los argumentos de la llamada son constantes,
+// y la llamada se sustituye por su resultado. Se evaluan siempre las
+// funciones marcadas const (que deben ser puras) y, con -O, cualquiera que
+// se demuestre pura, con un presupuesto menor.
+//
+// Las tablas int t[N] = f (t[i] = f(i)) se calculan igual y van a .rodata;
+// si f no se puede evaluar se rellenan al declararlas con un bucle.
+//
+// La aritmetica imita la del codigo generado: enteros de 64 bits que dan
+// la vuelta, && y || bit a bit, y la division de idiv con rdx a 0. Todo lo
+// que el codigo generado no define (division por cero, variables sin
+// inicializar, indices fuera del array) hace que no se evalue.
+
+#define EVAL_CONST_STEPS 50000000    // pasos por llamada a una funcion const
+#define EVAL_PURE_STEPS 200000       // pasos por llamada a una funcion pura sin marcar
+#define EVAL_MAX_DEPTH 1000
+#define EVAL_MAX_ARRAY 1048576
+#define EVAL_MAX_TABLE 65536         // tablas mas grandes se rellenan en ejecucion
+
+enum { EVAL_PURE, EVAL_IMPURE };
+
+typedef enum {
+    EVAL_NEXT,
+    EVAL_RETURN,
+    EVAL_BREAK,
+    EVAL_CONTINUE,
+    EVAL_FAIL
+} EvalStatus;
+
+typedef struct {
+    const char *name;
+    long long value;
+    int set;
+    long long *array;       // NULL en los escalares
+    char *array_set;
+    int size;
+} EvalVar;
+
+typedef struct {
+    EvalVar *vars;
+    int count;
+    int capacity;
+} EvalFrame;
+
+typedef struct {
+    int function;
+    int arg_count;
+    long long *args;
+    long long value;
+} EvalMemo;
+
+typedef struct {
+    int calls;              // llamadas sustituidas por su valor
+    int tables;             // tablas calculadas
+    int runtime_tables;     // tablas que se rellenan al ejecutar
+} EvalReport;
+
+typedef struct {
+    StringPool *names;
+    ASTNode **functions;
+    char *purity;
+    char **reasons;
+    long long steps;        // pasos que quedan en la evaluacion actual
+    int depth;
+    EvalMemo *memo;         // resultados ya calculados (direccionamiento abierto)
+    int memo_count;
+    int memo_capacity;
+    int counter;            // contadores de los bucles de las tablas
+    unsigned long long digest;
+    EvalReport report;
+} ConstEval;
+
+int eval_is_const(ASTNode *function) {
+    return function->left && strcmp(function->left->value, "const") == 0;
+}
+
+int eval_function(ConstEval *ev, const char *name) {
+    return string_pool_find(ev->names, name);
+}
+
+// ---------- Pureza ----------
+
+// Impureza directa de node (sin mirar dentro de las funciones llamadas)
+void eval_direct_impurity(ConstEval *ev, ASTNode *node, char *reason) {
+    if (!node || reason[0]) return;
+    switch (node->type) {
+        case AST_STRING:
+            strcpy(reason, "uses strings");
+            return;
+        case AST_VAR_DECL:
+        case AST_ARRAY_DECL:
+            if (strcmp(node->left->value, "int") != 0 && strcmp(node->left->value, "bool") != 0) {
+                snprintf(reason, 128, "uses %.32s variables", node->left->value);
+                return;
+            }
+            break;
+        case AST_PARALLEL_LOOP:
+        case AST_REDUCE:
+            strcpy(reason, "uses parallel loops");
+            return;
+        case AST_CALL:
+            if (codegen_is_builtin(node->value)) {
+                snprintf(reason, 128, "calls %.64s()", node->value);
+                return;
+            }
+            if (eval_function(ev, node->value) < 0) {
+                snprintf(reason, 128, "calls unknown function %.64s()", node->value);
+                return;
+            }
+            break;
+        default:
+            break;
+    }
+    eval_direct_impurity(ev, node->left, reason);
+    eval_direct_impurity(ev, node->right, reason);
+    for (int i = 0; i < node->child_count; i++) {
+        eval_direct_impurity(ev, node->children[i], reason);
+    }
+}
+
+// Funcion llamada desde node que no es pura, o -1
+int eval_impure_callee(ConstEval *ev, ASTNode *node) {
+    if (!node) return -1;
+    const char *callee = NULL;
+    if (node->type == AST_CALL) callee = node->value;
+    if (node->type == AST_ARRAY_DECL && node->child_count > 0 &&
+        node->children[0]->type == AST_IDENTIFIER) callee = node->children[0]->value;
+    if (callee) {
+        int index = eval_function(ev, callee);
+        if (index >= 0 && ev->purity[index] == EVAL_IMPURE) return index;
+    }
+    int found = eval_impure_callee(ev, node->left);
+    if (found < 0) found = eval_impure_callee(ev, node->right);
+    for (int i = 0; i < node->child_count && found < 0; i++) {
+        found = eval_impure_callee(ev, node->children[i]);
+    }
+    return found;
+}
+
+// Punto fijo: todas empiezan puras y se marcan impuras las que tienen algo
+// impuro o llaman a una impura, hasta que no cambia nada
+void eval_purity(ConstEval *ev) {
+    int count = ev->names->count;
+    for (int f = 0; f < count; f++) {
+        if (ev->purity[f] == EVAL_IMPURE) continue;
+        ASTNode *params = ev->functions[f]->children[0];
+        for (int i = 0; i < params->child_count && !ev->reasons[f][0]; i++) {
+            if (strcmp(params->children[i]->left->value, "int") != 0 &&
+                strcmp(params->children[i]->left->value, "bool") != 0) {
+                snprintf(ev->reasons[f], 128, "has a %.32s parameter", params->children[i]->left->value);
+            }
+        }
+        eval_direct_impurity(ev, ev->functions[f]->children[1], ev->reasons[f]);
+        if (ev->reasons[f][0]) ev->purity[f] = EVAL_IMPURE;
+    }
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int f = 0; f < count; f++) {
+            if (ev->purity[f] == EVAL_IMPURE) continue;
+            int callee = eval_impure_callee(ev, ev->functions[f]->children[1]);
+            if (callee < 0) continue;
+            snprintf(ev->reasons[f], 128, "calls %.64s(), which is not pure", ev->names->values[callee]);
+            ev->purity[f] = EVAL_IMPURE;
+            changed = 1;
+        }
+    }
+}
+
+// ---------- Interprete ----------
+
+int eval_divide(long long a, long long b, int modulo, long long *result) {
+    // idiv de rdx:rax con rdx = 0: el dividendo es rax sin signo
+    if (b == 0) return 0;
+    __int128 dividend = (__int128)(unsigned long long)a;
+    __int128 quotient = dividend / b;
+    if (quotient > LLONG_MAX || quotient < LLONG_MIN) return 0;
+    *result = modulo ? (long long)(dividend % b) : (long long)quotient;
+    return 1;
+}
+
+EvalVar* eval_lookup(EvalFrame *frame, const char *name) {
+    for (int i = frame->count - 1; i >= 0; i--) {
+        if (strcmp(frame->vars[i].name, name) == 0) return &frame->vars[i];
+    }
+    return NULL;
+}
+
+EvalVar* eval_declare(EvalFrame *frame, const char *name) {
+    if (frame->count >= frame->capacity) {
+        frame->capacity = frame->capacity ? frame->capacity * 2 : 16;
+        frame->vars = (EvalVar*)realloc(frame->vars, frame->capacity * sizeof(EvalVar));
+    }
+    EvalVar *var = &frame->vars[frame->count++];
+    memset(var, 0, sizeof(EvalVar));
+    var->name = name;
+    return var;
+}
+
+// Cierra un ambito: quita (y libera) las variables declaradas desde mark
+void eval_release(EvalFrame *frame, int mark) {
+    while (frame->count > mark) {
+        EvalVar *var = &frame->vars[--frame->count];
+        free(var->array);
+        free(var->array_set);
+    }
+}
+
+unsigned int eval_memo_hash(int function, long long *args, int count) {
+    unsigned long long hash = 1469598103934665603ull ^ (unsigned int)function;
+    for (int i = 0; i < count; i++) {
+        hash = (hash ^ (unsigned long long)args[i]) * 1099511628211ull;
+    }
+    return (unsigned int)(hash ^ (hash >> 32));
+}
+
+EvalMemo* eval_memo_find(ConstEval *ev, int function, long long *args, int count) {
+    if (ev->memo_capacity == 0) return NULL;
+    unsigned int mask = ev->memo_capacity - 1;
+    for (unsigned int i = eval_memo_hash(function, args, count) & mask; ev->memo[i].args; i = (i + 1) & mask) {
+        EvalMemo *entry = &ev->memo[i];
+        if (entry->function == function && entry->arg_count == count &&
+            memcmp(entry->args, args, count * sizeof(long long)) == 0) return entry;
+    }
+    return NULL;
+}
+
+void eval_memo_add(ConstEval *ev, int function, long long *args, int count, long long value) {
+    if (2 * (ev->memo_count + 1) > ev->memo_capacity) {
+        EvalMemo *old = ev->memo;
+        int old_capacity = ev->memo_capacity;
+        ev->memo_capacity = old_capacity ? old_capacity * 2 : 256;
+        ev->memo = (EvalMemo*)calloc(ev->memo_capacity, sizeof(EvalMemo));
+        ev->memo_count = 0;
+        for (int i = 0; i < old_capacity; i++) {
+            if (!old[i].args) continue;
+            eval_memo_add(ev, old[i].function, old[i].args, old[i].arg_count, old[i].value);
+            free(old[i].args);
+        }
+        free(old);
+    }
+    unsigned int mask = ev->memo_capacity - 1;
+    unsigned int i = eval_memo_hash(function, args, count) & mask;
+    while (ev->memo[i].args) i = (i + 1) & mask;
+    EvalMemo *entry = &ev->memo[i];
+    entry->function = function;
+    entry->arg_count = count;
+    entry->args = (long long*)malloc((count ? count : 1) * sizeof(long long));
+    memcpy(entry->args, args, count * sizeof(long long));
+    entry->value = value;
+    ev->memo_count++;
+}
+
+int eval_call(ConstEval *ev, int function, long long *args, int count, long long *value);
+EvalStatus eval_block(ConstEval *ev, EvalFrame *frame, ASTNode *block, long long *result);
+
+int eval_expression(ConstEval *ev, EvalFrame *frame, ASTNode *node, long long *value) {
+    if (--ev->steps < 0) return 0;
+
+    switch (node->type) {
+        case AST_NUMBER:
+            *value = strtoll(node->value, NULL, 10);
+            return 1;
+
+        case AST_IDENTIFIER: {
+            EvalVar *var = eval_lookup(frame, node->value);
+            if (!var || var->array || !var->set) return 0;
+            *value = var->value;
+            return 1;
+        }
+
+        case AST_ARRAY_ACCESS: {
+            long long index;
+            EvalVar *var = eval_lookup(frame, node->value);
+            if (!var || !var->array || !eval_expression(ev, frame, node->left, &index)) return 0;
+            if (index < 0 || index >= var->size || !var->array_set[index]) return 0;
+            *value = var->array[index];
+            return 1;
+        }
+
+        case AST_UNARY_OP: {
+            long long operand;
+            if (!eval_expression(ev, frame, node->left, &operand)) return 0;
+            if (strcmp(node->value, "-") == 0) *value = (long long)(0ull - (unsigned long long)operand);
+            else *value = !operand;
+            return 1;
+        }
+
+        case AST_BINARY_OP: {
+            long long a, b;
+            if (!eval_expression(ev, frame, node->left, &a) ||
+                !eval_expression(ev, frame, node->right, &b)) return 0;
+            unsigned long long x = a, y = b;
+            const char *op = node->value;
+            if (strcmp(op, "+") == 0) *value = (long long)(x + y);
+            else if (strcmp(op, "-") == 0) *value = (long long)(x - y);
+            else if (strcmp(op, "*") == 0) *value = (long long)(x * y);
+            else if (strcmp(op, "/") == 0) return eval_divide(a, b, 0, value);
+            else if (strcmp(op, "%") == 0) return eval_divide(a, b, 1, value);
+            else if (strcmp(op, "==") == 0) *value = a == b;
+            else if (strcmp(op, "!=") == 0) *value = a != b;
+            else if (strcmp(op, "<") == 0) *value = a < b;
+            else if (strcmp(op, ">") == 0) *value = a > b;
+            else if (strcmp(op, "<=") == 0) *value = a <= b;
+            else if (strcmp(op, ">=") == 0) *value = a >= b;
+            else if (strcmp(op, "&&") == 0) *value = a & b;
+            else if (strcmp(op, "||") == 0) *value = a | b;
+            else return 0;
+            return 1;
+        }
+
+        case AST_CALL: {
+            int function = eval_function(ev, node->value);
+            if (function < 0 || ev->purity[function] != EVAL_PURE) return 0;
+            long long *args = (long long*)malloc((node->child_count + 1) * sizeof(long long));
+            int ok = 1;
+            for (int i = 0; i < node->child_count && ok; i++) {
+                ok = eval_expression(ev, frame, node->children[i], &args[i]);
+            }
+            if (ok) ok = eval_call(ev, function, args, node->child_count, value);
+            free(args);
+            return ok;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+// Rellena var (un array) con f(i) o con los valores de una tabla ya calculada
+int eval_table(ConstEval *ev, EvalVar *var, ASTNode *init) {
+    if (init->type == AST_BLOCK) {
+        for (int i = 0; i < var->size && i < init->child_count; i++) {
+            var->array[i] = strtoll(init->children[i]->value, NULL, 10);
+            var->array_set[i] = 1;
+        }
+        return 1;
+    }
+    int function = eval_function(ev, init->value);
+    if (function < 0 || ev->purity[function] != EVAL_PURE) return 0;
+    for (long long i = 0; i < var->size; i++) {
+        if (!eval_call(ev, function, &i, 1, &var->array[i])) return 0;
+        var->array_set[i] = 1;
+    }
+    return 1;
+}
+
+EvalStatus eval_statement(ConstEval *ev, EvalFrame *frame, ASTNode *node, long long *result) {
+    long long value;
+    if (--ev->steps < 0) return EVAL_FAIL;
+
+    switch (node->type) {
+        case AST_VAR_DECL: {
+            int set = node->right != NULL;
+            if (set && !eval_expression(ev, frame, node->right, &value)) return EVAL_FAIL;
+            EvalVar *var = eval_declare(frame, node->value);
+            var->value = set ? value : 0;
+            var->set = set;
+            return EVAL_NEXT;
+        }
+
+        case AST_ARRAY_DECL: {
+            long long size = strtoll(node->right->value, NULL, 10);
+            if (size <= 0 || size > EVAL_MAX_ARRAY) return EVAL_FAIL;
+            EvalVar *var = eval_declare(frame, node->value);
+            var->size = (int)size;
+            var->array = (long long*)calloc(size, sizeof(long long));
+            var->array_set = (char*)calloc(size, 1);
+            if (node->child_count > 0 && !eval_table(ev, var, node->children[0])) return EVAL_FAIL;
+            return EVAL_NEXT;
+        }
+
+        case AST_ASSIGNMENT: {
+            EvalVar *var = eval_lookup(frame, node->value);
+            if (!var || !eval_expression(ev, frame, node->right, &value)) return EVAL_FAIL;
+            if (node->left) {
+                long long index;
+                if (!var->array || !eval_expression(ev, frame, node->left, &index)) return EVAL_FAIL;
+                if (index < 0 || index >= var->size) return EVAL_FAIL;
+                var->array[index] = value;
+                var->array_set[index] = 1;
+            } else {
+                if (var->array) return EVAL_FAIL;
+                var->value = value;
+                var->set = 1;
+            }
+            return EVAL_NEXT;
+        }
+
+        case AST_INCREMENT:
+        case AST_DECREMENT: {
+            EvalVar *var = eval_lookup(frame, node->value);
+            if (!var || var->array || !var->set) return EVAL_FAIL;
+            var->value = (long long)((unsigned long long)var->value + (node->type == AST_INCREMENT ? 1 : -1));
+            return EVAL_NEXT;
+        }
+
+        case AST_RETURN:
+            *result = 0;
+            if (node->left && !eval_expression(ev, frame, node->left, result)) return EVAL_FAIL;
+            return EVAL_RETURN;
+
+        case AST_IF:
+            if (!eval_expression(ev, frame, node->left, &value)) return EVAL_FAIL;
+            if (value) return eval_block(ev, frame, node->children[0], result);
+            if (node->child_count > 1) return eval_block(ev, frame, node->children[1], result);
+            return EVAL_NEXT;
+
+        case AST_LOOP:
+            for (;;) {
+                if (!eval_expression(ev, frame, node->left, &value)) return EVAL_FAIL;
+                if (!value) return EVAL_NEXT;
+                EvalStatus status = eval_block(ev, frame, node->right, result);
+                if (status == EVAL_BREAK) return EVAL_NEXT;
+                if (status == EVAL_RETURN || status == EVAL_FAIL) return status;
+            }
+
+        case AST_SWITCH: {
+            if (!eval_expression(ev, frame, node->left, &value)) return EVAL_FAIL;
+            ASTNode *chosen = NULL;
+            for (int i = 0; i < node->child_count && !chosen; i++) {
+                ASTNode *item = node->children[i];
+                for (int k = 0; k < item->child_count; k++) {
+                    if (strtoll(item->children[k]->value, NULL, 10) == value) chosen = item;
+                }
+            }
+            for (int i = 0; i < node->child_count && !chosen; i++) {
+                if (strcmp(node->children[i]->value, "default") == 0) chosen = node->children[i];
+            }
+            // break y continue siguen siendo del loop de fuera
+            return chosen ? eval_block(ev, frame, chosen->right, result) : EVAL_NEXT;
+        }
+
+        case AST_BREAK:
+            return EVAL_BREAK;
+
+        case AST_CONTINUE:
+            return EVAL_CONTINUE;
+
+        case AST_BLOCK:
+            return eval_block(ev, frame, node, result);
+
+        default:
+            return eval_expression(ev, frame, node, &value) ? EVAL_NEXT : EVAL_FAIL;
+    }
+}
+
+EvalStatus eval_block(ConstEval *ev, EvalFrame *frame, ASTNode *block, long long *result) {
+    int mark = frame->count;
+    EvalStatus status = EVAL_NEXT;
+    for (int i = 0; i < block->child_count && status == EVAL_NEXT; i++) {
+        status = eval_statement(ev, frame, block->children[i], result);
+    }
+    eval_release(frame, mark);
+    return status;
+}
+
+int eval_call(ConstEval *ev, int function, long long *args, int count, long long *value) {
+    ASTNode *node = ev->functions[function];
+    ASTNode *params = node->children[0];
+    if (ev->purity[function] != EVAL_PURE || count != params->child_count) return 0;
+
+    EvalMemo *memo = eval_memo_find(ev, function, args, count);
+    if (memo) {
+        *value = memo->value;
+        return 1;
+    }
+    if (ev->depth >= EVAL_MAX_DEPTH) return 0;
+
+    EvalFrame frame;
+    memset(&frame, 0, sizeof(frame));
+    for (int i = 0; i < count; i++) {
+        EvalVar *var = eval_declare(&frame, params->children[i]->value);
+        var->value = args[i];
+        var->set = 1;
+    }
+
+    ev->depth++;
+    long long result = 0;
+    EvalStatus status = eval_block(ev, &frame, node->children[1], &result);
+    ev->depth--;
+    eval_release(&frame, 0);
+    free(frame.vars);
+
+    // Caer al final de la funcion devuelve 0, como en el IR
+    if (status == EVAL_FAIL || status == EVAL_BREAK || status == EVAL_CONTINUE) return 0;
+    *value = status == EVAL_RETURN ? result : 0;
+    eval_memo_add(ev, function, args, count, *value);
+    return 1;
+}
+
+// ---------- Sustitucion ----------
+
+// Presupuesto para evaluar una llamada a function, 0 si no se evalua
+long long eval_budget(ConstEval *ev, int function) {
+    if (function < 0 || ev->purity[function] != EVAL_PURE) return 0;
+    if (eval_is_const(ev->functions[function])) return EVAL_CONST_STEPS;
+    return codegen_options.optimize ? EVAL_PURE_STEPS : 0;
+}
+
+void eval_digest(ConstEval *ev, const char *text) {
+    for (const char *p = text; ; p++) {
+        ev->digest = (ev->digest ^ (unsigned char)*p) * 1099511628211ull;
+        if (!*p) break;
+    }
+}
+
+void eval_fold_expression(ConstEval *ev, ASTNode *node) {
+    if (!node) return;
+    eval_fold_expression(ev, node->left);
+    eval_fold_expression(ev, node->right);
+    for (int i = 0; i < node->child_count; i++) {
+        eval_fold_expression(ev, node->children[i]);
+    }
+    if (node->type != AST_CALL) return;
+
+    int function = eval_function(ev, node->value);
+    long long budget = eval_budget(ev, function);
+    if (budget == 0) return;
+
+    // Los argumentos ya estan plegados: basta con que sean constantes
+    EvalFrame empty;
+    memset(&empty, 0, sizeof(empty));
+    long long *args = (long long*)malloc((node->child_count + 1) * sizeof(long long));
+    long long value;
+    ev->steps = budget;
+    ev->depth = 0;
+    int ok = 1;
+    for (int i = 0; i < node->child_count && ok; i++) {
+        ok = eval_expression(ev, &empty, node->children[i], &args[i]);
+    }
+    if (!ok) {
+        free(args);
+        return;
+    }
+    ok = eval_call(ev, function, args, node->child_count, &value);
+    free(args);
+    if (!ok) {
+        if (eval_is_const(ev->functions[function])) {
+            warning("%s:%d: call to const function %s() not evaluated at compile time",
+                    node->file ? node->file : "?", node->line, node->value);
+        }
+        remark(REMARK_MISSED, "consteval", node->file, node->line, NULL,
+               "call to %s() not evaluated at compile time: it ran out of steps or is undefined for these arguments",
+               node->value);
+        return;
+    }
+
+    remark(REMARK_PASSED, "consteval", node->file, node->line, NULL,
+           "call to %s() evaluated at compile time to %lld", node->value, value);
+    eval_digest(ev, node->value);
+    node->type = AST_NUMBER;
+    snprintf(node->value, sizeof(node->value), "%lld", value);
+    node->left = node->right = NULL;
+    node->child_count = 0;
+    eval_digest(ev, node->value);
+    ev->report.calls++;
+}
+
+void eval_insert(ASTNode *block, int index, ASTNode *node) {
+    ast_add_child(block, node);
+    memmove(&block->children[index + 1], &block->children[index],
+            (block->child_count - 1 - index) * sizeof(ASTNode*));
+    block->children[index] = node;
+}
+
+// int t[N] = f: la tabla calculada queda como hijo AST_BLOCK "table" de la
+// declaracion; si no se puede, se anade detras el bucle
+//   int .tK = 0
+//   loop .tK < N { t[.tK] = f(.tK); .tK++ }
+void eval_fold_table(ConstEval *ev, ASTNode *block, int index) {
+    ASTNode *decl = block->children[index];
+    ASTNode *init = decl->children[0];
+    if (init->type != AST_IDENTIFIER) return;
+
+    int function = eval_function(ev, init->value);
+    if (function < 0 || ev->functions[function]->children[0]->child_count != 1) {
+        error("%s:%d: table initializer %s must be a function with one int parameter",
+              decl->file ? decl->file : "?", decl->line, init->value);
+    }
+
+    long long size = strtoll(decl->right->value, NULL, 10);
+    long long budget = eval_budget(ev, function);
+    if (budget > 0 && size > 0 && size <= EVAL_MAX_TABLE) {
+        ASTNode *table = ast_create_node(AST_BLOCK, "table");
+        table->children = (ASTNode**)malloc(size * sizeof(ASTNode*));
+        table->capacity = (int)size;
+        EvalFrame empty;
+        memset(&empty, 0, sizeof(empty));
+        int ok = 1;
+        for (long long i = 0; i < size && ok; i++) {
+            long long value;
+            ev->steps = budget;
+            ev->depth = 0;
+            ok = eval_call(ev, function, &i, 1, &value);
+            if (!ok) break;
+            char text[32];
+            snprintf(text, sizeof(text), "%lld", value);
+            table->children[table->child_count++] = ast_create_node(AST_NUMBER, text);
+            eval_digest(ev, text);
+        }
+        if (ok) {
+            eval_digest(ev, init->value);
+            decl->children[0] = table;
+            ev->report.tables++;
+            remark(REMARK_PASSED, "consteval", decl->file, decl->line, NULL,
+                   "table %s computed at compile time", decl->value);
+            return;
+        }
+        for (int i = 0; i < table->child_count; i++) free(table->children[i]);
+        free(table->children);
+        free(table);
+        if (eval_is_const(ev->functions[function])) {
+            warning("%s:%d: table %s not evaluated at compile time", decl->file ? decl->file : "?",
+                    decl->line, decl->value);
+        }
+    }
+
+    if (size > EVAL_MAX_TABLE) {
+        remark(REMARK_MISSED, "consteval", decl->file, decl->line, NULL,
+               "table %s filled at run time: more than %d entries", decl->value, EVAL_MAX_TABLE);
+    } else {
+        remark(REMARK_MISSED, "consteval", decl->file, decl->line, NULL,
+               "table %s filled at run time: %s() could not be evaluated", decl->value, init->value);
+    }
+    ast_line = decl->line;
+    ast_file = decl->file;
+    char counter[32];
+    snprintf(counter, sizeof(counter), ".t%d", ev->counter++);
+
+    ASTNode *start = ast_create_node(AST_VAR_DECL, counter);
+    start->left = ast_create_node(AST_IDENTIFIER, "int");
+    start->right = ast_create_node(AST_NUMBER, "0");
+
+    ASTNode *loop = ast_create_node(AST_LOOP, "loop");
+    loop->left = ast_create_node(AST_BINARY_OP, "<");
+    loop->left->left = ast_create_node(AST_IDENTIFIER, counter);
+    loop->left->right = ast_create_node(AST_NUMBER, decl->right->value);
+    loop->right = ast_create_node(AST_BLOCK, "body");
+
+    ASTNode *store = ast_create_node(AST_ASSIGNMENT, decl->value);
+    store->left = ast_create_node(AST_IDENTIFIER, counter);
+    store->right = ast_create_node(AST_CALL, init->value);
+    ast_add_child(store->right, ast_create_node(AST_IDENTIFIER, counter));
+    ast_add_child(loop->right, store);
+    ast_add_child(loop->right, ast_create_node(AST_INCREMENT, counter));
+
+    decl->child_count = 0;
+    eval_insert(block, index + 1, start);
+    eval_insert(block, index + 2, loop);
+    ev->report.runtime_tables++;
+}
+
+void eval_fold_block(ConstEval *ev, ASTNode *block) {
+    for (int i = 0; i < block->child_count; i++) {
+        ASTNode *node = block->children[i];
+        switch (node->type) {
+            case AST_ARRAY_DECL:
+                if (node->child_count > 0) eval_fold_table(ev, block, i);
+                break;
+            case AST_IF:
+                eval_fold_expression(ev, node->left);
+                for (int k = 0; k < node->child_count; k++) eval_fold_block(ev, node->children[k]);
+                break;
+            case AST_LOOP:
+            case AST_PARALLEL_LOOP:
+                eval_fold_expression(ev, node->left);
+                eval_fold_block(ev, node->right);
+                break;
+            case AST_SWITCH:
+                eval_fold_expression(ev, node->left);
+                for (int k = 0; k < node->child_count; k++) eval_fold_block(ev, node->children[k]->right);
+                break;
+            case AST_BLOCK:
+                eval_fold_block(ev, node);
+                break;
+            default:
+                eval_fold_expression(ev, node);
+                break;
+        }
+    }
+}
+
+// Evalua en todos los modulos; digests[m] resume lo sustituido en el modulo
+// m, que entra en la clave de su objeto en la cache (depende de funciones
+// de otros modulos)
+void eval_program(ASTNode **programs, int count, unsigned long long *digests, EvalReport *report) {
+    ConstEval ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.names = string_pool_create();
+    int capacity = 0;
+    for (int m = 0; m < count; m++) {
+        for (int i = 0; i < programs[m]->child_count; i++) {
+            ASTNode *child = programs[m]->children[i];
+            if (child->type != AST_FUNCTION) continue;
+            int index = string_pool_find(ev.names, child->value);
+            if (index >= 0) {
+                // Definida dos veces: no se sabe cual se llama
+                ev.purity[index] = EVAL_IMPURE;
+                strcpy(ev.reasons[index], "is defined twice");
+                continue;
+            }
+            index = string_pool_intern(ev.names, child->value);
+            if (index >= capacity) {
+                capacity = capacity ? capacity * 2 : 64;
+                ev.functions = (ASTNode**)realloc(ev.functions, capacity * sizeof(ASTNode*));
+                ev.purity = (char*)realloc(ev.purity, capacity);
+                ev.reasons = (char**)realloc(ev.reasons, capacity * sizeof(char*));
+            }
+            ev.functions[index] = child;
+            ev.purity[index] = EVAL_PURE;
+            ev.reasons[index] = (char*)calloc(128, 1);
+        }
+    }
+
+    eval_purity(&ev);
+    for (int f = 0; f < ev.names->count; f++) {
+        ASTNode *function = ev.functions[f];
+        if (eval_is_const(function) && ev.purity[f] != EVAL_PURE) {
+            error("%s:%d: const function %s() is not pure: it %s",
+                  function->file ? function->file : "?", function->line, function->value, ev.reasons[f]);
+        }
+    }
+
+    for (int m = 0; m < count; m++) {
+        ev.digest = 0;
+        for (int i = 0; i < programs[m]->child_count; i++) {
+            ASTNode *child = programs[m]->children[i];
+            if (child->type == AST_FUNCTION) eval_fold_block(&ev, child->children[1]);
+        }
+        if (digests) digests[m] = ev.digest;
+    }
+    *report = ev.report;
+
+    for (int i = 0; i < ev.memo_capacity; i++) free(ev.memo[i].args);
+    free(ev.memo);
+    for (int f = 0; f < ev.names->count; f++) free(ev.reasons[f]);
+    free(ev.reasons);
+    free(ev.purity);
+    free(ev.functions);
+    string_pool_free(ev.names);
+}
@@ -0,0 +1,55 @@
+// Cola de un productor y un consumidor sobre un array compartido, sin
+// llamadas al kernel: head y tail solo se tocan con atomic_load y
+// atomic_store (movs y xchg), y cuando la cola esta llena o vacia el hilo
+// espera dando vueltas en lugar de dormir en un futex.
+//
+// El productor escribe en ring[head % 128] y luego publica head; el
+// consumidor lee ring[tail % 128] y luego libera el hueco con tail. Cada
+// contador lo escribe un solo hilo, asi que no hace falta atomic_cas.
+//
+// Limitaciones:
+// - Los dos lados son las dos vueltas de un parallel loop role < 2, y solo
+//   avanzan a la vez si el runtime les da un hilo a cada uno. Con una sola
+//   CPU disponible (o una mascara de afinidad de una) y dentro de otro
+//   parallel loop el cuerpo se ejecuta en serie: primero el productor
+//   entero y luego el consumidor, y si los elementos no caben en la cola
+//   el productor se queda esperando para siempre. Por eso aqui son 100 en
+//   una cola de 128.
+// - Un hilo que espera gasta su CPU entera; con mas hilos listos que CPUs
+//   es mejor mutex_lock, que duerme en el kernel si hay contencion.
+// - No hay funciones que reciban arrays, asi que la cola va escrita dentro
+//   de la funcion que la usa (copiar este patron, no importarlo).
+//
+//   b run examples/ring.b      (imprime 5050)
+
+func main() {
+    int ring[128]
+    int head = 0
+    int tail = 0
+    int sum = 0
+    parallel loop role < 2 reduce + sum {
+        if role == 0 {
+            // Productor: espera mientras la cola esta llena
+            int k = 1
+            loop k <= 100 {
+                loop atomic_load(head) - atomic_load(tail) == 128 {
+                }
+                ring[atomic_load(head) % 128] = k
+                atomic_store(head, atomic_load(head) + 1)
+                k++
+            }
+        } else {
+            // Consumidor: espera mientras la cola esta vacia
+            int n = 0
+            loop n < 100 {
+                loop atomic_load(tail) == atomic_load(head) {
+                }
+                sum = sum + ring[atomic_load(tail) % 128]
+                atomic_store(tail, atomic_load(tail) + 1)
+                n++
+            }
+        }
+    }
+    print(sum, "\n")
+    return 0
+}
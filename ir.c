@@ -0,0 +1,2503 @@
+// ==================== IR ====================
+// Representacion intermedia en forma SSA entre el AST y el backend x86.
+// Cada funcion es un grafo de bloques basicos; cada instruccion define como
+// mucho un valor, identificado por su indice en fn->instrs. Las variables
+// escalares se convierten en valores SSA al construir (algoritmo de Braun
+// et al.: phis bajo demanda y bloques sellados); los arrays siguen en
+// memoria y se acceden con load/store.
+//
+// Solo se baja el subconjunto que el backend sabe emitir: enteros, arrays,
+// if/loop/switch/break/continue/return, llamadas a funciones B y print/exit/
+// read_int/eof. Una funcion con cualquier otra cosa (strings, parallel,
+// otros builtins) se queda con el generador directo desde el AST.
+
+typedef enum {
+    IR_CONST,
+    IR_STR,
+    IR_PARAM,
+    IR_COPY,
+    IR_PHI,
+    IR_ADD,
+    IR_SUB,
+    IR_MUL,
+    IR_DIV,
+    IR_MOD,
+    IR_EQ,
+    IR_NE,
+    IR_LT,
+    IR_GT,
+    IR_LE,
+    IR_GE,
+    IR_AND,
+    IR_OR,
+    IR_NOT,
+    IR_NEG,
+    IR_LOAD,
+    IR_STORE,
+    IR_INIT,
+    IR_CALL,
+    IR_PRINT,
+    IR_EXIT,
+    IR_READ_INT,
+    IR_EOF,
+    IR_JUMP,
+    IR_BRANCH,
+    IR_SWITCH,
+    IR_RETURN
+} IROp;
+
+const char *ir_op_names[] = {
+    "const", "str", "param", "copy", "phi", "add", "sub", "mul", "div", "mod",
+    "eq", "ne", "lt", "gt", "le", "ge", "and", "or", "not", "neg",
+    "load", "store", "init", "call", "print", "exit", "read_int", "eof",
+    "jump", "branch", "switch", "return"
+};
+
+typedef struct {
+    IROp op;
+    int block;
+    int *args;
+    int arg_count;
+    long long constant;   // const; indice de param; array de load/store
+    const char *text;     // funcion de call; texto de str
+    const char **strings; // print: literal de cada argumento (o NULL)
+    int target[2];        // jump/branch: bloques destino
+    long long weight[2];  // branch: veces que se va a cada destino (--profile-use)
+    int *targets;         // switch: destinos distintos, el primero es default
+    int target_count;
+    SwitchCase *cases;    // switch: valor -> bloque, ordenados
+    int case_count;
+    int line;
+    int dead;
+    int var;              // variable escalar a la que se asigna (+1), para --remarks
+    int reused;           // load sustituido por un valor ya conocido
+} IRInstr;
+
+typedef struct {
+    int *phis;
+    int phi_count;
+    int phi_capacity;
+    int *code;
+    int code_count;
+    int code_capacity;
+    int *preds;
+    int pred_count;
+    int pred_capacity;
+    int sealed;
+    int *defs;            // variable -> valor actual en el bloque (-1)
+    int def_count;
+    int *incomplete;      // pares (variable, phi) pendientes de sellar
+    int incomplete_count;
+    int incomplete_capacity;
+    int reachable;
+    int idom;
+    int rpo;
+    int cold;             // rama fria del if (codegen_if_cold)
+} IRBlock;
+
+typedef struct {
+    const char *name;
+    int array;            // -1 si es escalar
+    int line;
+} IRVar;
+
+typedef struct {
+    const char *name;
+    const char *file;
+    IRInstr *instrs;
+    int instr_count;
+    int instr_capacity;
+    IRBlock *blocks;
+    int block_count;
+    int block_capacity;
+    IRVar *vars;
+    int var_count;
+    int *array_sizes;
+    ASTNode **array_tables; // contenido calculado en compilacion, o NULL
+    int array_count;
+    int *order;           // bloques alcanzables en orden postorden inverso
+    int order_count;
+    int current;
+    int loop_heads[50];
+    int loop_exits[50];
+    int loop_depth;
+    int line;
+    char reason[160];     // por que no se pudo bajar ("" si se pudo)
+} IRFunction;
+
+#define IR_TERMINATOR(op) ((op) == IR_JUMP || (op) == IR_BRANCH || (op) == IR_SWITCH || (op) == IR_RETURN)
+
+// ==================== IR BUILDER ====================
+
+void ir_fail(IRFunction *fn, const char *reason, const char *detail) {
+    if (fn->reason[0]) return;
+    snprintf(fn->reason, sizeof(fn->reason), "%s%s%.100s", reason, detail ? " " : "", detail ? detail : "");
+}
+
+int ir_new_block(IRFunction *fn) {
+    if (fn->block_count >= fn->block_capacity) {
+        fn->block_capacity = fn->block_capacity == 0 ? 16 : fn->block_capacity * 2;
+        fn->blocks = (IRBlock*)realloc(fn->blocks, fn->block_capacity * sizeof(IRBlock));
+    }
+    memset(&fn->blocks[fn->block_count], 0, sizeof(IRBlock));
+    return fn->block_count++;
+}
+
+void ir_int_push(int **list, int *count, int *capacity, int value) {
+    if (*count >= *capacity) {
+        *capacity = *capacity == 0 ? 4 : *capacity * 2;
+        *list = (int*)realloc(*list, *capacity * sizeof(int));
+    }
+    (*list)[(*count)++] = value;
+}
+
+int ir_new_instr(IRFunction *fn, IROp op, int block, int arg_count) {
+    if (fn->instr_count >= fn->instr_capacity) {
+        fn->instr_capacity = fn->instr_capacity == 0 ? 64 : fn->instr_capacity * 2;
+        fn->instrs = (IRInstr*)realloc(fn->instrs, fn->instr_capacity * sizeof(IRInstr));
+    }
+    IRInstr *instr = &fn->instrs[fn->instr_count];
+    memset(instr, 0, sizeof(IRInstr));
+    instr->op = op;
+    instr->block = block;
+    instr->arg_count = arg_count;
+    instr->args = arg_count ? (int*)malloc(arg_count * sizeof(int)) : NULL;
+    instr->line = fn->line;
+    return fn->instr_count++;
+}
+
+// Añade una instruccion al final del bloque actual
+int ir_emit(IRFunction *fn, IROp op, int arg_count) {
+    IRBlock *block = &fn->blocks[fn->current];
+    int index = ir_new_instr(fn, op, fn->current, arg_count);
+    ir_int_push(&block->code, &block->code_count, &block->code_capacity, index);
+    return index;
+}
+
+int ir_const(IRFunction *fn, long long value) {
+    int v = ir_emit(fn, IR_CONST, 0);
+    fn->instrs[v].constant = value;
+    return v;
+}
+
+int ir_binary(IRFunction *fn, IROp op, int left, int right) {
+    int v = ir_emit(fn, op, 2);
+    fn->instrs[v].args[0] = left;
+    fn->instrs[v].args[1] = right;
+    return v;
+}
+
+int ir_unary(IRFunction *fn, IROp op, int operand) {
+    int v = ir_emit(fn, op, 1);
+    fn->instrs[v].args[0] = operand;
+    return v;
+}
+
+void ir_add_pred(IRFunction *fn, int block, int pred) {
+    IRBlock *b = &fn->blocks[block];
+    ir_int_push(&b->preds, &b->pred_count, &b->pred_capacity, pred);
+}
+
+int ir_terminated(IRFunction *fn) {
+    IRBlock *block = &fn->blocks[fn->current];
+    return block->code_count > 0 && IR_TERMINATOR(fn->instrs[block->code[block->code_count - 1]].op);
+}
+
+void ir_jump(IRFunction *fn, int target) {
+    if (ir_terminated(fn)) return;
+    int j = ir_emit(fn, IR_JUMP, 0);
+    fn->instrs[j].target[0] = target;
+    ir_add_pred(fn, target, fn->current);
+}
+
+void ir_branch(IRFunction *fn, int cond, int if_true, int if_false) {
+    int b = ir_emit(fn, IR_BRANCH, 1);
+    fn->instrs[b].args[0] = cond;
+    fn->instrs[b].target[0] = if_true;
+    fn->instrs[b].target[1] = if_false;
+    ir_add_pred(fn, if_true, fn->current);
+    ir_add_pred(fn, if_false, fn->current);
+}
+
+// Frecuencias del branch recien emitido, si hay perfil
+void ir_weigh(IRFunction *fn, long long if_true, long long if_false) {
+    IRBlock *block = &fn->blocks[fn->current];
+    IRInstr *branch = &fn->instrs[block->code[block->code_count - 1]];
+    if (if_true < 0 || if_false < 0) return;
+    branch->weight[0] = if_true;
+    branch->weight[1] = if_false;
+}
+
+// Sucesores de un bloque; *succs apunta dentro de la instruccion final, asi
+// que deja de ser valido si se añaden instrucciones
+int ir_successors(IRFunction *fn, int block, int **succs) {
+    IRBlock *b = &fn->blocks[block];
+    if (b->code_count == 0) return 0;
+    IRInstr *last = &fn->instrs[b->code[b->code_count - 1]];
+    if (last->op == IR_JUMP || last->op == IR_BRANCH) {
+        *succs = last->target;
+        return last->op == IR_JUMP ? 1 : 2;
+    }
+    if (last->op == IR_SWITCH) {
+        *succs = last->targets;
+        return last->target_count;
+    }
+    return 0;
+}
+
+// ==================== SSA CONSTRUCTION ====================
+
+void ir_write_var(IRFunction *fn, int var, int block, int value) {
+    IRBlock *b = &fn->blocks[block];
+    if (var >= b->def_count) {
+        int count = fn->var_count > var + 1 ? fn->var_count : var + 1;
+        b->defs = (int*)realloc(b->defs, count * sizeof(int));
+        for (int i = b->def_count; i < count; i++) b->defs[i] = -1;
+        b->def_count = count;
+    }
+    b->defs[var] = value;
+    if (!fn->instrs[value].var) fn->instrs[value].var = var + 1;
+}
+
+int ir_new_phi(IRFunction *fn, int block) {
+    int phi = ir_new_instr(fn, IR_PHI, block, 0);
+    IRBlock *b = &fn->blocks[block];
+    ir_int_push(&b->phis, &b->phi_count, &b->phi_capacity, phi);
+    return phi;
+}
+
+int ir_read_var(IRFunction *fn, int var, int block);
+
+void ir_add_phi_operands(IRFunction *fn, int var, int phi) {
+    int block = fn->instrs[phi].block;
+    int count = fn->blocks[block].pred_count;
+    int *args = (int*)malloc((count ? count : 1) * sizeof(int));
+    for (int i = 0; i < count; i++) {
+        args[i] = ir_read_var(fn, var, fn->blocks[block].preds[i]);
+    }
+    fn->instrs[phi].args = args;
+    fn->instrs[phi].arg_count = count;
+}
+
+int ir_read_var(IRFunction *fn, int var, int block) {
+    IRBlock *b = &fn->blocks[block];
+    if (var < b->def_count && b->defs[var] >= 0) return b->defs[var];
+
+    int value;
+    if (!b->sealed) {
+        value = ir_new_phi(fn, block);
+        b = &fn->blocks[block];
+        ir_int_push(&b->incomplete, &b->incomplete_count, &b->incomplete_capacity, var);
+        ir_int_push(&b->incomplete, &b->incomplete_count, &b->incomplete_capacity, value);
+    } else if (b->pred_count == 0) {
+        // Sin definicion (bloque inalcanzable): un 0 al principio del bloque
+        value = ir_new_instr(fn, IR_CONST, block, 0);
+        b = &fn->blocks[block];
+        ir_int_push(&b->code, &b->code_count, &b->code_capacity, value);
+        memmove(b->code + 1, b->code, (b->code_count - 1) * sizeof(int));
+        b->code[0] = value;
+    } else if (b->pred_count == 1) {
+        value = ir_read_var(fn, var, b->preds[0]);
+    } else {
+        value = ir_new_phi(fn, block);
+        ir_write_var(fn, var, block, value);
+        ir_add_phi_operands(fn, var, value);
+    }
+    ir_write_var(fn, var, block, value);
+    return value;
+}
+
+void ir_seal(IRFunction *fn, int block) {
+    IRBlock *b = &fn->blocks[block];
+    for (int i = 0; i + 1 < b->incomplete_count; i += 2) {
+        ir_add_phi_operands(fn, b->incomplete[i], b->incomplete[i + 1]);
+        b = &fn->blocks[block];
+    }
+    free(b->incomplete);
+    b->incomplete = NULL;
+    b->incomplete_count = 0;
+    b->sealed = 1;
+}
+
+int ir_find_var(IRFunction *fn, const char *name) {
+    for (int i = fn->var_count - 1; i >= 0; i--) {
+        if (strcmp(fn->vars[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+int ir_declare_var(IRFunction *fn, const char *name, int array) {
+    fn->vars = (IRVar*)realloc(fn->vars, (fn->var_count + 1) * sizeof(IRVar));
+    fn->vars[fn->var_count].name = name;
+    fn->vars[fn->var_count].array = array;
+    fn->vars[fn->var_count].line = fn->line;
+    return fn->var_count++;
+}
+
+// ==================== LOWERING ====================
+
+int ir_expression(IRFunction *fn, ASTNode *node);
+void ir_statement(IRFunction *fn, ASTNode *node);
+
+IROp ir_binary_op(const char *op) {
+    const char *names[] = {"+", "-", "*", "/", "%", "==", "!=", "<", ">", "<=", ">=", "&&", "||", NULL};
+    const IROp ops[] = {IR_ADD, IR_SUB, IR_MUL, IR_DIV, IR_MOD, IR_EQ, IR_NE,
+                        IR_LT, IR_GT, IR_LE, IR_GE, IR_AND, IR_OR};
+    for (int i = 0; names[i]; i++) {
+        if (strcmp(names[i], op) == 0) return ops[i];
+    }
+    return IR_CONST;
+}
+
+int ir_scalar(IRFunction *fn, const char *name) {
+    int var = ir_find_var(fn, name);
+    if (var < 0) {
+        ir_fail(fn, "unknown variable", name);
+        return -1;
+    }
+    if (fn->vars[var].array >= 0) {
+        ir_fail(fn, "array used as a scalar:", name);
+        return -1;
+    }
+    return var;
+}
+
+int ir_array(IRFunction *fn, const char *name) {
+    int var = ir_find_var(fn, name);
+    if (var < 0 || fn->vars[var].array < 0) {
+        ir_fail(fn, "not an array:", name);
+        return -1;
+    }
+    return fn->vars[var].array;
+}
+
+int ir_call(IRFunction *fn, ASTNode *node) {
+    const char *name = node->value;
+
+    if (strcmp(name, "print") == 0) {
+        int count = node->child_count;
+        int *args = (int*)malloc((count ? count : 1) * sizeof(int));
+        const char **strings = (const char**)calloc(count ? count : 1, sizeof(char*));
+        for (int i = 0; i < count; i++) {
+            ASTNode *arg = node->children[i];
+            if (arg->type == AST_STRING) {
+                strings[i] = arg->value;
+                args[i] = -1;
+            } else {
+                args[i] = ir_expression(fn, arg);
+            }
+        }
+        int v = ir_emit(fn, IR_PRINT, 0);
+        fn->instrs[v].args = args;
+        fn->instrs[v].arg_count = count;
+        fn->instrs[v].strings = strings;
+        return v;
+    }
+
+    if (strcmp(name, "exit") == 0) {
+        int code = node->child_count > 0 ? ir_expression(fn, node->children[0]) : ir_const(fn, 0);
+        return ir_unary(fn, IR_EXIT, code);
+    }
+
+    if (strcmp(name, "read_int") == 0 || strcmp(name, "eof") == 0) {
+        if (node->child_count != 0) {
+            error("%s() expects 0 argument(s), got %d", name, node->child_count);
+        }
+        return ir_emit(fn, strcmp(name, "eof") == 0 ? IR_EOF : IR_READ_INT, 0);
+    }
+
+    if (codegen_is_builtin(name)) {
+        ir_fail(fn, "builtin not supported:", name);
+        return ir_const(fn, 0);
+    }
+
+    int count = node->child_count;
+    int *args = (int*)malloc((count ? count : 1) * sizeof(int));
+    for (int i = 0; i < count; i++) {
+        args[i] = ir_expression(fn, node->children[i]);
+    }
+    int v = ir_emit(fn, IR_CALL, 0);
+    fn->instrs[v].args = args;
+    fn->instrs[v].arg_count = count;
+    fn->instrs[v].text = name;
+    return v;
+}
+
+int ir_expression(IRFunction *fn, ASTNode *node) {
+    if (fn->reason[0]) return ir_const(fn, 0);
+
+    switch (node->type) {
+        case AST_NUMBER:
+            return ir_const(fn, strtoll(node->value, NULL, 10));
+
+        case AST_STRING: {
+            int v = ir_emit(fn, IR_STR, 0);
+            fn->instrs[v].text = node->value;
+            return v;
+        }
+
+        case AST_IDENTIFIER: {
+            int var = ir_scalar(fn, node->value);
+            if (var < 0) return ir_const(fn, 0);
+            return ir_read_var(fn, var, fn->current);
+        }
+
+        case AST_ARRAY_ACCESS: {
+            int array = ir_array(fn, node->value);
+            if (array < 0) return ir_const(fn, 0);
+            int index = ir_expression(fn, node->left);
+            int v = ir_unary(fn, IR_LOAD, index);
+            fn->instrs[v].constant = array;
+            return v;
+        }
+
+        case AST_UNARY_OP: {
+            int operand = ir_expression(fn, node->left);
+            if (strcmp(node->value, "!") == 0) return ir_unary(fn, IR_NOT, operand);
+            if (strcmp(node->value, "-") == 0) return ir_unary(fn, IR_NEG, operand);
+            return operand;
+        }
+
+        case AST_BINARY_OP: {
+            // Mismo orden de evaluacion que el generador directo: derecha primero
+            int right = ir_expression(fn, node->right);
+            int left = ir_expression(fn, node->left);
+            IROp op = ir_binary_op(node->value);
+            if (op == IR_CONST) {
+                ir_fail(fn, "unknown operator", node->value);
+                return ir_const(fn, 0);
+            }
+            return ir_binary(fn, op, left, right);
+        }
+
+        case AST_CALL:
+            return ir_call(fn, node);
+
+        default:
+            ir_fail(fn, "unsupported expression", NULL);
+            return ir_const(fn, 0);
+    }
+}
+
+void ir_block_statements(IRFunction *fn, ASTNode *block) {
+    for (int i = 0; i < block->child_count; i++) {
+        ir_statement(fn, block->children[i]);
+    }
+}
+
+// Tras return/break/continue el codigo sigue en un bloque inalcanzable
+void ir_start_dead_block(IRFunction *fn) {
+    fn->current = ir_new_block(fn);
+    ir_seal(fn, fn->current);
+}
+
+void ir_statement(IRFunction *fn, ASTNode *node) {
+    if (fn->reason[0]) return;
+    fn->line = node->line;
+
+    switch (node->type) {
+        case AST_VAR_DECL: {
+            const char *type = node->left->value;
+            if (strcmp(type, "string") == 0) {
+                ir_fail(fn, "string variable", node->value);
+                return;
+            }
+            int value = node->right ? ir_expression(fn, node->right) : ir_const(fn, 0);
+            if (node->right && node->right->type == AST_IDENTIFIER) {
+                value = ir_unary(fn, IR_COPY, value);
+            }
+            int var = ir_declare_var(fn, node->value, -1);
+            ir_write_var(fn, var, fn->current, value);
+            return;
+        }
+
+        case AST_ARRAY_DECL: {
+            fn->array_sizes = (int*)realloc(fn->array_sizes, (fn->array_count + 1) * sizeof(int));
+            fn->array_sizes[fn->array_count] = atoi(node->right->value);
+            fn->array_tables = (ASTNode**)realloc(fn->array_tables, (fn->array_count + 1) * sizeof(ASTNode*));
+            fn->array_tables[fn->array_count] = NULL;
+            if (node->child_count > 0 && node->children[0]->type == AST_BLOCK) {
+                fn->array_tables[fn->array_count] = node->children[0];
+                int init = ir_emit(fn, IR_INIT, 0);
+                fn->instrs[init].constant = fn->array_count;
+            }
+            ir_declare_var(fn, node->value, fn->array_count++);
+            return;
+        }
+
+        case AST_ASSIGNMENT: {
+            if (node->left) {
+                int array = ir_array(fn, node->value);
+                if (array < 0) return;
+                int value = ir_expression(fn, node->right);
+                int index = ir_expression(fn, node->left);
+                int store = ir_binary(fn, IR_STORE, index, value);
+                fn->instrs[store].constant = array;
+                return;
+            }
+            int var = ir_scalar(fn, node->value);
+            if (var < 0) return;
+            int value = ir_expression(fn, node->right);
+            if (node->right->type == AST_IDENTIFIER) {
+                value = ir_unary(fn, IR_COPY, value);
+            }
+            ir_write_var(fn, var, fn->current, value);
+            return;
+        }
+
+        case AST_INCREMENT:
+        case AST_DECREMENT: {
+            int var = ir_scalar(fn, node->value);
+            if (var < 0) return;
+            int value = ir_read_var(fn, var, fn->current);
+            value = ir_binary(fn, node->type == AST_INCREMENT ? IR_ADD : IR_SUB, value, ir_const(fn, 1));
+            ir_write_var(fn, var, fn->current, value);
+            return;
+        }
+
+        case AST_RETURN: {
+            int value = node->left ? ir_expression(fn, node->left) : ir_const(fn, 0);
+            ir_unary(fn, IR_RETURN, value);
+            ir_start_dead_block(fn);
+            return;
+        }
+
+        case AST_IF: {
+            int cond = ir_expression(fn, node->left);
+            int then_block = ir_new_block(fn);
+            int else_block = node->child_count > 1 ? ir_new_block(fn) : -1;
+            int join = ir_new_block(fn);
+            ir_branch(fn, cond, then_block, else_block >= 0 ? else_block : join);
+            ir_weigh(fn, node->children[0]->count, node->count - node->children[0]->count);
+            int cold = codegen_if_cold(node);
+            if (cold == 0) fn->blocks[then_block].cold = 1;
+            if (cold == 1) fn->blocks[else_block].cold = 1;
+
+            ir_seal(fn, then_block);
+            fn->current = then_block;
+            ir_block_statements(fn, node->children[0]);
+            ir_jump(fn, join);
+
+            if (else_block >= 0) {
+                ir_seal(fn, else_block);
+                fn->current = else_block;
+                ir_block_statements(fn, node->children[1]);
+                ir_jump(fn, join);
+            }
+            ir_seal(fn, join);
+            fn->current = join;
+            return;
+        }
+
+        case AST_LOOP: {
+            if (fn->loop_depth >= 50) {
+                ir_fail(fn, "loops nested too deeply", NULL);
+                return;
+            }
+            int head = ir_new_block(fn);
+            int body = ir_new_block(fn);
+            int exit = ir_new_block(fn);
+            ir_jump(fn, head);
+
+            fn->current = head;
+            int cond = ir_expression(fn, node->left);
+            ir_branch(fn, cond, body, exit);
+            ir_weigh(fn, node->right->count, node->count);
+
+            ir_seal(fn, body);
+            fn->current = body;
+            fn->loop_heads[fn->loop_depth] = head;
+            fn->loop_exits[fn->loop_depth] = exit;
+            fn->loop_depth++;
+            ir_block_statements(fn, node->right);
+            fn->loop_depth--;
+            ir_jump(fn, head);
+
+            ir_seal(fn, head);
+            ir_seal(fn, exit);
+            fn->current = exit;
+            return;
+        }
+
+        case AST_SWITCH: {
+            int value = ir_expression(fn, node->left);
+            int end = ir_new_block(fn);
+            int *blocks = (int*)malloc((node->child_count + 1) * sizeof(int));
+            int default_block = end;
+            for (int i = 0; i < node->child_count; i++) {
+                blocks[i] = ir_new_block(fn);
+                if (strcmp(node->children[i]->value, "default") == 0) default_block = blocks[i];
+            }
+
+            int s = ir_emit(fn, IR_SWITCH, 1);
+            IRInstr *instr = &fn->instrs[s];
+            instr->args[0] = value;
+            instr->case_count = codegen_switch_cases(node, blocks, &instr->cases);
+            instr->targets = (int*)malloc((node->child_count + 1) * sizeof(int));
+            instr->targets[instr->target_count++] = default_block;
+            for (int i = 0; i < node->child_count; i++) {
+                if (blocks[i] != default_block) instr->targets[instr->target_count++] = blocks[i];
+            }
+            for (int t = 0; t < instr->target_count; t++) {
+                ir_add_pred(fn, instr->targets[t], fn->current);
+            }
+
+            for (int i = 0; i < node->child_count; i++) {
+                ir_seal(fn, blocks[i]);
+                fn->current = blocks[i];
+                ir_block_statements(fn, node->children[i]->right);
+                ir_jump(fn, end);
+            }
+            ir_seal(fn, end);
+            fn->current = end;
+            free(blocks);
+            return;
+        }
+
+        case AST_BREAK:
+        case AST_CONTINUE:
+            if (fn->loop_depth == 0) {
+                ir_fail(fn, "break/continue outside of loop", NULL);
+                return;
+            }
+            ir_jump(fn, node->type == AST_BREAK ? fn->loop_exits[fn->loop_depth - 1]
+                                                 : fn->loop_heads[fn->loop_depth - 1]);
+            ir_start_dead_block(fn);
+            return;
+
+        case AST_CALL:
+        case AST_BINARY_OP:
+            ir_expression(fn, node);
+            return;
+
+        case AST_PARALLEL_LOOP:
+            ir_fail(fn, "parallel loop", NULL);
+            return;
+
+        default:
+            // El generador directo ignora el resto de sentencias (p. ej. una
+            // expresion suelta): aqui tampoco generan nada
+            return;
+    }
+}
+
+void ir_free(IRFunction *fn) {
+    for (int i = 0; i < fn->instr_count; i++) {
+        free(fn->instrs[i].args);
+        free(fn->instrs[i].strings);
+        free(fn->instrs[i].targets);
+        free(fn->instrs[i].cases);
+    }
+    for (int i = 0; i < fn->block_count; i++) {
+        IRBlock *b = &fn->blocks[i];
+        free(b->phis);
+        free(b->code);
+        free(b->preds);
+        free(b->defs);
+        free(b->incomplete);
+    }
+    free(fn->instrs);
+    free(fn->blocks);
+    free(fn->vars);
+    free(fn->array_sizes);
+    free(fn->array_tables);
+    free(fn->order);
+    free(fn);
+}
+
+// ==================== IR PASSES ====================
+
+// Sigue las cadenas de copias hasta el valor original
+int ir_resolve(IRFunction *fn, int value) {
+    while (value >= 0 && fn->instrs[value].op == IR_COPY) {
+        value = fn->instrs[value].args[0];
+    }
+    return value;
+}
+
+void ir_remove_pred(IRFunction *fn, int block, int position) {
+    IRBlock *b = &fn->blocks[block];
+    for (int i = position; i + 1 < b->pred_count; i++) b->preds[i] = b->preds[i + 1];
+    b->pred_count--;
+    for (int p = 0; p < b->phi_count; p++) {
+        IRInstr *phi = &fn->instrs[b->phis[p]];
+        if (phi->op != IR_PHI) continue;
+        for (int i = position; i + 1 < phi->arg_count; i++) phi->args[i] = phi->args[i + 1];
+        phi->arg_count--;
+    }
+}
+
+void ir_postorder(IRFunction *fn, int block, int *visited, int *out, int *count) {
+    // Recorrido iterativo: las funciones generadas pueden tener miles de bloques
+    int *stack = (int*)malloc(fn->block_count * 2 * sizeof(int));
+    int top = 0;
+    stack[top++] = block;
+    stack[top++] = 0;
+    visited[block] = 1;
+    while (top > 0) {
+        int b = stack[top - 2];
+        int next = stack[top - 1];
+        int *succs = NULL;
+        int n = ir_successors(fn, b, &succs);
+        if (next < n) {
+            stack[top - 1]++;
+            // Con perfil el destino mas frecuente se visita el ultimo: en el
+            // postorden inverso queda detras del branch y no salta
+            IRInstr *last = &fn->instrs[fn->blocks[b].code[fn->blocks[b].code_count - 1]];
+            if (last->op == IR_BRANCH && last->weight[0] > last->weight[1]) next = n - 1 - next;
+            if (!visited[succs[next]]) {
+                visited[succs[next]] = 1;
+                stack[top++] = succs[next];
+                stack[top++] = 0;
+            }
+        } else {
+            out[(*count)++] = b;
+            top -= 2;
+        }
+    }
+    free(stack);
+}
+
+// Calcula fn->order (postorden inverso) y quita los bloques inalcanzables
+void ir_compute_order(IRFunction *fn) {
+    int *visited = (int*)calloc(fn->block_count, sizeof(int));
+    int *post = (int*)malloc(fn->block_count * sizeof(int));
+    int count = 0;
+    ir_postorder(fn, 0, visited, post, &count);
+
+    free(fn->order);
+    fn->order = (int*)malloc(count * sizeof(int));
+    fn->order_count = count;
+    for (int i = 0; i < count; i++) {
+        fn->order[i] = post[count - 1 - i];
+        fn->blocks[fn->order[i]].rpo = i;
+    }
+    for (int b = 0; b < fn->block_count; b++) {
+        fn->blocks[b].reachable = visited[b];
+    }
+    for (int i = 0; i < count; i++) {
+        int b = fn->order[i];
+        for (int p = fn->blocks[b].pred_count - 1; p >= 0; p--) {
+            if (!visited[fn->blocks[b].preds[p]]) ir_remove_pred(fn, b, p);
+        }
+    }
+    free(visited);
+    free(post);
+}
+
+// Un phi cuyos argumentos son todos el mismo valor (o el propio phi) es una
+// copia de ese valor; repetir hasta que no cambie nada
+void ir_remove_trivial_phis(IRFunction *fn) {
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 0; i < fn->order_count; i++) {
+            IRBlock *b = &fn->blocks[fn->order[i]];
+            for (int p = 0; p < b->phi_count; p++) {
+                IRInstr *phi = &fn->instrs[b->phis[p]];
+                if (phi->op != IR_PHI) continue;
+                int same = -1, trivial = 1;
+                for (int a = 0; a < phi->arg_count; a++) {
+                    int arg = ir_resolve(fn, phi->args[a]);
+                    phi->args[a] = arg;
+                    if (arg == b->phis[p] || arg == same) continue;
+                    if (same >= 0) {
+                        trivial = 0;
+                        break;
+                    }
+                    same = arg;
+                }
+                if (!trivial || same < 0) continue;
+                phi->op = IR_COPY;
+                phi->arg_count = 1;
+                phi->args[0] = same;
+                changed = 1;
+            }
+        }
+    }
+}
+
+// Propagacion de copias: cada uso pasa a referirse al valor original
+void ir_copy_propagation(IRFunction *fn) {
+    for (int i = 0; i < fn->order_count; i++) {
+        IRBlock *b = &fn->blocks[fn->order[i]];
+        for (int k = 0; k < b->phi_count + b->code_count; k++) {
+            IRInstr *instr = &fn->instrs[k < b->phi_count ? b->phis[k] : b->code[k - b->phi_count]];
+            for (int a = 0; a < instr->arg_count; a++) {
+                if (instr->args[a] >= 0) instr->args[a] = ir_resolve(fn, instr->args[a]);
+            }
+        }
+    }
+}
+
+// Dominadores inmediatos (Cooper, Harvey y Kennedy) sobre fn->order
+void ir_dominators(IRFunction *fn) {
+    for (int i = 0; i < fn->order_count; i++) fn->blocks[fn->order[i]].idom = -1;
+    int entry = fn->order[0];
+    fn->blocks[entry].idom = entry;
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        for (int i = 1; i < fn->order_count; i++) {
+            IRBlock *b = &fn->blocks[fn->order[i]];
+            int idom = -1;
+            for (int p = 0; p < b->pred_count; p++) {
+                int pred = b->preds[p];
+                if (fn->blocks[pred].idom < 0) continue;
+                if (idom < 0) {
+                    idom = pred;
+                    continue;
+                }
+                int x = pred, y = idom;
+                while (x != y) {
+                    while (fn->blocks[x].rpo > fn->blocks[y].rpo) x = fn->blocks[x].idom;
+                    while (fn->blocks[y].rpo > fn->blocks[x].rpo) y = fn->blocks[y].idom;
+                }
+                idom = x;
+            }
+            if (b->idom != idom) {
+                b->idom = idom;
+                changed = 1;
+            }
+        }
+    }
+}
+
+int ir_is_pure(IROp op) {
+    return op == IR_CONST || op == IR_STR || (op >= IR_ADD && op <= IR_NEG);
+}
+
+int ir_is_commutative(IROp op) {
+    return op == IR_ADD || op == IR_MUL || op == IR_EQ || op == IR_NE || op == IR_AND || op == IR_OR;
+}
+
+typedef struct {
+    int *heads;      // cubo -> ultima entrada
+    unsigned int mask;
+    int *next;       // valor -> siguiente entrada del mismo cubo
+    int *stack;      // valores insertados, para deshacer al salir de un bloque
+    int stack_count;
+} IRCseTable;
+
+unsigned int ir_cse_hash(IRInstr *instr) {
+    unsigned long long h = instr->op * 31 + instr->constant;
+    for (int a = 0; a < instr->arg_count; a++) h = h * 1000003 + instr->args[a];
+    for (const char *c = instr->text; c && *c; c++) h = h * 31 + (unsigned char)*c;
+    return (unsigned int)(h ^ (h >> 29));
+}
+
+int ir_cse_equal(IRInstr *a, IRInstr *b) {
+    if (a->op != b->op || a->constant != b->constant || a->arg_count != b->arg_count) return 0;
+    for (int i = 0; i < a->arg_count; i++) {
+        if (a->args[i] != b->args[i]) return 0;
+    }
+    if (a->text || b->text) return a->text && b->text && strcmp(a->text, b->text) == 0;
+    return 1;
+}
+
+// Plegado de constantes: una operacion pura con todos los argumentos
+// constantes pasa a ser const. La division se deja al ejecutar (idiv puede
+// fallar). Devuelve 1 si ha plegado.
+int ir_fold(IRFunction *fn, IRInstr *instr) {
+    if (instr->op < IR_ADD || instr->op > IR_NEG || instr->op == IR_DIV || instr->op == IR_MOD) return 0;
+    for (int a = 0; a < instr->arg_count; a++) {
+        if (fn->instrs[instr->args[a]].op != IR_CONST) return 0;
+    }
+    unsigned long long x = (unsigned long long)fn->instrs[instr->args[0]].constant;
+    unsigned long long y = instr->arg_count > 1 ? (unsigned long long)fn->instrs[instr->args[1]].constant : 0;
+    long long value;
+    switch (instr->op) {
+        case IR_ADD: value = (long long)(x + y); break;
+        case IR_SUB: value = (long long)(x - y); break;
+        case IR_MUL: value = (long long)(x * y); break;
+        case IR_EQ: value = x == y; break;
+        case IR_NE: value = x != y; break;
+        case IR_LT: value = (long long)x < (long long)y; break;
+        case IR_GT: value = (long long)x > (long long)y; break;
+        case IR_LE: value = (long long)x <= (long long)y; break;
+        case IR_GE: value = (long long)x >= (long long)y; break;
+        case IR_AND: value = (long long)(x & y); break;
+        case IR_OR: value = (long long)(x | y); break;
+        case IR_NOT: value = x == 0; break;
+        default: value = (long long)(0 - x); break;
+    }
+    instr->op = IR_CONST;
+    instr->arg_count = 0;
+    instr->constant = value;
+    return 1;
+}
+
+// Entradas (array, indice) -> valor conocido, validas dentro de un bloque
+#define IR_MEMORY_ENTRIES 32
+
+typedef struct {
+    long long array[IR_MEMORY_ENTRIES];
+    int index[IR_MEMORY_ENTRIES];
+    int value[IR_MEMORY_ENTRIES];
+    int count;
+} IRMemory;
+
+void ir_memory_kill(IRMemory *memory, long long array) {
+    int kept = 0;
+    for (int i = 0; i < memory->count; i++) {
+        if (memory->array[i] == array) continue;
+        memory->array[kept] = memory->array[i];
+        memory->index[kept] = memory->index[i];
+        memory->value[kept] = memory->value[i];
+        kept++;
+    }
+    memory->count = kept;
+}
+
+// Un store solo invalida las entradas del array que pueden ser el mismo
+// elemento: dos indices constantes distintos no lo son
+void ir_memory_store(IRFunction *fn, IRMemory *memory, long long array, int index) {
+    int kept = 0;
+    for (int i = 0; i < memory->count; i++) {
+        int other = memory->index[i];
+        if (memory->array[i] == array &&
+            !(fn->instrs[index].op == IR_CONST && fn->instrs[other].op == IR_CONST &&
+              fn->instrs[index].constant != fn->instrs[other].constant)) continue;
+        memory->array[kept] = memory->array[i];
+        memory->index[kept] = memory->index[i];
+        memory->value[kept] = memory->value[i];
+        kept++;
+    }
+    memory->count = kept;
+}
+
+void ir_memory_add(IRMemory *memory, long long array, int index, int value) {
+    if (memory->count == IR_MEMORY_ENTRIES) {
+        memmove(memory->array, memory->array + 1, (IR_MEMORY_ENTRIES - 1) * sizeof(long long));
+        memmove(memory->index, memory->index + 1, (IR_MEMORY_ENTRIES - 1) * sizeof(int));
+        memmove(memory->value, memory->value + 1, (IR_MEMORY_ENTRIES - 1) * sizeof(int));
+        memory->count--;
+    }
+    memory->array[memory->count] = array;
+    memory->index[memory->count] = index;
+    memory->value[memory->count] = value;
+    memory->count++;
+}
+
+int ir_memory_find(IRMemory *memory, long long array, int index) {
+    for (int i = memory->count - 1; i >= 0; i--) {
+        if (memory->array[i] == array && memory->index[i] == index) return memory->value[i];
+    }
+    return -1;
+}
+
+// CSE sobre el arbol de dominadores: una expresion pura ya calculada en un
+// bloque dominante se reutiliza, tras plegarla si es constante. Las cargas de arrays se reutilizan (o se
+// toman del ultimo store al mismo indice) solo dentro del bloque.
+void ir_cse(IRFunction *fn) {
+    IRCseTable table;
+    // Tantos cubos como instrucciones (potencia de dos)
+    unsigned int buckets = 64;
+    while (buckets < (unsigned int)fn->instr_count) buckets *= 2;
+    table.mask = buckets - 1;
+    table.heads = (int*)malloc(buckets * sizeof(int));
+    for (unsigned int i = 0; i < buckets; i++) table.heads[i] = -1;
+    table.next = (int*)malloc(fn->instr_count * sizeof(int));
+    table.stack = (int*)malloc(fn->instr_count * sizeof(int));
+    table.stack_count = 0;
+
+    // Hijos de cada bloque en el arbol de dominadores, en orden RPO
+    int *child_count = (int*)calloc(fn->block_count, sizeof(int));
+    int *child_start = (int*)calloc(fn->block_count + 1, sizeof(int));
+    int *children = (int*)malloc((fn->order_count ? fn->order_count : 1) * sizeof(int));
+    for (int i = 1; i < fn->order_count; i++) child_count[fn->blocks[fn->order[i]].idom]++;
+    for (int b = 0; b < fn->block_count; b++) child_start[b + 1] = child_start[b] + child_count[b];
+    memset(child_count, 0, fn->block_count * sizeof(int));
+    for (int i = 1; i < fn->order_count; i++) {
+        int b = fn->order[i];
+        int parent = fn->blocks[b].idom;
+        children[child_start[parent] + child_count[parent]++] = b;
+    }
+
+    // Recorrido en preorden con pila explicita; mark[] guarda el tamaño de
+    // la tabla al entrar en cada bloque
+    int *stack = (int*)malloc((fn->order_count * 2 + 2) * sizeof(int));
+    int top = 0;
+    stack[top++] = fn->order[0];
+    stack[top++] = -1;
+    while (top > 0) {
+        int b = stack[top - 2];
+        int state = stack[top - 1];
+        if (state >= 0) {
+            // Salida del bloque: deshacer sus entradas
+            while (table.stack_count > state) {
+                int v = table.stack[--table.stack_count];
+                table.heads[ir_cse_hash(&fn->instrs[v]) & table.mask] = table.next[v];
+            }
+            top -= 2;
+            continue;
+        }
+        stack[top - 1] = table.stack_count;
+
+        IRBlock *block = &fn->blocks[b];
+        IRMemory memory;
+        memory.count = 0;
+        for (int k = 0; k < block->code_count; k++) {
+            int v = block->code[k];
+            IRInstr *instr = &fn->instrs[v];
+            for (int a = 0; a < instr->arg_count; a++) {
+                if (instr->args[a] >= 0) instr->args[a] = ir_resolve(fn, instr->args[a]);
+            }
+
+            if (instr->op == IR_LOAD) {
+                int known = ir_memory_find(&memory, instr->constant, instr->args[0]);
+                if (known >= 0) {
+                    instr->op = IR_COPY;
+                    instr->args[0] = known;
+                    instr->reused = 1;
+                } else {
+                    ir_memory_add(&memory, instr->constant, instr->args[0], v);
+                }
+                continue;
+            }
+            if (instr->op == IR_INIT) {
+                ir_memory_kill(&memory, instr->constant);
+                continue;
+            }
+            if (instr->op == IR_STORE) {
+                ir_memory_store(fn, &memory, instr->constant, instr->args[0]);
+                ir_memory_add(&memory, instr->constant, instr->args[0], instr->args[1]);
+                continue;
+            }
+            if (!ir_is_pure(instr->op)) continue;
+            ir_fold(fn, instr);
+
+            if (ir_is_commutative(instr->op) && instr->args[0] > instr->args[1]) {
+                int t = instr->args[0];
+                instr->args[0] = instr->args[1];
+                instr->args[1] = t;
+            }
+            unsigned int h = ir_cse_hash(instr) & table.mask;
+            int found = -1;
+            for (int e = table.heads[h]; e >= 0; e = table.next[e]) {
+                if (ir_cse_equal(&fn->instrs[e], instr)) {
+                    found = e;
+                    break;
+                }
+            }
+            if (found >= 0) {
+                instr->op = IR_COPY;
+                instr->arg_count = 1;
+                if (!instr->args) instr->args = (int*)malloc(sizeof(int));
+                instr->args[0] = found;
+                instr->text = NULL;
+            } else {
+                table.next[v] = table.heads[h];
+                table.heads[h] = v;
+                table.stack[table.stack_count++] = v;
+            }
+        }
+
+        for (int c = child_start[b + 1] - 1; c >= child_start[b]; c--) {
+            stack[top++] = children[c];
+            stack[top++] = -1;
+        }
+    }
+
+    free(stack);
+    free(children);
+    free(child_start);
+    free(child_count);
+    free(table.heads);
+    free(table.next);
+    free(table.stack);
+    ir_copy_propagation(fn);
+}
+
+// Eliminacion de stores muertos: los de arrays que nunca se leen, y los que
+// se sobrescriben en el mismo bloque (mismo indice) sin una carga entre medias
+void ir_dse(IRFunction *fn) {
+    int *loaded = (int*)calloc(fn->array_count ? fn->array_count : 1, sizeof(int));
+    for (int i = 0; i < fn->order_count; i++) {
+        IRBlock *b = &fn->blocks[fn->order[i]];
+        for (int k = 0; k < b->code_count; k++) {
+            IRInstr *instr = &fn->instrs[b->code[k]];
+            if (instr->op == IR_LOAD) loaded[instr->constant] = 1;
+        }
+    }
+
+    for (int i = 0; i < fn->order_count; i++) {
+        IRBlock *b = &fn->blocks[fn->order[i]];
+        IRMemory overwritten;
+        overwritten.count = 0;
+        for (int k = b->code_count - 1; k >= 0; k--) {
+            IRInstr *instr = &fn->instrs[b->code[k]];
+            if (instr->op == IR_LOAD || instr->op == IR_INIT) {
+                ir_memory_kill(&overwritten, instr->constant);
+            } else if (instr->op == IR_STORE) {
+                if (!loaded[instr->constant] ||
+                    ir_memory_find(&overwritten, instr->constant, instr->args[0]) >= 0) {
+                    instr->dead = 1;
+                } else {
+                    ir_memory_add(&overwritten, instr->constant, instr->args[0], 0);
+                }
+            }
+        }
+    }
+    free(loaded);
+}
+
+int ir_has_effect(IRInstr *instr) {
+    switch (instr->op) {
+        case IR_STORE:
+            return !instr->dead;
+        case IR_INIT:
+        case IR_CALL:
+        case IR_PRINT:
+        case IR_EXIT:
+        case IR_READ_INT:
+        case IR_EOF:
+        case IR_JUMP:
+        case IR_BRANCH:
+        case IR_SWITCH:
+        case IR_RETURN:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+// Eliminacion de codigo muerto: se marcan las instrucciones con efectos y,
+// transitivamente, los valores que usan; el resto desaparece
+void ir_dce(IRFunction *fn) {
+    char *live = (char*)calloc(fn->instr_count, 1);
+    int *work = (int*)malloc(fn->instr_count * sizeof(int));
+    int count = 0;
+
+    for (int i = 0; i < fn->order_count; i++) {
+        IRBlock *b = &fn->blocks[fn->order[i]];
+        for (int k = 0; k < b->code_count; k++) {
+            int v = b->code[k];
+            if (ir_has_effect(&fn->instrs[v])) {
+                live[v] = 1;
+                work[count++] = v;
+            }
+        }
+    }
+    while (count > 0) {
+        IRInstr *instr = &fn->instrs[work[--count]];
+        for (int a = 0; a < instr->arg_count; a++) {
+            int arg = instr->args[a];
+            if (arg >= 0 && !live[arg]) {
+                live[arg] = 1;
+                work[count++] = arg;
+            }
+        }
+    }
+
+    for (int i = 0; i < fn->order_count; i++) {
+        IRBlock *b = &fn->blocks[fn->order[i]];
+        int kept = 0;
+        for (int p = 0; p < b->phi_count; p++) {
+            if (live[b->phis[p]]) b->phis[kept++] = b->phis[p];
+        }
+        b->phi_count = kept;
+        kept = 0;
+        for (int k = 0; k < b->code_count; k++) {
+            if (live[b->code[k]]) b->code[kept++] = b->code[k];
+        }
+        b->code_count = kept;
+    }
+    for (int i = 0; i < fn->instr_count; i++) {
+        if (!live[i]) fn->instrs[i].dead = 1;
+    }
+    free(live);
+    free(work);
+}
+
+// Parte las aristas criticas (origen con varios sucesores, destino con
+// varios predecesores) que llegan a bloques con phis: el backend coloca las
+// copias de los phis al final del predecesor, que debe tener un solo sucesor
+void ir_split_critical_edges(IRFunction *fn) {
+    int count = fn->order_count;
+    int *blocks = (int*)malloc(count * sizeof(int));
+    memcpy(blocks, fn->order, count * sizeof(int));
+    for (int i = 0; i < count; i++) {
+        int b = blocks[i];
+        IRBlock *block = &fn->blocks[b];
+        IRInstr *last = &fn->instrs[block->code[block->code_count - 1]];
+        if (last->op != IR_BRANCH && last->op != IR_SWITCH) continue;
+        int *succs;
+        int n = ir_successors(fn, b, &succs);
+        for (int t = 0; t < n; t++) {
+            ir_successors(fn, b, &succs);
+            int target = succs[t];
+            if (fn->blocks[target].pred_count < 2 || fn->blocks[target].phi_count == 0) continue;
+
+            int split = ir_new_block(fn);
+            fn->blocks[split].sealed = 1;
+            fn->blocks[split].reachable = 1;
+            fn->current = split;
+            fn->line = fn->instrs[fn->blocks[b].code[fn->blocks[b].code_count - 1]].line;
+            int j = ir_emit(fn, IR_JUMP, 0);
+            fn->instrs[j].target[0] = target;
+            ir_add_pred(fn, split, b);
+            for (int p = 0; p < fn->blocks[target].pred_count; p++) {
+                if (fn->blocks[target].preds[p] == b) {
+                    fn->blocks[target].preds[p] = split;
+                    break;
+                }
+            }
+            IRInstr *terminator = &fn->instrs[fn->blocks[b].code[fn->blocks[b].code_count - 1]];
+            ir_successors(fn, b, &succs);
+            succs[t] = split;
+            for (int c = 0; c < terminator->case_count; c++) {
+                if (terminator->cases[c].target == target) terminator->cases[c].target = split;
+            }
+        }
+    }
+    free(blocks);
+    ir_compute_order(fn);
+}
+
+void ir_optimize(IRFunction *fn) {
+    ir_compute_order(fn);
+    ir_remove_trivial_phis(fn);
+    ir_copy_propagation(fn);
+    ir_dominators(fn);
+    ir_cse(fn);
+    ir_remove_trivial_phis(fn);
+    ir_copy_propagation(fn);
+    ir_dse(fn);
+    ir_dce(fn);
+    ir_split_critical_edges(fn);
+}
+
+// Baja una funcion a IR y la optimiza; devuelve NULL (y el motivo en
+// reason) si usa algo que el IR no soporta
+IRFunction* ir_build(ASTNode *node, char *reason, size_t reason_size) {
+    IRFunction *fn = (IRFunction*)calloc(1, sizeof(IRFunction));
+    fn->name = node->value;
+    fn->file = node->file;
+    fn->line = node->line;
+    fn->current = ir_new_block(fn);
+    ir_seal(fn, fn->current);
+
+    ASTNode *params = node->children[0];
+    for (int i = 0; i < params->child_count; i++) {
+        ASTNode *param = params->children[i];
+        if (strcmp(param->left->value, "string") == 0) {
+            ir_fail(fn, "string parameter", param->value);
+            break;
+        }
+        int value = ir_emit(fn, IR_PARAM, 0);
+        fn->instrs[value].constant = i;
+        int var = ir_declare_var(fn, param->value, -1);
+        ir_write_var(fn, var, fn->current, value);
+    }
+
+    ir_block_statements(fn, node->children[1]);
+    if (!fn->reason[0]) {
+        fn->line = node->line;
+        ir_unary(fn, IR_RETURN, ir_const(fn, 0));
+    }
+
+    if (fn->reason[0]) {
+        snprintf(reason, reason_size, "%s", fn->reason);
+        ir_free(fn);
+        return NULL;
+    }
+    ir_optimize(fn);
+    return fn;
+}
+
+// ==================== IR DUMP ====================
+
+void ir_dump_instr(IRFunction *fn, int v, FILE *out) {
+    IRInstr *instr = &fn->instrs[v];
+    fprintf(out, "    ");
+    if (instr->op != IR_STORE && instr->op != IR_INIT && !IR_TERMINATOR(instr->op) && instr->op != IR_EXIT) {
+        fprintf(out, "v%d = ", v);
+    }
+    fprintf(out, "%s", ir_op_names[instr->op]);
+
+    switch (instr->op) {
+        case IR_CONST:
+            fprintf(out, " %lld", instr->constant);
+            break;
+        case IR_STR:
+            fprintf(out, " ");
+            report_print_json_string(out, instr->text);
+            break;
+        case IR_PARAM:
+            fprintf(out, " %lld", instr->constant);
+            break;
+        case IR_PHI:
+            for (int a = 0; a < instr->arg_count; a++) {
+                fprintf(out, "%s [v%d, b%d]", a ? "," : "", instr->args[a],
+                        fn->blocks[instr->block].preds[a]);
+            }
+            break;
+        case IR_LOAD:
+            fprintf(out, " a%lld[v%d]", instr->constant, instr->args[0]);
+            break;
+        case IR_STORE:
+            fprintf(out, " a%lld[v%d], v%d", instr->constant, instr->args[0], instr->args[1]);
+            break;
+        case IR_INIT:
+            fprintf(out, " a%lld", instr->constant);
+            break;
+        case IR_CALL:
+            fprintf(out, " %s(", instr->text);
+            for (int a = 0; a < instr->arg_count; a++) fprintf(out, "%sv%d", a ? ", " : "", instr->args[a]);
+            fprintf(out, ")");
+            break;
+        case IR_PRINT:
+            for (int a = 0; a < instr->arg_count; a++) {
+                fprintf(out, "%s", a ? ", " : " ");
+                if (instr->strings[a]) report_print_json_string(out, instr->strings[a]);
+                else fprintf(out, "v%d", instr->args[a]);
+            }
+            break;
+        case IR_JUMP:
+            fprintf(out, " b%d", instr->target[0]);
+            break;
+        case IR_BRANCH:
+            fprintf(out, " v%d, b%d, b%d", instr->args[0], instr->target[0], instr->target[1]);
+            if (instr->weight[0] || instr->weight[1]) {
+                fprintf(out, "  ; %lld/%lld", instr->weight[0], instr->weight[1]);
+            }
+            break;
+        case IR_SWITCH:
+            fprintf(out, " v%d, default b%d", instr->args[0], instr->targets[0]);
+            for (int c = 0; c < instr->case_count; c++) {
+                fprintf(out, ", %lld b%d", instr->cases[c].value, instr->cases[c].target);
+            }
+            break;
+        default:
+            for (int a = 0; a < instr->arg_count; a++) fprintf(out, "%s v%d", a ? "," : "", instr->args[a]);
+            break;
+    }
+    fprintf(out, "\n");
+}
+
+void ir_dump(IRFunction *fn, FILE *out) {
+    fprintf(out, "func %s {\n", fn->name);
+    for (int a = 0; a < fn->array_count; a++) {
+        fprintf(out, "    a%d: int[%d]%s\n", a, fn->array_sizes[a], fn->array_tables[a] ? " = table" : "");
+    }
+    for (int i = 0; i < fn->order_count; i++) {
+        int b = fn->order[i];
+        IRBlock *block = &fn->blocks[b];
+        fprintf(out, "b%d:", b);
+        if (block->pred_count > 0) {
+            fprintf(out, "  ; preds");
+            for (int p = 0; p < block->pred_count; p++) fprintf(out, " b%d", block->preds[p]);
+        }
+        fprintf(out, "\n");
+        for (int p = 0; p < block->phi_count; p++) ir_dump_instr(fn, block->phis[p], out);
+        for (int k = 0; k < block->code_count; k++) ir_dump_instr(fn, block->code[k], out);
+    }
+    fprintf(out, "}\n\n");
+}
+
+// --emit=ir: el IR optimizado de cada funcion de un programa
+void ir_dump_program(ASTNode *program, FILE *out) {
+    char reason[160];
+    for (int i = 0; i < program->child_count; i++) {
+        ASTNode *node = program->children[i];
+        if (node->type != AST_FUNCTION) continue;
+        IRFunction *fn = ir_build(node, reason, sizeof(reason));
+        if (!fn) {
+            fprintf(out, "; func %s: not lowered (%s)\n\n", node->value, reason);
+            continue;
+        }
+        ir_dump(fn, out);
+        ir_free(fn);
+    }
+}
+
+// ==================== IR BACKEND ====================
+// Cada valor SSA vive en un registro o en un hueco de 8 bytes del marco.
+// Los rangos de vida (sobre el orden lineal de los bloques) se reparten
+// primero entre los registros libres; los que no caben van a huecos, que se
+// reutilizan entre valores cuyos rangos no se solapan. Las constantes no
+// ocupan sitio y se emiten como inmediatos. Las copias de los phis se hacen
+// al final de cada predecesor como una copia paralela.
+//
+// Convencion de llamada: la de System V (las funciones B se enlazan entre
+// objetos y con el runtime), o la interna de codegen_mark_internal, que
+// ademas respeta r10 y r11; en las dos, sin marco si la funcion no necesita
+// huecos ni arrays. Los valores que cruzan una llamada van en registros que
+// la llamada respeta (rbx, r12-r15 y, si todas las que cruzan son internas,
+// r10 y r11), que se guardan en el prologo solo si se usan; el resto
+// prefiere r8-r11, que no cuesta guardar. rax, rcx, rdx, rsi y rdi quedan
+// como temporales.
+
+const char *ir_registers[] = {"r8", "r9", "r10", "r11", "rbx", "r12", "r13", "r14", "r15"};
+#define IR_REGISTERS 9
+#define IR_CALLER_SAVED 4
+#define IR_INTERNAL_SAVED 2     // con la convencion interna, desde r10
+
+typedef struct {
+    IRFunction *fn;
+    int *slot;          // valor -> desplazamiento bajo rbp (0 = sin hueco)
+    char *reg;          // valor -> indice en ir_registers + 1 (0 = sin registro)
+    char *crosses;      // el valor sigue vivo tras una llamada (IR_CROSSES_*)
+    int *uses;
+    int *start;         // rango de vida: primera y ultima posicion
+    int *end;
+    int *position;
+    int *block_start;
+    int *block_end;
+    int *visited;
+    int *array_offset;
+    int *array_label;   // .L de la tabla calculada en compilacion
+    char *readonly;     // array con tabla que nunca se escribe: se lee de .rodata
+    char *fused;        // comparacion emitida junto a su branch
+    int frame_size;
+    int has_frame;      // push rbp / mov rbp, rsp
+    int saved;          // registros guardados en el prologo (bits de ir_registers)
+    int saved_count;
+    int pad;            // ajuste de rsp sin marco para llamar alineado a 16
+} IRFrame;
+
+int ir_defines_value(IRInstr *instr) {
+    return !instr->dead && instr->op != IR_STORE && instr->op != IR_INIT && !IR_TERMINATOR(instr->op) && instr->op != IR_EXIT;
+}
+
+int ir_is_call(IROp op) {
+    return op == IR_CALL || op == IR_PRINT || op == IR_READ_INT || op == IR_EOF;
+}
+
+// Llamada que puede cambiar r10 y r11: todas menos las internas
+int ir_clobbers(IRInstr *instr) {
+    return ir_is_call(instr->op) && !(instr->op == IR_CALL && codegen_is_internal(instr->text));
+}
+
+#define IR_CROSSES_INTERNAL 1   // solo llamadas internas
+#define IR_CROSSES_CALL 2
+
+void ir_extend(IRFrame *frame, int v, int position) {
+    if (position < frame->start[v]) frame->start[v] = position;
+    if (position > frame->end[v]) frame->end[v] = position;
+}
+
+// v esta vivo al final de block: extiende su rango y, si no se define ahi,
+// recorre hacia atras los predecesores donde tambien esta vivo
+void ir_live_out(IRFrame *frame, int v, int block, int *stack) {
+    IRFunction *fn = frame->fn;
+    int def_block = fn->instrs[v].block;
+    int top = 0;
+    stack[top++] = block;
+    while (top > 0) {
+        int b = stack[--top];
+        ir_extend(frame, v, frame->block_end[b]);
+        if (b == def_block || frame->visited[b] == v + 1) continue;
+        frame->visited[b] = v + 1;
+        ir_extend(frame, v, frame->block_start[b]);
+        for (int p = 0; p < fn->blocks[b].pred_count; p++) {
+            stack[top++] = fn->blocks[b].preds[p];
+        }
+    }
+}
+
+int ir_is_compare(IROp op) {
+    return op >= IR_EQ && op <= IR_GE;
+}
+
+void ir_frame_ranges(IRFrame *frame) {
+    IRFunction *fn = frame->fn;
+    int position = 0;
+    for (int i = 0; i < fn->order_count; i++) {
+        int b = fn->order[i];
+        IRBlock *block = &fn->blocks[b];
+        frame->block_start[b] = position;
+        for (int p = 0; p < block->phi_count; p++) frame->position[block->phis[p]] = position;
+        for (int k = 0; k < block->code_count; k++) frame->position[block->code[k]] = ++position;
+        frame->block_end[b] = position;
+        position++;
+    }
+
+    for (int v = 0; v < fn->instr_count; v++) {
+        frame->start[v] = frame->end[v] = frame->position[v];
+    }
+
+    int *stack = (int*)malloc((fn->block_count * 2 + 2) * sizeof(int) * 2);
+    for (int i = 0; i < fn->order_count; i++) {
+        int b = fn->order[i];
+        IRBlock *block = &fn->blocks[b];
+        for (int p = 0; p < block->phi_count; p++) {
+            IRInstr *phi = &fn->instrs[block->phis[p]];
+            for (int a = 0; a < phi->arg_count; a++) {
+                int pred = block->preds[a];
+                // El phi se escribe al final del predecesor
+                ir_extend(frame, block->phis[p], frame->block_end[pred]);
+                frame->uses[phi->args[a]]++;
+                ir_live_out(frame, phi->args[a], pred, stack);
+            }
+        }
+        for (int k = 0; k < block->code_count; k++) {
+            int u = block->code[k];
+            IRInstr *instr = &fn->instrs[u];
+            for (int a = 0; a < instr->arg_count; a++) {
+                int v = instr->args[a];
+                if (v < 0) continue;
+                frame->uses[v]++;
+                ir_extend(frame, v, frame->position[u]);
+                if (fn->instrs[v].block != b) {
+                    for (int p = 0; p < block->pred_count; p++) {
+                        ir_live_out(frame, v, block->preds[p], stack);
+                    }
+                }
+            }
+        }
+    }
+    free(stack);
+
+    // Un valor cruza una llamada si hay una estrictamente dentro de su
+    // rango; los argumentos de print tambien, porque se formatean uno a uno
+    int *calls = (int*)calloc(position + 2, sizeof(int));
+    int *clobbers = (int*)calloc(position + 2, sizeof(int));
+    for (int i = 0; i < fn->order_count; i++) {
+        IRBlock *block = &fn->blocks[fn->order[i]];
+        for (int k = 0; k < block->code_count; k++) {
+            IRInstr *instr = &fn->instrs[block->code[k]];
+            if (!ir_is_call(instr->op)) continue;
+            calls[frame->position[block->code[k]] + 1]++;
+            if (ir_clobbers(instr)) clobbers[frame->position[block->code[k]] + 1]++;
+            if (instr->op != IR_PRINT) continue;
+            for (int a = 0; a < instr->arg_count; a++) {
+                if (instr->args[a] >= 0) frame->crosses[instr->args[a]] = IR_CROSSES_CALL;
+            }
+        }
+    }
+    for (int p = 1; p <= position + 1; p++) {
+        calls[p] += calls[p - 1];
+        clobbers[p] += clobbers[p - 1];
+    }
+    for (int v = 0; v < fn->instr_count; v++) {
+        if (clobbers[frame->end[v]] - clobbers[frame->start[v] + 1] > 0) {
+            frame->crosses[v] = IR_CROSSES_CALL;
+        } else if (calls[frame->end[v]] - calls[frame->start[v] + 1] > 0 && !frame->crosses[v]) {
+            frame->crosses[v] = IR_CROSSES_INTERNAL;
+        }
+    }
+    free(calls);
+    free(clobbers);
+
+    // Una comparacion usada solo por el branch que la sigue no se guarda
+    for (int i = 0; i < fn->order_count; i++) {
+        IRBlock *block = &fn->blocks[fn->order[i]];
+        if (block->code_count < 2) continue;
+        IRInstr *last = &fn->instrs[block->code[block->code_count - 1]];
+        int cond = block->code[block->code_count - 2];
+        if (last->op == IR_BRANCH && last->args[0] == cond &&
+            ir_is_compare(fn->instrs[cond].op) && frame->uses[cond] == 1) {
+            frame->fused[cond] = 1;
+        }
+    }
+}
+
+int ir_compare_long(const void *a, const void *b) {
+    long long x = *(const long long*)a, y = *(const long long*)b;
+    return (x > y) - (x < y);
+}
+
+// Registros por barrido lineal: al empezar un rango se liberan los que ya
+// terminaron; si no queda ninguno valido se manda a memoria el rango que
+// acaba mas tarde (el nuevo o el que tenia el registro)
+void ir_frame_registers(IRFrame *frame, long long *keys, int count) {
+    IRFunction *fn = frame->fn;
+    int owner[IR_REGISTERS];
+    for (int r = 0; r < IR_REGISTERS; r++) owner[r] = -1;
+
+    for (int i = 0; i < count; i++) {
+        int v = keys[i] % fn->instr_count;
+        for (int r = 0; r < IR_REGISTERS; r++) {
+            if (owner[r] >= 0 && frame->end[owner[r]] < frame->start[v]) owner[r] = -1;
+        }
+        int first = frame->crosses[v] == IR_CROSSES_CALL ? IR_CALLER_SAVED :
+                    frame->crosses[v] == IR_CROSSES_INTERNAL ? IR_INTERNAL_SAVED : 0;
+        int chosen = -1;
+        for (int r = first; r < IR_REGISTERS && chosen < 0; r++) {
+            if (owner[r] < 0) chosen = r;
+        }
+        if (chosen < 0) {
+            int victim = first;
+            for (int r = first + 1; r < IR_REGISTERS; r++) {
+                if (frame->end[owner[r]] > frame->end[owner[victim]]) victim = r;
+            }
+            if (frame->end[owner[victim]] <= frame->end[v]) continue;
+            frame->reg[owner[victim]] = 0;
+            chosen = victim;
+        }
+        owner[chosen] = v;
+        frame->reg[v] = chosen + 1;
+    }
+
+    // Se guardan los que la funcion debe respetar y usa; con la convencion
+    // interna tambien r10 y r11, que ademas cambia cualquier llamada que no
+    // sea interna
+    int first_saved = codegen_is_internal(fn->name) ? IR_INTERNAL_SAVED : IR_CALLER_SAVED;
+    for (int v = 0; v < fn->instr_count; v++) {
+        if (frame->reg[v] > first_saved) frame->saved |= 1 << (frame->reg[v] - 1);
+        if (first_saved == IR_INTERNAL_SAVED && !fn->instrs[v].dead && ir_clobbers(&fn->instrs[v])) {
+            frame->saved |= (1 << IR_INTERNAL_SAVED) | (1 << (IR_INTERNAL_SAVED + 1));
+        }
+    }
+    for (int r = 0; r < IR_REGISTERS; r++) {
+        if (frame->saved & (1 << r)) frame->saved_count++;
+    }
+}
+
+// Asignacion lineal de huecos para los valores sin registro: al empezar un
+// rango se libera el hueco de los que ya terminaron (un monticulo ordenado
+// por final)
+void ir_frame_slots(IRFrame *frame) {
+    IRFunction *fn = frame->fn;
+    long long *keys = (long long*)malloc((fn->instr_count + 1) * sizeof(long long));
+    int count = 0;
+    int calls = 0;
+    for (int v = 0; v < fn->instr_count; v++) {
+        IRInstr *instr = &fn->instrs[v];
+        if (!instr->dead && ir_is_call(instr->op)) calls = 1;
+        if (!ir_defines_value(instr) || frame->uses[v] == 0 || frame->fused[v] ||
+            instr->op == IR_CONST || instr->op == IR_STR || instr->op == IR_COPY) continue;
+        // Ordena por inicio del rango (y por valor para ser deterministas)
+        keys[count++] = (long long)frame->start[v] * fn->instr_count + v;
+    }
+    qsort(keys, count, sizeof(long long), ir_compare_long);
+    ir_frame_registers(frame, keys, count);
+
+    int *heap = (int*)malloc((count + 1) * sizeof(int));
+    int *free_slots = (int*)malloc((count + 1) * sizeof(int));
+    int heap_count = 0, free_count = 0, slots = 0;
+    for (int i = 0; i < count; i++) {
+        int v = keys[i] % fn->instr_count;
+        if (frame->reg[v]) continue;
+        while (heap_count > 0 && frame->end[heap[0]] < frame->start[v]) {
+            free_slots[free_count++] = frame->slot[heap[0]];
+            heap[0] = heap[--heap_count];
+            for (int j = 0; 2 * j + 1 < heap_count; ) {
+                int c = 2 * j + 1;
+                if (c + 1 < heap_count && frame->end[heap[c + 1]] < frame->end[heap[c]]) c++;
+                if (frame->end[heap[j]] <= frame->end[heap[c]]) break;
+                int t = heap[j]; heap[j] = heap[c]; heap[c] = t;
+                j = c;
+            }
+        }
+        frame->slot[v] = free_count > 0 ? free_slots[--free_count] : 8 * ++slots;
+        int j = heap_count++;
+        heap[j] = v;
+        while (j > 0 && frame->end[heap[(j - 1) / 2]] > frame->end[heap[j]]) {
+            int t = heap[j]; heap[j] = heap[(j - 1) / 2]; heap[(j - 1) / 2] = t;
+            j = (j - 1) / 2;
+        }
+    }
+
+    // Una tabla que no se modifica no necesita copia en el marco
+    for (int a = 0; a < fn->array_count; a++) frame->readonly[a] = fn->array_tables[a] != NULL;
+    for (int i = 0; i < fn->order_count; i++) {
+        IRBlock *b = &fn->blocks[fn->order[i]];
+        for (int k = 0; k < b->code_count; k++) {
+            IRInstr *instr = &fn->instrs[b->code[k]];
+            if (instr->op == IR_STORE && !instr->dead) frame->readonly[instr->constant] = 0;
+        }
+    }
+
+    frame->frame_size = 8 * slots;
+    for (int a = 0; a < fn->array_count; a++) {
+        if (frame->readonly[a]) continue;
+        frame->frame_size += 8 * fn->array_sizes[a];
+        frame->array_offset[a] = frame->frame_size;
+    }
+
+    // A la entrada rsp = 8 (mod 16); cada registro guardado suma 8
+    frame->has_frame = frame->frame_size > 0;
+    if (frame->has_frame) {
+        frame->frame_size = (frame->frame_size + 15) & ~15;
+        if (frame->saved_count % 2) frame->frame_size += 8;
+    } else if (calls && frame->saved_count % 2 == 0) {
+        frame->pad = 8;
+    }
+    free(keys);
+    free(heap);
+    free(free_slots);
+}
+
+IRFrame* ir_frame_create(IRFunction *fn) {
+    IRFrame *frame = (IRFrame*)calloc(1, sizeof(IRFrame));
+    int n = fn->instr_count;
+    frame->fn = fn;
+    frame->slot = (int*)calloc(n, sizeof(int));
+    frame->reg = (char*)calloc(n, 1);
+    frame->crosses = (char*)calloc(n, 1);
+    frame->uses = (int*)calloc(n, sizeof(int));
+    frame->start = (int*)calloc(n, sizeof(int));
+    frame->end = (int*)calloc(n, sizeof(int));
+    frame->position = (int*)calloc(n, sizeof(int));
+    frame->fused = (char*)calloc(n, 1);
+    frame->block_start = (int*)calloc(fn->block_count, sizeof(int));
+    frame->block_end = (int*)calloc(fn->block_count, sizeof(int));
+    frame->visited = (int*)calloc(fn->block_count, sizeof(int));
+    frame->array_offset = (int*)calloc(fn->array_count + 1, sizeof(int));
+    frame->array_label = (int*)calloc(fn->array_count + 1, sizeof(int));
+    frame->readonly = (char*)calloc(fn->array_count + 1, 1);
+    ir_frame_ranges(frame);
+    ir_frame_slots(frame);
+    return frame;
+}
+
+void ir_frame_free(IRFrame *frame) {
+    free(frame->slot);
+    free(frame->reg);
+    free(frame->crosses);
+    free(frame->uses);
+    free(frame->start);
+    free(frame->end);
+    free(frame->position);
+    free(frame->fused);
+    free(frame->block_start);
+    free(frame->block_end);
+    free(frame->visited);
+    free(frame->array_offset);
+    free(frame->array_label);
+    free(frame->readonly);
+    free(frame);
+}
+
+int ir_fits_imm32(long long value) {
+    return value >= INT_MIN && value <= INT_MAX;
+}
+
+int ir_is_immediate(IRFrame *frame, int v) {
+    IRInstr *instr = &frame->fn->instrs[v];
+    return instr->op == IR_CONST && ir_fits_imm32(instr->constant);
+}
+
+int ir_has_home(IRFrame *frame, int v) {
+    return frame->reg[v] || frame->slot[v];
+}
+
+// Registro o hueco donde vive v
+const char* ir_home(IRFrame *frame, int v, char *buffer) {
+    if (frame->reg[v]) return ir_registers[frame->reg[v] - 1];
+    sprintf(buffer, "qword [rbp-%d]", frame->slot[v]);
+    return buffer;
+}
+
+// Operando fuente en texto (inmediato, registro o hueco); 0 si hay que
+// cargarlo antes
+int ir_source(IRFrame *frame, int v, char *buffer) {
+    IRInstr *instr = &frame->fn->instrs[v];
+    if (instr->op == IR_CONST) {
+        if (!ir_fits_imm32(instr->constant)) return 0;
+        sprintf(buffer, "%lld", instr->constant);
+        return 1;
+    }
+    if (instr->op == IR_STR) return 0;
+    const char *home = ir_home(frame, v, buffer);
+    if (home != buffer) strcpy(buffer, home);
+    return 1;
+}
+
+void ir_load(CodeGen *gen, IRFrame *frame, const char *reg, int v) {
+    char buffer[512];
+    char home[64];
+    IRInstr *instr = &frame->fn->instrs[v];
+    if (instr->op == IR_CONST && instr->constant == 0) {
+        sprintf(buffer, "xor %s, %s", reg, reg);
+    } else if (instr->op == IR_CONST) {
+        sprintf(buffer, "mov %s, %lld", reg, instr->constant);
+    } else if (instr->op == IR_STR) {
+        sprintf(buffer, "lea %s, [rel str.%d]", reg, string_pool_intern(gen->strings, instr->text));
+    } else {
+        const char *source = ir_home(frame, v, home);
+        if (strcmp(source, reg) == 0) return;
+        sprintf(buffer, "mov %s, %s", reg, source);
+    }
+    codegen_emit(gen, buffer);
+}
+
+void ir_store_result(CodeGen *gen, IRFrame *frame, int v, const char *reg) {
+    char buffer[128];
+    char home[64];
+    if (!ir_has_home(frame, v)) return;
+    const char *dest = ir_home(frame, v, home);
+    if (strcmp(dest, reg) == 0) return;
+    sprintf(buffer, "mov %s, %s", dest, reg);
+    codegen_emit(gen, buffer);
+}
+
+// Registro donde calcular v: el suyo, o rax si vive en memoria
+const char* ir_target(IRFrame *frame, int v) {
+    return frame->reg[v] ? ir_registers[frame->reg[v] - 1] : "rax";
+}
+
+// Segundo operando de una operacion: inmediato, registro, hueco o rcx
+const char* ir_operand(CodeGen *gen, IRFrame *frame, int v, char *buffer) {
+    if (ir_source(frame, v, buffer)) return buffer;
+    ir_load(gen, frame, "rcx", v);
+    return "rcx";
+}
+
+void ir_push(CodeGen *gen, IRFrame *frame, int v) {
+    char buffer[128];
+    char source[64];
+    if (!ir_source(frame, v, source)) {
+        ir_load(gen, frame, "rax", v);
+        strcpy(source, "rax");
+    }
+    sprintf(buffer, "push %s", source);
+    codegen_emit(gen, buffer);
+}
+
+// cmp entre dos valores; en memoria solo puede ir el primero si el segundo
+// es registro o inmediato
+void ir_compare(CodeGen *gen, IRFrame *frame, int a, int b) {
+    char buffer[512];
+    char left[64];
+    char right[64];
+    IRInstr *x = &frame->fn->instrs[a];
+    int direct = frame->reg[a] || (x->op != IR_CONST && x->op != IR_STR &&
+                                   (frame->reg[b] || ir_is_immediate(frame, b)));
+    if (direct) {
+        ir_source(frame, a, left);
+    } else {
+        ir_load(gen, frame, "rax", a);
+        strcpy(left, "rax");
+    }
+    sprintf(buffer, "cmp %s, %s", left, ir_operand(gen, frame, b, right));
+    codegen_emit(gen, buffer);
+}
+
+// Direccion del elemento array[index] (deja el indice en rcx si no es
+// constante ni esta en un registro)
+void ir_element(CodeGen *gen, IRFrame *frame, IRInstr *instr, char *address) {
+    int offset = frame->array_offset[instr->constant];
+    IRInstr *index = &frame->fn->instrs[instr->args[0]];
+    if (frame->readonly[instr->constant]) {
+        // Tabla en .rodata: rip-relativo no admite indice, la base va en rdx
+        int label = frame->array_label[instr->constant];
+        if (index->op == IR_CONST && ir_fits_imm32(index->constant * 8)) {
+            sprintf(address, "qword [rel .L%d + %lld]", label, index->constant * 8);
+            return;
+        }
+        char buffer[64];
+        sprintf(buffer, "lea rdx, [rel .L%d]", label);
+        codegen_emit(gen, buffer);
+        if (frame->reg[instr->args[0]]) {
+            sprintf(address, "qword [rdx + %s*8]", ir_registers[frame->reg[instr->args[0]] - 1]);
+            return;
+        }
+        ir_load(gen, frame, "rcx", instr->args[0]);
+        sprintf(address, "qword [rdx + rcx*8]");
+        return;
+    }
+    if (index->op == IR_CONST && ir_fits_imm32(index->constant * 8 - offset)) {
+        long long displacement = index->constant * 8 - offset;
+        sprintf(address, "qword [rbp%+lld]", displacement);
+        return;
+    }
+    if (frame->reg[instr->args[0]]) {
+        sprintf(address, "qword [rbp + %s*8 - %d]", ir_registers[frame->reg[instr->args[0]] - 1], offset);
+        return;
+    }
+    ir_load(gen, frame, "rcx", instr->args[0]);
+    sprintf(address, "qword [rbp + rcx*8 - %d]", offset);
+}
+
+const char* ir_condition(IROp op, int negate) {
+    const char *set[] = {"e", "ne", "l", "g", "le", "ge"};
+    const char *inverse[] = {"ne", "e", "ge", "le", "g", "l"};
+    return negate ? inverse[op - IR_EQ] : set[op - IR_EQ];
+}
+
+void ir_emit_print(CodeGen *gen, IRFrame *frame, IRInstr *instr, int v) {
+    char buffer[512];
+    int count = instr->arg_count;
+    int ints = 0;
+
+    if (count == 0) {
+        codegen_emit(gen, "xor eax, eax");
+        ir_store_result(gen, frame, v, "rax");
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        if (!instr->strings[i]) ints++;
+    }
+
+    int scratch = count * 16;
+    int area = (scratch + ints * 24 + 15) & ~15;
+    sprintf(buffer, "sub rsp, %d", area);
+    codegen_emit(gen, buffer);
+
+    int slot = 0;
+    for (int i = 0; i < count; i++) {
+        if (instr->strings[i]) {
+            sprintf(buffer, "lea rax, [rel str.%d]", string_pool_intern(gen->strings, instr->strings[i]));
+            codegen_emit(gen, buffer);
+            sprintf(buffer, "mov qword [rsp + %d], %d", i * 16 + 8, (int)strlen(instr->strings[i]));
+            codegen_emit(gen, buffer);
+        } else {
+            ir_load(gen, frame, "rdi", instr->args[i]);
+            sprintf(buffer, "lea rsi, [rsp + %d]", scratch + ++slot * 24);
+            codegen_emit(gen, buffer);
+            codegen_emit(gen, "call format_int");
+            sprintf(buffer, "mov [rsp + %d], rdx", i * 16 + 8);
+            codegen_emit(gen, buffer);
+        }
+        sprintf(buffer, "mov [rsp + %d], rax", i * 16);
+        codegen_emit(gen, buffer);
+    }
+
+    codegen_emit(gen, "mov rdi, rsp");
+    sprintf(buffer, "mov rsi, %d", count);
+    codegen_emit(gen, buffer);
+    codegen_emit(gen, "call write_iov");
+    sprintf(buffer, "add rsp, %d", area);
+    codegen_emit(gen, buffer);
+    ir_store_result(gen, frame, v, "rax");
+}
+
+typedef struct {
+    char dest[64];
+    char source[64];    // vacio: hay que cargar value
+    int value;
+} IRMove;
+
+int ir_is_memory(const char *operand) {
+    return strchr(operand, '[') != NULL;
+}
+
+void ir_emit_move(CodeGen *gen, IRFrame *frame, IRMove *move) {
+    char buffer[512];
+    if (!move->source[0] && !ir_is_memory(move->dest)) {
+        ir_load(gen, frame, move->dest, move->value);
+        return;
+    }
+    if (!move->source[0] || (ir_is_memory(move->source) && ir_is_memory(move->dest))) {
+        if (move->source[0]) {
+            sprintf(buffer, "mov rax, %s", move->source);
+            codegen_emit(gen, buffer);
+        } else {
+            ir_load(gen, frame, "rax", move->value);
+        }
+        sprintf(buffer, "mov %s, rax", move->dest);
+    } else {
+        sprintf(buffer, "mov %s, %s", move->dest, move->source);
+    }
+    codegen_emit(gen, buffer);
+}
+
+// Copia paralela: se emiten primero las copias cuyo destino ya no hace
+// falta como origen; si solo quedan ciclos se apilan sus origenes y se
+// desapilan en los destinos
+void ir_parallel_move(CodeGen *gen, IRFrame *frame, IRMove *moves, int count) {
+    char buffer[128];
+    char *done = (char*)calloc(count + 1, 1);
+    int remaining = count;
+    for (int i = 0; i < count; i++) {
+        if (strcmp(moves[i].dest, moves[i].source) == 0) {
+            done[i] = 1;
+            remaining--;
+        }
+    }
+
+    int progress = 1;
+    while (remaining > 0 && progress) {
+        progress = 0;
+        for (int i = 0; i < count; i++) {
+            if (done[i]) continue;
+            int blocked = 0;
+            for (int j = 0; j < count && !blocked; j++) {
+                blocked = j != i && !done[j] && strcmp(moves[j].source, moves[i].dest) == 0;
+            }
+            if (blocked) continue;
+            ir_emit_move(gen, frame, &moves[i]);
+            done[i] = 1;
+            remaining--;
+            progress = 1;
+        }
+    }
+
+    for (int i = 0; i < count && remaining > 0; i++) {
+        if (done[i]) continue;
+        sprintf(buffer, "push %s", moves[i].source);
+        codegen_emit(gen, buffer);
+    }
+    for (int i = count - 1; i >= 0 && remaining > 0; i--) {
+        if (done[i]) continue;
+        sprintf(buffer, "pop %s", moves[i].dest);
+        codegen_emit(gen, buffer);
+    }
+    free(done);
+}
+
+// Copias de los phis de target al salir de block
+void ir_emit_phi_moves(CodeGen *gen, IRFrame *frame, int block, int target) {
+    IRFunction *fn = frame->fn;
+    IRBlock *t = &fn->blocks[target];
+    int edge = -1;
+    for (int p = 0; p < t->pred_count; p++) {
+        if (t->preds[p] == block) edge = p;
+    }
+    if (edge < 0 || t->phi_count == 0) return;
+
+    IRMove *moves = (IRMove*)malloc(t->phi_count * sizeof(IRMove));
+    int count = 0;
+    for (int p = 0; p < t->phi_count; p++) {
+        int phi = t->phis[p];
+        int source = fn->instrs[phi].args[edge];
+        if (!ir_has_home(frame, phi) || source == phi) continue;
+        IRMove *move = &moves[count++];
+        const char *dest = ir_home(frame, phi, move->dest);
+        if (dest != move->dest) strcpy(move->dest, dest);
+        if (!ir_source(frame, source, move->source)) move->source[0] = '\0';
+        move->value = source;
+    }
+    ir_parallel_move(gen, frame, moves, count);
+    free(moves);
+}
+
+void ir_emit_epilogue(CodeGen *gen, IRFrame *frame) {
+    char buffer[64];
+    if (frame->has_frame) {
+        codegen_emit(gen, "mov rsp, rbp");
+        codegen_emit(gen, "pop rbp");
+    } else if (frame->pad) {
+        sprintf(buffer, "add rsp, %d", frame->pad);
+        codegen_emit(gen, buffer);
+    }
+    for (int r = IR_REGISTERS - 1; r >= 0; r--) {
+        if (!(frame->saved & (1 << r))) continue;
+        sprintf(buffer, "pop %s", ir_registers[r]);
+        codegen_emit(gen, buffer);
+    }
+    codegen_emit(gen, "ret");
+}
+
+void ir_emit_call(CodeGen *gen, IRFrame *frame, IRInstr *instr, int v) {
+    char buffer[512];
+    const char *arg_regs[] = {"rdi", "rsi", "rdx", "rcx", "r8", "r9"};
+    int count = instr->arg_count;
+    int stack_args = count > 6 ? count - 6 : 0;
+    int pad = stack_args % 2 ? 8 : 0;
+
+    // Del septimo argumento en adelante van en la pila, el septimo en la cima
+    if (pad) codegen_emit(gen, "sub rsp, 8");
+    for (int a = count - 1; a >= 6; a--) {
+        ir_push(gen, frame, instr->args[a]);
+    }
+    // r8 y r9 son a la vez registros de valores: el sexto pasa por rax para
+    // no pisar un origen todavia no leido
+    if (count > 5) ir_load(gen, frame, "rax", instr->args[5]);
+    for (int a = 0; a < count && a < 5; a++) {
+        ir_load(gen, frame, arg_regs[a], instr->args[a]);
+    }
+    if (count > 5) codegen_emit(gen, "mov r9, rax");
+
+    sprintf(buffer, "call %s", instr->text);
+    codegen_emit(gen, buffer);
+    if (stack_args) {
+        sprintf(buffer, "add rsp, %d", 8 * stack_args + pad);
+        codegen_emit(gen, buffer);
+    }
+    ir_store_result(gen, frame, v, "rax");
+}
+
+void ir_emit_instr(CodeGen *gen, IRFrame *frame, int v, int next_block) {
+    char buffer[512];
+    char operand[128];
+    char address[128];
+    IRFunction *fn = frame->fn;
+    IRInstr *instr = &fn->instrs[v];
+
+    if (codegen_options.debug) codegen_source_line(gen, fn->file, instr->line);
+
+    switch (instr->op) {
+        case IR_ADD:
+        case IR_SUB:
+        case IR_MUL:
+        case IR_AND:
+        case IR_OR: {
+            const char *names[] = {"add", "sub", "imul"};
+            const char *name = instr->op == IR_AND ? "and" : instr->op == IR_OR ? "or" : names[instr->op - IR_ADD];
+            if (!ir_has_home(frame, v)) return;
+            // Los operandos siguen vivos en v, asi que nunca comparten su registro
+            const char *target = ir_target(frame, v);
+            ir_load(gen, frame, target, instr->args[0]);
+            sprintf(buffer, "%s %s, %s", name, target, ir_operand(gen, frame, instr->args[1], operand));
+            codegen_emit(gen, buffer);
+            ir_store_result(gen, frame, v, target);
+            return;
+        }
+
+        case IR_DIV:
+        case IR_MOD: {
+            const char *divisor = "rcx";
+            ir_load(gen, frame, "rax", instr->args[0]);
+            if (fn->instrs[instr->args[1]].op == IR_CONST || fn->instrs[instr->args[1]].op == IR_STR) {
+                ir_load(gen, frame, "rcx", instr->args[1]);
+            } else {
+                divisor = ir_home(frame, instr->args[1], operand);
+            }
+            codegen_emit(gen, "xor rdx, rdx");
+            sprintf(buffer, "idiv %s", divisor);
+            codegen_emit(gen, buffer);
+            ir_store_result(gen, frame, v, instr->op == IR_DIV ? "rax" : "rdx");
+            return;
+        }
+
+        case IR_EQ:
+        case IR_NE:
+        case IR_LT:
+        case IR_GT:
+        case IR_LE:
+        case IR_GE:
+            if (frame->fused[v]) return;
+            ir_compare(gen, frame, instr->args[0], instr->args[1]);
+            sprintf(buffer, "set%s al", ir_condition(instr->op, 0));
+            codegen_emit(gen, buffer);
+            codegen_emit(gen, "movzx eax, al");
+            ir_store_result(gen, frame, v, "rax");
+            return;
+
+        case IR_NOT:
+            ir_load(gen, frame, "rax", instr->args[0]);
+            codegen_emit(gen, "test rax, rax");
+            codegen_emit(gen, "setz al");
+            codegen_emit(gen, "movzx eax, al");
+            ir_store_result(gen, frame, v, "rax");
+            return;
+
+        case IR_NEG: {
+            const char *target = ir_target(frame, v);
+            ir_load(gen, frame, target, instr->args[0]);
+            sprintf(buffer, "neg %s", target);
+            codegen_emit(gen, buffer);
+            ir_store_result(gen, frame, v, target);
+            return;
+        }
+
+        case IR_LOAD: {
+            const char *target = ir_target(frame, v);
+            ir_element(gen, frame, instr, address);
+            sprintf(buffer, "mov %s, %s", target, address);
+            codegen_emit(gen, buffer);
+            ir_store_result(gen, frame, v, target);
+            return;
+        }
+
+        case IR_STORE: {
+            ir_element(gen, frame, instr, address);
+            if (ir_is_immediate(frame, instr->args[1]) || frame->reg[instr->args[1]]) {
+                ir_source(frame, instr->args[1], operand);
+                sprintf(buffer, "mov %s, %s", address, operand);
+            } else {
+                ir_load(gen, frame, "rax", instr->args[1]);
+                sprintf(buffer, "mov %s, rax", address);
+            }
+            codegen_emit(gen, buffer);
+            return;
+        }
+
+        case IR_INIT: {
+            if (frame->readonly[instr->constant]) return;
+            sprintf(buffer, "lea rsi, [rel .L%d]", frame->array_label[instr->constant]);
+            codegen_emit(gen, buffer);
+            sprintf(buffer, "lea rdi, [rbp-%d]", frame->array_offset[instr->constant]);
+            codegen_emit(gen, buffer);
+            sprintf(buffer, "mov ecx, %d", frame->fn->array_sizes[instr->constant]);
+            codegen_emit(gen, buffer);
+            codegen_emit(gen, "rep movsq");
+            return;
+        }
+
+        case IR_CALL:
+            ir_emit_call(gen, frame, instr, v);
+            return;
+
+        case IR_PRINT:
+            ir_emit_print(gen, frame, instr, v);
+            return;
+
+        case IR_EXIT:
+            ir_load(gen, frame, "rdi", instr->args[0]);
+            codegen_emit(gen, "mov rax, 231");
+            codegen_emit(gen, "syscall");
+            return;
+
+        case IR_READ_INT:
+        case IR_EOF:
+            codegen_emit(gen, instr->op == IR_EOF ? "call stdin_at_eof" : "call read_int");
+            ir_store_result(gen, frame, v, "rax");
+            return;
+
+        case IR_JUMP:
+            ir_emit_phi_moves(gen, frame, instr->block, instr->target[0]);
+            if (instr->target[0] != next_block) {
+                sprintf(buffer, "jmp .B%d", instr->target[0]);
+                codegen_emit(gen, buffer);
+            }
+            return;
+
+        case IR_BRANCH: {
+            IRInstr *cond = &fn->instrs[instr->args[0]];
+            const char *jump_true, *jump_false;
+            if (frame->fused[instr->args[0]]) {
+                ir_compare(gen, frame, cond->args[0], cond->args[1]);
+                jump_true = ir_condition(cond->op, 0);
+                jump_false = ir_condition(cond->op, 1);
+            } else {
+                if (cond->op == IR_CONST || cond->op == IR_STR) {
+                    ir_load(gen, frame, "rax", instr->args[0]);
+                    codegen_emit(gen, "test rax, rax");
+                } else if (frame->reg[instr->args[0]]) {
+                    const char *reg = ir_registers[frame->reg[instr->args[0]] - 1];
+                    sprintf(buffer, "test %s, %s", reg, reg);
+                    codegen_emit(gen, buffer);
+                } else {
+                    sprintf(buffer, "cmp qword [rbp-%d], 0", frame->slot[instr->args[0]]);
+                    codegen_emit(gen, buffer);
+                }
+                jump_true = "ne";
+                jump_false = "e";
+            }
+            if (instr->target[1] == next_block) {
+                sprintf(buffer, "j%s .B%d", jump_true, instr->target[0]);
+                codegen_emit(gen, buffer);
+            } else if (instr->target[0] == next_block) {
+                sprintf(buffer, "j%s .B%d", jump_false, instr->target[1]);
+                codegen_emit(gen, buffer);
+            } else {
+                sprintf(buffer, "j%s .B%d", jump_true, instr->target[0]);
+                codegen_emit(gen, buffer);
+                sprintf(buffer, "jmp .B%d", instr->target[1]);
+                codegen_emit(gen, buffer);
+            }
+            return;
+        }
+
+        case IR_SWITCH:
+            ir_load(gen, frame, "rax", instr->args[0]);
+            codegen_switch_dispatch(gen, instr->cases, instr->case_count, ".B", instr->targets[0]);
+            return;
+
+        case IR_RETURN:
+            ir_load(gen, frame, "rax", instr->args[0]);
+            ir_emit_epilogue(gen, frame);
+            return;
+
+        default:
+            // const, str y copy no generan codigo; param se copia en el prologo
+            return;
+    }
+}
+
+// Genera una funcion a traves del IR; devuelve 0 si el IR no la soporta y
+// hay que usar el generador directo
+// Bloques frios: las ramas marcadas y lo que solo se alcanza desde ellas
+// (todos los predecesores hacia delante frios; las aristas de vuelta de un
+// bucle no cuentan)
+char* ir_cold_blocks(IRFunction *fn) {
+    char *cold = (char*)calloc(fn->block_count, 1);
+    for (int i = 1; i < fn->order_count; i++) {
+        IRBlock *b = &fn->blocks[fn->order[i]];
+        int forward = 0, all = 1;
+        for (int p = 0; p < b->pred_count; p++) {
+            if (fn->blocks[b->preds[p]].rpo >= b->rpo) continue;
+            forward++;
+            if (!cold[b->preds[p]]) all = 0;
+        }
+        cold[fn->order[i]] = b->cold || (forward > 0 && all);
+    }
+    return cold;
+}
+
+// --remarks: donde ha quedado cada variable (las copias de un bucle
+// desenrollado cuentan como la misma), stores eliminados, cargas
+// reutilizadas y tablas que se leen de .rodata
+const char *ir_array_name(IRFunction *fn, long long array) {
+    for (int i = 0; i < fn->var_count; i++) {
+        if (fn->vars[i].array == array) return fn->vars[i].name;
+    }
+    return "?";
+}
+
+void ir_remarks(IRFunction *fn, IRFrame *frame) {
+    enum { HOME_NONE, HOME_CONST, HOME_REG, HOME_STACK };
+    int *home = (int*)calloc(fn->var_count + 1, sizeof(int));
+    int *regs = (int*)calloc(fn->var_count + 1, sizeof(int));
+    char *calls = (char*)calloc(fn->var_count + 1, 1);
+    for (int v = 0; v < fn->instr_count; v++) {
+        IRInstr *instr = &fn->instrs[v];
+        if (!fn->blocks[instr->block].reachable) continue;
+        if (instr->op == IR_STORE && instr->dead) {
+            remark(REMARK_PASSED, "memory", fn->file, instr->line, fn->name,
+                   "dead store to %s removed", ir_array_name(fn, instr->constant));
+        }
+        if (instr->reused) {
+            remark(REMARK_PASSED, "memory", fn->file, instr->line, fn->name,
+                   "load from %s replaced by a known value", ir_array_name(fn, instr->constant));
+        }
+        if (!instr->var || instr->dead) continue;
+        int var = instr->var - 1;
+        int state = instr->op == IR_CONST ? HOME_CONST : frame->slot[v] ? HOME_STACK :
+                    frame->reg[v] ? HOME_REG : HOME_NONE;
+        if (state == HOME_REG) regs[var] |= 1 << (frame->reg[v] - 1);
+        if (state == HOME_STACK && frame->crosses[v]) calls[var] = 1;
+        if (state > home[var]) home[var] = state;
+    }
+    for (int i = 0; i < fn->var_count; i++) {
+        IRVar *var = &fn->vars[i];
+        if (var->array >= 0) {
+            if (frame->readonly[var->array]) {
+                remark(REMARK_PASSED, "memory", fn->file, var->line, fn->name,
+                       "table %s is never written: read from .rodata", var->name);
+            }
+            continue;
+        }
+        // Juntar con las demas declaraciones iguales
+        int first = i;
+        for (int k = 0; k < i; k++) {
+            if (fn->vars[k].array < 0 && fn->vars[k].line == var->line && strcmp(fn->vars[k].name, var->name) == 0) {
+                first = k;
+                break;
+            }
+        }
+        if (first != i) {
+            if (home[i] > home[first]) home[first] = home[i];
+            regs[first] |= regs[i];
+            calls[first] |= calls[i];
+            home[i] = -1;
+        }
+    }
+    for (int i = 0; i < fn->var_count; i++) {
+        IRVar *var = &fn->vars[i];
+        if (var->array >= 0 || home[i] < 0) continue;
+        if (home[i] == HOME_STACK) {
+            remark(REMARK_MISSED, "regalloc", fn->file, var->line, fn->name,
+                   "%s spilled to the stack: %s", var->name,
+                   calls[i] ? "live across a call" : "not enough registers");
+        } else if (home[i] == HOME_REG) {
+            char names[64] = "";
+            for (int r = 0; r < IR_REGISTERS; r++) {
+                if (!(regs[i] & (1 << r))) continue;
+                if (names[0]) strcat(names, ", ");
+                strcat(names, ir_registers[r]);
+            }
+            remark(REMARK_ANALYSIS, "regalloc", fn->file, var->line, fn->name,
+                   "%s kept in registers (%s)", var->name, names);
+        } else if (home[i] == HOME_CONST) {
+            remark(REMARK_ANALYSIS, "regalloc", fn->file, var->line, fn->name,
+                   "%s folded to constants: needs no storage", var->name);
+        } else {
+            remark(REMARK_ANALYSIS, "regalloc", fn->file, var->line, fn->name,
+                   "%s optimized away", var->name);
+        }
+    }
+    free(home);
+    free(regs);
+    free(calls);
+}
+
+int codegen_ir_function(CodeGen *gen, ASTNode *node) {
+    char buffer[512];
+    char reason[160];
+    IRFunction *fn = ir_build(node, reason, sizeof(reason));
+    if (!fn) {
+        remark(REMARK_MISSED, "ir", node->file, node->line, node->value,
+               "not optimized: %s; all locals live on the stack", reason);
+        return 0;
+    }
+    IRFrame *frame = ir_frame_create(fn);
+    if (remarks_mode) ir_remarks(fn, frame);
+    for (int a = 0; a < fn->array_count; a++) {
+        if (fn->array_tables[a]) frame->array_label[a] = codegen_new_label(gen);
+    }
+
+    gen->line = 0;
+    codegen_line(gen, node);
+    codegen_function_symbol(gen, node->value);
+    for (int r = 0; r < IR_REGISTERS; r++) {
+        if (!(frame->saved & (1 << r))) continue;
+        sprintf(buffer, "push %s", ir_registers[r]);
+        codegen_emit(gen, buffer);
+    }
+    if (frame->has_frame) {
+        codegen_emit(gen, "push rbp");
+        codegen_emit(gen, "mov rbp, rsp");
+        sprintf(buffer, "sub rsp, %d", frame->frame_size);
+        codegen_emit(gen, buffer);
+    } else if (frame->pad) {
+        sprintf(buffer, "sub rsp, %d", frame->pad);
+        codegen_emit(gen, buffer);
+    }
+
+    // Parametros: de los registros de System V (o de la pila del llamador,
+    // encima de la direccion de retorno y lo guardado) a su sitio
+    const char *param_regs[] = {"rdi", "rsi", "rdx", "rcx", "r8", "r9"};
+    IRBlock *entry = &fn->blocks[fn->order[0]];
+    IRMove *moves = (IRMove*)malloc((entry->code_count + 1) * sizeof(IRMove));
+    int count = 0;
+    for (int k = 0; k < entry->code_count; k++) {
+        int v = entry->code[k];
+        IRInstr *instr = &fn->instrs[v];
+        if (instr->op != IR_PARAM || !ir_has_home(frame, v)) continue;
+        IRMove *move = &moves[count++];
+        const char *dest = ir_home(frame, v, move->dest);
+        if (dest != move->dest) strcpy(move->dest, dest);
+        int i = (int)instr->constant;
+        if (i < 6) {
+            strcpy(move->source, param_regs[i]);
+        } else if (frame->has_frame) {
+            sprintf(move->source, "qword [rbp + %d]", 16 + 8 * frame->saved_count + 8 * (i - 6));
+        } else {
+            sprintf(move->source, "qword [rsp + %d]", 8 + 8 * frame->saved_count + frame->pad + 8 * (i - 6));
+        }
+        move->value = v;
+    }
+    ir_parallel_move(gen, frame, moves, count);
+    free(moves);
+
+    // Primero los bloques calientes en orden y despues, en .text.cold, los
+    // frios: cada grupo cae de un bloque al siguiente
+    char *cold = ir_cold_blocks(fn);
+    int *layout = (int*)malloc(fn->order_count * sizeof(int));
+    int hot = 0;
+    for (int i = 0; i < fn->order_count; i++) {
+        if (!cold[fn->order[i]]) layout[hot++] = fn->order[i];
+    }
+    int placed = hot;
+    for (int i = 0; i < fn->order_count; i++) {
+        if (cold[fn->order[i]]) layout[placed++] = fn->order[i];
+    }
+    for (int i = 0; i < fn->order_count; i++) {
+        int b = layout[i];
+        int next = i + 1 < fn->order_count && i + 1 != hot ? layout[i + 1] : -1;
+        if (i == hot) {
+            fprintf(gen->output, "section .text.cold\n");
+            gen->section = ".text.cold";
+            gen->line = 0;
+        }
+        sprintf(buffer, ".B%d", b);
+        codegen_emit_label(gen, buffer);
+        IRBlock *block = &fn->blocks[b];
+        for (int k = 0; k < block->code_count; k++) {
+            ir_emit_instr(gen, frame, block->code[k], next);
+        }
+    }
+    if (hot < fn->order_count) {
+        fprintf(gen->output, "section .text\n");
+        gen->section = ".text";
+        gen->line = 0;
+    }
+    free(cold);
+    free(layout);
+    for (int a = 0; a < fn->array_count; a++) {
+        if (fn->array_tables[a]) codegen_emit_table(gen, frame->array_label[a], fn->array_tables[a]);
+    }
+    fprintf(gen->output, ".end:\n\n");
+
+    ir_frame_free(frame);
+    ir_free(fn);
+    return 1;
+}
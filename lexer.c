@@ -41,315 +41,272 @@ typedef enum {
     TOKEN_GREATER_EQUAL,
     TOKEN_AND,
     TOKEN_OR,
-    TOKEN_NOT
+    TOKEN_NOT,
+    TOKEN_PARALLEL,
+    TOKEN_SWITCH,
+    TOKEN_CASE,
+    TOKEN_DEFAULT,
+    TOKEN_CONST,
+    TOKEN_LIKELY,
+    TOKEN_UNLIKELY,
+    TOKEN_UNROLL
 } TokenType;
 
+// Token compacto: el texto no se copia, es source[offset, offset + length).
+// En los literales de cadena el rango excluye las comillas y conserva los
+// escapes; lexer_token_text los resuelve.
 typedef struct {
     TokenType type;
-    char value[256];
+    int offset;
+    int length;
     int line;
 } Token;
 
 // ==================== LEXER ====================
+// El fuente entero (mapeado con mmap) se convierte de una pasada en un
+// array contiguo de tokens que el parser recorre por indice. Cada byte se
+// clasifica con una tabla en lugar de cadenas de isalpha/isdigit/strcmp.
 
 typedef struct {
-    char *source;
-    int pos;
-    int line;
-    char current;
+    const char *source;
+    size_t size;
+    Token *tokens;
+    int token_count;
+    int capacity;
 } Lexer;
 
-void lexer_init(Lexer *lex, char *source) {
+enum {
+    CHAR_OTHER,
+    CHAR_SPACE,
+    CHAR_NEWLINE,
+    CHAR_DIGIT,
+    CHAR_ALPHA,
+    CHAR_QUOTE,
+    CHAR_SLASH,
+    CHAR_SINGLE,
+    CHAR_DOUBLE,
+    CHAR_HASH
+};
+
+const unsigned char char_class[256] = {
+    [' '] = CHAR_SPACE, ['\t'] = CHAR_SPACE, ['\r'] = CHAR_SPACE,
+    ['\n'] = CHAR_NEWLINE,
+    ['0' ... '9'] = CHAR_DIGIT,
+    ['a' ... 'z'] = CHAR_ALPHA, ['A' ... 'Z'] = CHAR_ALPHA, ['_'] = CHAR_ALPHA,
+    ['"'] = CHAR_QUOTE,
+    ['/'] = CHAR_SLASH,
+    ['#'] = CHAR_HASH,
+    ['*'] = CHAR_SINGLE, ['%'] = CHAR_SINGLE, ['('] = CHAR_SINGLE, [')'] = CHAR_SINGLE,
+    ['{'] = CHAR_SINGLE, ['}'] = CHAR_SINGLE, ['['] = CHAR_SINGLE, [']'] = CHAR_SINGLE,
+    [','] = CHAR_SINGLE,
+    ['='] = CHAR_DOUBLE, ['!'] = CHAR_DOUBLE, ['<'] = CHAR_DOUBLE, ['>'] = CHAR_DOUBLE,
+    ['+'] = CHAR_DOUBLE, ['-'] = CHAR_DOUBLE, ['&'] = CHAR_DOUBLE, ['|'] = CHAR_DOUBLE
+};
+
+const TokenType single_tokens[256] = {
+    ['*'] = TOKEN_MULTIPLY, ['%'] = TOKEN_MODULO, ['('] = TOKEN_LPAREN,
+    [')'] = TOKEN_RPAREN, ['{'] = TOKEN_LBRACE, ['}'] = TOKEN_RBRACE,
+    ['['] = TOKEN_LBRACKET, [']'] = TOKEN_RBRACKET, [','] = TOKEN_COMMA
+};
+
+typedef struct {
+    const char *word;
+    int length;
+    TokenType type;
+} Keyword;
+
+const Keyword keywords[] = {
+    {"int", 3, TOKEN_INT}, {"float", 5, TOKEN_FLOAT}, {"bool", 4, TOKEN_BOOL},
+    {"string", 6, TOKEN_STRING}, {"import", 6, TOKEN_IMPORT}, {"func", 4, TOKEN_FUNC},
+    {"return", 6, TOKEN_RETURN}, {"if", 2, TOKEN_IF}, {"else", 4, TOKEN_ELSE},
+    {"loop", 4, TOKEN_LOOP}, {"break", 5, TOKEN_BREAK}, {"continue", 8, TOKEN_CONTINUE},
+    {"parallel", 8, TOKEN_PARALLEL}, {"switch", 6, TOKEN_SWITCH}, {"case", 4, TOKEN_CASE},
+    {"default", 7, TOKEN_DEFAULT}, {"const", 5, TOKEN_CONST}, {"likely", 6, TOKEN_LIKELY},
+    {"unlikely", 8, TOKEN_UNLIKELY}, {NULL, 0, TOKEN_IDENTIFIER}
+};
+
+void lexer_init(Lexer *lex, const char *source, size_t size) {
     lex->source = source;
-    lex->pos = 0;
-    lex->line = 1;
-    lex->current = source[0];
+    lex->size = size;
+    lex->token_count = 0;
+    // Aproximadamente un token cada 4 bytes: casi nunca hace falta crecer
+    lex->capacity = size / 4 + 16;
+    lex->tokens = (Token*)malloc(lex->capacity * sizeof(Token));
 }
 
-void lexer_advance(Lexer *lex) {
-    lex->pos++;
-    if (lex->current == '\n') lex->line++;
-    lex->current = lex->source[lex->pos];
+void lexer_free(Lexer *lex) {
+    free(lex->tokens);
+    lex->tokens = NULL;
 }
 
-void lexer_skip_whitespace(Lexer *lex) {
-    while (lex->current == ' ' || lex->current == '\t' || lex->current == '\r') {
-        lexer_advance(lex);
+void lexer_push(Lexer *lex, TokenType type, const char *start, int length, int line) {
+    if (lex->token_count >= lex->capacity) {
+        lex->capacity *= 2;
+        lex->tokens = (Token*)realloc(lex->tokens, lex->capacity * sizeof(Token));
     }
+    Token *token = &lex->tokens[lex->token_count++];
+    token->type = type;
+    token->offset = start - lex->source;
+    token->length = length;
+    token->line = line;
 }
 
-void lexer_skip_comment(Lexer *lex) {
-    if (lex->current == '/' && lex->source[lex->pos + 1] == '/') {
-        lexer_advance(lex);
-        lexer_advance(lex);
-        while (lex->current != '\n' && lex->current != '\0') {
-            lexer_advance(lex);
-        }
-    }
-
-    if (lex->current == '/' && lex->source[lex->pos + 1] == '*') {
-        lexer_advance(lex);
-        lexer_advance(lex);
-
-        while (lex->current != '\0') {
-            if (lex->current == '*' && lex->source[lex->pos + 1] == '/') {
-                lexer_advance(lex);
-                lexer_advance(lex);
-                break;
-            }
-            lexer_advance(lex);
+TokenType lexer_keyword(const char *start, int length) {
+    for (int i = 0; keywords[i].word; i++) {
+        if (keywords[i].length == length && memcmp(keywords[i].word, start, length) == 0) {
+            return keywords[i].type;
         }
     }
+    return TOKEN_IDENTIFIER;
 }
 
-Token lexer_make_number(Lexer *lex) {
-    Token token;
-    token.line = lex->line;
-    int i = 0;
-
-    while (isdigit(lex->current) || lex->current == '.') {
-        token.value[i++] = lex->current;
-        lexer_advance(lex);
+// Operadores de uno o dos caracteres; TOKEN_EOF si no forman un token
+TokenType lexer_double(char first, char second, int *length) {
+    *length = 2;
+    switch (first) {
+        case '=': if (second == '=') return TOKEN_EQUAL; *length = 1; return TOKEN_ASSIGN;
+        case '!': if (second == '=') return TOKEN_NOT_EQUAL; *length = 1; return TOKEN_NOT;
+        case '<': if (second == '=') return TOKEN_LESS_EQUAL; *length = 1; return TOKEN_LESS;
+        case '>': if (second == '=') return TOKEN_GREATER_EQUAL; *length = 1; return TOKEN_GREATER;
+        case '+': if (second == '+') return TOKEN_INCREMENT; *length = 1; return TOKEN_PLUS;
+        case '-': if (second == '-') return TOKEN_DECREMENT; *length = 1; return TOKEN_MINUS;
+        case '&': if (second == '&') return TOKEN_AND; break;
+        case '|': if (second == '|') return TOKEN_OR; break;
     }
-    token.value[i] = '\0';
-
-    token.type = strchr(token.value, '.') ? TOKEN_FLOAT : TOKEN_NUMBER;
-    return token;
+    // '&' o '|' sueltos no son tokens: se ignoran
+    *length = 1;
+    return TOKEN_EOF;
 }
 
-Token lexer_make_identifier(Lexer *lex) {
-    Token token;
-    token.line = lex->line;
-    int i = 0;
+void lexer_tokenize(Lexer *lex) {
+    const char *p = lex->source;
+    const char *end = p + lex->size;
+    int line = 1;
 
-    while (isalnum(lex->current) || lex->current == '_') {
-        token.value[i++] = lex->current;
-        lexer_advance(lex);
-    }
-    token.value[i] = '\0';
-
-    if (strcmp(token.value, "int") == 0) token.type = TOKEN_INT;
-    else if (strcmp(token.value, "float") == 0) token.type = TOKEN_FLOAT;
-    else if (strcmp(token.value, "bool") == 0) token.type = TOKEN_BOOL;
-    else if (strcmp(token.value, "string") == 0) token.type = TOKEN_STRING;
-    else if (strcmp(token.value, "import") == 0) token.type = TOKEN_IMPORT;
-    else if (strcmp(token.value, "func") == 0) token.type = TOKEN_FUNC;
-    else if (strcmp(token.value, "return") == 0) token.type = TOKEN_RETURN;
-    else if (strcmp(token.value, "if") == 0) token.type = TOKEN_IF;
-    else if (strcmp(token.value, "else") == 0) token.type = TOKEN_ELSE;
-    else if (strcmp(token.value, "loop") == 0) token.type = TOKEN_LOOP;
-    else if (strcmp(token.value, "break") == 0) token.type = TOKEN_BREAK;
-    else if (strcmp(token.value, "continue") == 0) token.type = TOKEN_CONTINUE;
-    else token.type = TOKEN_IDENTIFIER;
-
-    return token;
-}
+    while (p < end) {
+        const char *start = p;
+        char next = p + 1 < end ? p[1] : '\0';
 
-Token lexer_make_string(Lexer *lex) {
-    Token token;
-    token.type = TOKEN_STRING_LITERAL;
-    token.line = lex->line;
-    int i = 0;
+        switch (char_class[(unsigned char)*p]) {
+            case CHAR_SPACE:
+                p++;
+                break;
 
-    lexer_advance(lex);
+            case CHAR_NEWLINE:
+                lexer_push(lex, TOKEN_NEWLINE, p, 1, line);
+                line++;
+                p++;
+                break;
 
-    while (lex->current != '"' && lex->current != '\0') {
-        if (lex->current == '\\' && lex->source[lex->pos + 1] == 'n') {
-            token.value[i++] = '\n';
-            lexer_advance(lex);
-            lexer_advance(lex);
-        } else if (lex->current == '\\' && lex->source[lex->pos + 1] == 't') {
-            token.value[i++] = '\t';
-            lexer_advance(lex);
-            lexer_advance(lex);
-        } else if (lex->current == '\\' && lex->source[lex->pos + 1] == '"') {
-            token.value[i++] = '"';
-            lexer_advance(lex);
-            lexer_advance(lex);
-        } else {
-            token.value[i++] = lex->current;
-            lexer_advance(lex);
-        }
-    }
-    token.value[i] = '\0';
+            case CHAR_DIGIT: {
+                int is_float = 0;
+                while (p < end && (char_class[(unsigned char)*p] == CHAR_DIGIT || *p == '.')) {
+                    if (*p == '.') is_float = 1;
+                    p++;
+                }
+                lexer_push(lex, is_float ? TOKEN_FLOAT : TOKEN_NUMBER, start, p - start, line);
+                break;
+            }
 
-    if (lex->current == '"') lexer_advance(lex);
+            case CHAR_ALPHA:
+                while (p < end && (char_class[(unsigned char)*p] == CHAR_ALPHA ||
+                                   char_class[(unsigned char)*p] == CHAR_DIGIT)) {
+                    p++;
+                }
+                lexer_push(lex, lexer_keyword(start, p - start), start, p - start, line);
+                break;
 
-    return token;
-}
+            case CHAR_QUOTE: {
+                int first_line = line;
+                p++;
+                while (p < end && *p != '"') {
+                    if (*p == '\\' && p + 1 < end && (p[1] == 'n' || p[1] == 't' || p[1] == '"')) {
+                        p += 2;
+                        continue;
+                    }
+                    if (*p == '\n') line++;
+                    p++;
+                }
+                lexer_push(lex, TOKEN_STRING_LITERAL, start + 1, p - start - 1, first_line);
+                if (p < end) p++;
+                break;
+            }
 
-Token lexer_next_token(Lexer *lex) {
-    Token token;
+            case CHAR_SLASH:
+                if (next == '/') {
+                    while (p < end && *p != '\n') p++;
+                } else if (next == '*') {
+                    p += 2;
+                    while (p < end && !(*p == '*' && p + 1 < end && p[1] == '/')) {
+                        if (*p == '\n') line++;
+                        p++;
+                    }
+                    p = p < end ? p + 2 : end;
+                } else {
+                    lexer_push(lex, TOKEN_DIVIDE, p, 1, line);
+                    p++;
+                }
+                break;
 
-    while (lex->current != '\0') {
-        lexer_skip_whitespace(lex);
-        lexer_skip_comment(lex);
+            // Directiva #unroll; cualquier otro '#' se ignora como antes
+            case CHAR_HASH:
+                if (end - p >= 7 && memcmp(p, "#unroll", 7) == 0 &&
+                    (end - p == 7 || char_class[(unsigned char)p[7]] != CHAR_ALPHA)) {
+                    lexer_push(lex, TOKEN_UNROLL, p, 7, line);
+                    p += 7;
+                } else {
+                    p++;
+                }
+                break;
 
-        if (lex->current == '\0') break;
+            case CHAR_SINGLE:
+                lexer_push(lex, single_tokens[(unsigned char)*p], p, 1, line);
+                p++;
+                break;
 
-        token.line = lex->line;
+            case CHAR_DOUBLE: {
+                int length;
+                TokenType type = lexer_double(*p, next, &length);
+                if (type != TOKEN_EOF) lexer_push(lex, type, p, length, line);
+                p += length;
+                break;
+            }
 
-        if (isdigit(lex->current)) {
-            return lexer_make_number(lex);
+            default:
+                p++;
+                break;
         }
+    }
 
-        if (isalpha(lex->current) || lex->current == '_') {
-            return lexer_make_identifier(lex);
-        }
+    lexer_push(lex, TOKEN_EOF, end, 0, line);
+}
 
-        if (lex->current == '"') {
-            return lexer_make_string(lex);
-        }
+// Copia el texto de un token en buffer (256 bytes), resolviendo los
+// escapes de los literales de cadena
+char* lexer_token_text(Lexer *lex, Token *token, char *buffer) {
+    const char *p = lex->source + token->offset;
+    const char *end = p + token->length;
+    int i = 0;
 
-        if (lex->current == '\n') {
-            token.type = TOKEN_NEWLINE;
-            strcpy(token.value, "\\n");
-            lexer_advance(lex);
-            return token;
-        }
+    if (token->type == TOKEN_EOF) {
+        strcpy(buffer, "EOF");
+        return buffer;
+    }
+    if (token->type != TOKEN_STRING_LITERAL) {
+        int length = token->length < 255 ? token->length : 255;
+        memcpy(buffer, p, length);
+        buffer[length] = '\0';
+        return buffer;
+    }
 
-        switch (lex->current) {
-            case '=':
-                lexer_advance(lex);
-                if (lex->current == '=') {
-                    token.type = TOKEN_EQUAL;
-                    strcpy(token.value, "==");
-                    lexer_advance(lex);
-                } else {
-                    token.type = TOKEN_ASSIGN;
-                    strcpy(token.value, "=");
-                }
-                return token;
-            case '!':
-                lexer_advance(lex);
-                if (lex->current == '=') {
-                    token.type = TOKEN_NOT_EQUAL;
-                    strcpy(token.value, "!=");
-                    lexer_advance(lex);
-                } else {
-                    token.type = TOKEN_NOT;
-                    strcpy(token.value, "!");
-                }
-                return token;
-            case '<':
-                lexer_advance(lex);
-                if (lex->current == '=') {
-                    token.type = TOKEN_LESS_EQUAL;
-                    strcpy(token.value, "<=");
-                    lexer_advance(lex);
-                } else {
-                    token.type = TOKEN_LESS;
-                    strcpy(token.value, "<");
-                }
-                return token;
-            case '>':
-                lexer_advance(lex);
-                if (lex->current == '=') {
-                    token.type = TOKEN_GREATER_EQUAL;
-                    strcpy(token.value, ">=");
-                    lexer_advance(lex);
-                } else {
-                    token.type = TOKEN_GREATER;
-                    strcpy(token.value, ">");
-                }
-                return token;
-            case '&':
-                lexer_advance(lex);
-                if (lex->current == '&') {
-                    token.type = TOKEN_AND;
-                    strcpy(token.value, "&&");
-                    lexer_advance(lex);
-                    return token;
-                }
-                break;
-            case '|':
-                lexer_advance(lex);
-                if (lex->current == '|') {
-                    token.type = TOKEN_OR;
-                    strcpy(token.value, "||");
-                    lexer_advance(lex);
-                    return token;
-                }
-                break;
-            case '+':
-                lexer_advance(lex);
-                if (lex->current == '+') {
-                    token.type = TOKEN_INCREMENT;
-                    strcpy(token.value, "++");
-                    lexer_advance(lex);
-                } else {
-                    token.type = TOKEN_PLUS;
-                    strcpy(token.value, "+");
-                }
-                return token;
-            case '-':
-                lexer_advance(lex);
-                if (lex->current == '-') {
-                    token.type = TOKEN_DECREMENT;
-                    strcpy(token.value, "--");
-                    lexer_advance(lex);
-                } else {
-                    token.type = TOKEN_MINUS;
-                    strcpy(token.value, "-");
-                }
-                return token;
-            case '*':
-                token.type = TOKEN_MULTIPLY;
-                strcpy(token.value, "*");
-                lexer_advance(lex);
-                return token;
-            case '/':
-                token.type = TOKEN_DIVIDE;
-                strcpy(token.value, "/");
-                lexer_advance(lex);
-                return token;
-            case '%':
-                token.type = TOKEN_MODULO;
-                strcpy(token.value, "%");
-                lexer_advance(lex);
-                return token;
-            case '(':
-                token.type = TOKEN_LPAREN;
-                strcpy(token.value, "(");
-                lexer_advance(lex);
-                return token;
-            case ')':
-                token.type = TOKEN_RPAREN;
-                strcpy(token.value, ")");
-                lexer_advance(lex);
-                return token;
-            case '{':
-                token.type = TOKEN_LBRACE;
-                strcpy(token.value, "{");
-                lexer_advance(lex);
-                return token;
-            case '}':
-                token.type = TOKEN_RBRACE;
-                strcpy(token.value, "}");
-                lexer_advance(lex);
-                return token;
-            case '[':
-                token.type = TOKEN_LBRACKET;
-                strcpy(token.value, "[");
-                lexer_advance(lex);
-                return token;
-            case ']':
-                token.type = TOKEN_RBRACKET;
-                strcpy(token.value, "]");
-                lexer_advance(lex);
-                return token;
-            case ',':
-                token.type = TOKEN_COMMA;
-                strcpy(token.value, ",");
-                lexer_advance(lex);
-                return token;
+    while (p < end && i < 255) {
+        if (*p == '\\' && p + 1 < end && (p[1] == 'n' || p[1] == 't' || p[1] == '"')) {
+            buffer[i++] = p[1] == 'n' ? '\n' : p[1] == 't' ? '\t' : '"';
+            p += 2;
+        } else {
+            buffer[i++] = *p++;
         }
-
-        lexer_advance(lex);
     }
-
-    token.type = TOKEN_EOF;
-    strcpy(token.value, "EOF");
-    token.line = lex->line;
-    return token;
+    buffer[i] = '\0';
+    return buffer;
 }
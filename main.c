@@ -3,61 +3,348 @@
 #include <string.h>
 #include <ctype.h>
 #include <stdarg.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
 #include "cli.c"
+#include "report.c"
+#include "remarks.c"
 #include "lexer.c"
 #include "ast.c"
 #include "parser.c"
 #include "codegen.c"
+#include "pgo.c"
+#include "ir.c"
+#include "eval.c"
+#include "unroll.c"
+#include "specialize.c"
 
 
 
 // ==================== MAIN ====================
 
-char* read_file(const char *filename) {
-    FILE *file = fopen(filename, "r");
-    if (!file) {
+// El fuente se mapea en memoria: el lexer lo recorre sin copiarlo
+const char* map_file(const char *filename, size_t *size) {
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
         error("Could not open file %s\n", filename);
         return NULL;
     }
 
-    fseek(file, 0, SEEK_END);
-    long size = ftell(file);
-    fseek(file, 0, SEEK_SET);
+    *size = st.st_size;
+    if (*size == 0) {
+        close(fd);
+        return "";
+    }
+    const char *content = (const char*)mmap(NULL, *size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (content == MAP_FAILED) {
+        error("Could not read file %s\n", filename);
+        return NULL;
+    }
+    madvise((void*)content, *size, MADV_SEQUENTIAL);
+    return content;
+}
+
+// ==================== MODULE GRAPH ====================
+// Los imports se resuelven respecto al fichero que los contiene y cada
+// modulo se identifica por su inodo, asi que se parsea una sola vez aunque
+// se llegue a el por varios caminos. El grafo se recorre por niveles: los
+// modulos nuevos de un nivel se leen y parsean en paralelo.
 
-    char *content = (char*)malloc(size + 1);
-    fread(content, 1, size, file);
-    content[size] = '\0';
-    fclose(file);
+typedef struct {
+    char path[PATH_MAX];
+    dev_t dev;
+    ino_t ino;
+    const char *source;
+    size_t source_size;
+    ASTNode *ast;
+    int *imports;
+    int import_count;
+    int state;
+    unsigned long long folded;  // digest de lo evaluado en compilacion
+    unsigned long long profiled; // digest de las cuentas de --profile-use
+    unsigned long long specialized; // digest de las copias y llamadas especializadas
+    PhaseReport lex;
+    PhaseReport parse;
+} Module;
 
-    return content;
+typedef struct {
+    Module **modules;
+    int count;
+    int capacity;
+    int next;
+    int level_end;
+} ModuleGraph;
+
+int module_graph_add(ModuleGraph *graph, const char *path, const char *importer) {
+    char resolved[PATH_MAX];
+    struct stat st;
+    if (!realpath(path, resolved) || stat(resolved, &st) != 0) {
+        if (importer) {
+            error("Cannot resolve import \"%s\" from %s", path, importer);
+        }
+        error("Could not open file %s", path);
+    }
+
+    for (int i = 0; i < graph->count; i++) {
+        if (graph->modules[i]->dev == st.st_dev && graph->modules[i]->ino == st.st_ino) {
+            return i;
+        }
+    }
+
+    if (graph->count >= graph->capacity) {
+        graph->capacity = graph->capacity == 0 ? 16 : graph->capacity * 2;
+        graph->modules = (Module**)realloc(graph->modules, graph->capacity * sizeof(Module*));
+    }
+    Module *module = (Module*)calloc(1, sizeof(Module));
+    strcpy(module->path, resolved);
+    module->dev = st.st_dev;
+    module->ino = st.st_ino;
+    graph->modules[graph->count] = module;
+    return graph->count++;
 }
 
-void process_imports(ASTNode *program, const char *base_path) {
-    for (int i = 0; i < program->child_count; i++) {
-        if (program->children[i]->type == AST_IMPORT) {
-            char *import_file = program->children[i]->value;
-            char full_path[512];
-            sprintf(full_path, "%s", import_file);
-            info("Importing: %s", import_file);
-            char *source = read_file(full_path);
-            if (source) {
-                Lexer lexer;
-                lexer_init(&lexer, source);
-
-                Parser parser;
-                parser_init(&parser, &lexer);
-                ASTNode *imported_ast = parser_parse_program(&parser);
-
-                for (int j = 0; j < imported_ast->child_count; j++) {
-                    if (imported_ast->children[j]->type == AST_FUNCTION) {
-                        ast_add_child(program, imported_ast->children[j]);
-                    }
-                }
-
-                free(source);
+void module_parse(Module *module) {
+    PhaseMark mark;
+    report_start(&mark, 1);
+    module->source = map_file(module->path, &module->source_size);
+
+    Lexer lexer;
+    lexer_init(&lexer, module->source, module->source_size);
+    lexer_tokenize(&lexer);
+    report_stop(&mark, &module->lex);
+    module->lex.tokens = lexer.token_count;
+    module->lex.nodes = -1;
+    module->lex.instructions = -1;
+
+    report_start(&mark, 1);
+    Parser parser;
+    ast_file = module->path;
+    parser_init(&parser, &lexer);
+    module->ast = parser_parse_program(&parser);
+    lexer_free(&lexer);
+
+    report_stop(&mark, &module->parse);
+    module->parse.tokens = -1;
+    module->parse.nodes = report_mode ? ast_count_nodes(module->ast) : -1;
+    module->parse.instructions = -1;
+}
+
+void* module_parse_worker(void *arg) {
+    ModuleGraph *graph = (ModuleGraph*)arg;
+    for (;;) {
+        int i = __atomic_fetch_add(&graph->next, 1, __ATOMIC_RELAXED);
+        if (i >= graph->level_end) break;
+        module_parse(graph->modules[i]);
+    }
+    return NULL;
+}
+
+// Parsea los modulos [graph->next, graph->level_end)
+void module_graph_parse_level(ModuleGraph *graph) {
+    int pending = graph->level_end - graph->next;
+    int threads = sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > pending) threads = pending;
+    if (threads <= 1) {
+        module_parse_worker(graph);
+        return;
+    }
+
+    pthread_t *workers = (pthread_t*)malloc(threads * sizeof(pthread_t));
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&workers[i], NULL, module_parse_worker, graph);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    free(workers);
+}
+
+void module_graph_link(ModuleGraph *graph, int index) {
+    Module *module = graph->modules[index];
+    char dir[PATH_MAX];
+    strcpy(dir, module->path);
+    *strrchr(dir, '/') = '\0';
+
+    for (int i = 0; i < module->ast->child_count; i++) {
+        ASTNode *child = module->ast->children[i];
+        if (child->type != AST_IMPORT) continue;
+
+        char path[PATH_MAX];
+        if (child->value[0] == '/') {
+            snprintf(path, sizeof(path), "%s", child->value);
+        } else {
+            snprintf(path, sizeof(path), "%s/%s", dir, child->value);
+        }
+        int target = module_graph_add(graph, path, module->path);
+        module = graph->modules[index];
+        module->imports = (int*)realloc(module->imports, (module->import_count + 1) * sizeof(int));
+        module->imports[module->import_count++] = target;
+    }
+}
+
+// Recorrido en profundidad: un modulo aun en la pila (state 1) cierra un ciclo
+void module_graph_check_cycles(ModuleGraph *graph, int index, int *stack, int depth) {
+    Module *module = graph->modules[index];
+    module->state = 1;
+    stack[depth] = index;
+    for (int i = 0; i < module->import_count; i++) {
+        int target = module->imports[i];
+        if (graph->modules[target]->state == 1) {
+            warning("Import cycle detected:");
+            int from = depth;
+            while (stack[from] != target) from--;
+            for (int j = from; j <= depth; j++) {
+                printf("  %s ->\n", graph->modules[stack[j]]->path);
             }
+            printf("  %s\n", graph->modules[target]->path);
+        } else if (graph->modules[target]->state == 0) {
+            module_graph_check_cycles(graph, target, stack, depth + 1);
         }
     }
+    module->state = 2;
+}
+
+void module_graph_build(ModuleGraph *graph, const char *root) {
+    memset(graph, 0, sizeof(ModuleGraph));
+    module_graph_add(graph, root, NULL);
+
+    int level_start = 0;
+    while (level_start < graph->count) {
+        graph->next = level_start;
+        graph->level_end = graph->count;
+        for (int i = level_start; i < graph->level_end; i++) {
+            if (i > 0) info("Importing: %s", graph->modules[i]->path);
+        }
+        module_graph_parse_level(graph);
+
+        for (int i = level_start; i < graph->level_end; i++) {
+            module_graph_link(graph, i);
+        }
+        level_start = graph->level_end;
+    }
+
+    int *stack = (int*)malloc(graph->count * sizeof(int));
+    module_graph_check_cycles(graph, 0, stack, 0);
+    free(stack);
+}
+
+// Para asm: todas las funciones de los modulos importados pasan al raiz
+void module_graph_splice(ModuleGraph *graph) {
+    ASTNode *program = graph->modules[0]->ast;
+    for (int i = 1; i < graph->count; i++) {
+        ASTNode *imported_ast = graph->modules[i]->ast;
+        for (int j = 0; j < imported_ast->child_count; j++) {
+            if (imported_ast->children[j]->type == AST_FUNCTION) {
+                ast_add_child(program, imported_ast->children[j]);
+            }
+        }
+    }
+}
+
+// ==================== MODULE CACHE ====================
+// Cada import se compila a su propio objeto en .bcache/<clave>.o. La clave
+// es un hash FNV-1a de la fuente y de la identidad del compilador, asi que
+// un modulo sin cambios se enlaza directamente sin volver a generarlo.
+
+#define B_VERSION "1"
+#define B_BUILD_ID B_VERSION " " __DATE__ " " __TIME__
+#define CACHE_DIR ".bcache"
+
+unsigned long long hash_bytes(unsigned long long hash, const char *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+void append_object(char **objects, const char *object) {
+    size_t len = *objects ? strlen(*objects) : 0;
+    *objects = (char*)realloc(*objects, len + strlen(object) + 2);
+    (*objects)[len] = ' ';
+    strcpy(*objects + len + 1, object);
+}
+
+const char* nasm_debug_flags() {
+    return codegen_options.debug ? " -g -F dwarf" : "";
+}
+
+void compile_module(Module *module, char **objects) {
+    const char *path = module->path;
+    unsigned long long key = hash_bytes(14695981039346656037ull, module->source, module->source_size);
+    key = hash_bytes(key, B_BUILD_ID, strlen(B_BUILD_ID));
+    key = hash_bytes(key, (const char*)&codegen_options, sizeof(codegen_options));
+    if (codegen_options.debug) {
+        // La informacion de lineas lleva la ruta del fuente
+        key = hash_bytes(key, path, strlen(path));
+    }
+    // Las llamadas const sustituidas dependen de funciones de otros modulos
+    key = hash_bytes(key, (const char*)&module->folded, sizeof(module->folded));
+    key = hash_bytes(key, (const char*)&module->profiled, sizeof(module->profiled));
+    key = hash_bytes(key, (const char*)&module->specialized, sizeof(module->specialized));
+    // Tras el tree shaking el objeto depende de que funciones siguen vivas
+    for (int i = 0; i < module->ast->child_count; i++) {
+        ASTNode *child = module->ast->children[i];
+        if (child->type != AST_FUNCTION) continue;
+        key = hash_bytes(key, child->value, strlen(child->value) + 1);
+        // La convencion interna depende de quien la llama en otros modulos
+        if (codegen_is_internal(child->value)) key = hash_bytes(key, "internal", 8);
+    }
+
+    char object[64], asm_file[64], temp[64], command[320];
+    sprintf(object, CACHE_DIR "/%016llx.o", key);
+    sprintf(asm_file, CACHE_DIR "/%016llx.asm", key);
+    sprintf(temp, CACHE_DIR "/%016llx.o.tmp", key);
+    append_object(objects, object);
+
+    PhaseMark mark;
+    report_start(&mark, 0);
+    struct stat st;
+    // Con --remarks se recompila: el objeto cacheado no trae las del backend
+    if (remarks_mode == REMARKS_OFF && stat(object, &st) == 0) {
+        info("Using cached module: %s", path);
+        report_phase(&mark, "cached", path, -1, -1, -1);
+        return;
+    }
+
+    info("Compiling module: %s", path);
+    mkdir(CACHE_DIR, 0755);
+    FILE *output = fopen(asm_file, "w");
+    if (!output) {
+        error("Could not create %s", asm_file);
+    }
+    CodeGen codegen;
+    codegen_init(&codegen, output);
+    codegen_module(&codegen, module->ast);
+    fclose(output);
+    report_phase(&mark, "codegen", path, -1, -1, codegen.instruction_count);
+
+    // Se ensambla a un temporal: un objeto a medias nunca queda en la cache
+    report_start(&mark, 0);
+    sprintf(command, "nasm -f elf64%s %s -o %s", nasm_debug_flags(), asm_file, temp);
+    if (system(command) != 0) {
+        error("NASM assembly failed for module %s", path);
+    }
+    rename(temp, object);
+    report_phase(&mark, "nasm", path, -1, -1, -1);
+}
+
+// Un modulo del que no queda ninguna funcion viva no se compila ni se enlaza
+void compile_imports(ModuleGraph *graph, char **objects) {
+    for (int i = 1; i < graph->count; i++) {
+        ASTNode *ast = graph->modules[i]->ast;
+        int functions = 0;
+        for (int j = 0; j < ast->child_count; j++) {
+            if (ast->children[j]->type == AST_FUNCTION) functions++;
+        }
+        if (functions > 0) compile_module(graph->modules[i], objects);
+    }
 }
 
 void help(){
@@ -72,17 +359,36 @@ void help(){
     printf("%sExamples:%s\n", COLOR_YELLOW, COLOR_RESET);
     printf("  b compile program.b\n");
     printf("  b asm program.b\n");
-    printf("  b run program.b\n\n");
+    printf("  b run program.b\n");
+    printf("  b compile --time-report program.b\n\n");
+    printf("%sOptions:%s\n", COLOR_YELLOW, COLOR_RESET);
+    printf("  %s--time-report%s       Time, memory and size of every compiler phase\n", COLOR_GREEN, COLOR_RESET);
+    printf("  %s--time-report=json%s  Same report as JSON on stderr\n", COLOR_GREEN, COLOR_RESET);
+    printf("  %s--remarks%s           What the optimizer did on each source line, and why not\n", COLOR_GREEN, COLOR_RESET);
+    printf("  %s--remarks=json|yaml%s Same remarks on stderr, for tools\n", COLOR_GREEN, COLOR_RESET);
+    printf("  %s--profile[=file]%s    Instrument functions and loops; flat profile at exit\n", COLOR_GREEN, COLOR_RESET);
+    printf("  %s--profile-generate[=file]%s  Count branches, loops and calls; append to file (b.profdata) at exit\n", COLOR_GREEN, COLOR_RESET);
+    printf("  %s--profile-use[=file]%s  Lay out branches and cold code by the counts of --profile-generate runs\n", COLOR_GREEN, COLOR_RESET);
+    printf("  %s-g%s                  DWARF line info for gdb and perf\n", COLOR_GREEN, COLOR_RESET);
+    printf("  %s-O%s                  Optimize through the SSA IR (CSE, DCE, copy propagation), unroll small loops\n", COLOR_GREEN, COLOR_RESET);
+    printf("                      and specialize functions called with constant arguments\n");
+    printf("  %s--emit=ir%s           Write the optimized IR of every function to output.ir\n\n", COLOR_GREEN, COLOR_RESET);
     printf("%sFeatures:%s\n", COLOR_YELLOW, COLOR_RESET);
     printf("  - Types: int, float, bool, string\n");
-    printf("  - Control: if/else, continue, loop\n");
+    printf("  - Control: if/else, if likely/unlikely, switch/case/default, continue, loop, #unroll N loop\n");
+    printf("  - Parallel: parallel loop i < n reduce + sum, min lo, max hi { }\n");
     printf("  - Operators: +, -, *, /, %%, ++, --\n");
     printf("  - Comparisons: ==, !=, <, >, <=, >=\n");
     printf("  - Logic: &&, ||, !\n");
-    printf("  - Arrays: int arr[10]\n");
+    printf("  - Arrays: int arr[10], int table[256] = f (table[i] = f(i))\n");
     printf("  - Functions: func name(int x) { }\n");
+    printf("  - Const: const func f(int x) { } (evaluated at compile time)\n");
     printf("  - Built-ins: print(), input(), str_to_int(), exit()\n");
-    printf("  - Import: import \"file.b\"\n");
+    printf("  - Stdin: read_line(), read_int(), read_all(), eof()\n");
+    printf("  - Files: open(), close(), read(), write(), mmap_file(), byte_at()\n");
+    printf("  - Atomics: atomic_add(), atomic_cas(), atomic_load(), atomic_store()\n");
+    printf("  - Locks: mutex_lock(), mutex_unlock(), spin_lock(), spin_unlock()\n");
+    printf("  - Import: import \"file.b\" (compiled once, cached in .bcache/)\n");
 }
 
 
@@ -97,24 +403,189 @@ int main(int argc, char **argv) {
         return 0;
     }
 
-    if (argc < 2) {
+    if (argc < 3) {
         error("Missing source file");
     }
 
     const char *command = argv[1];
-    char *source = read_file(argv[2]);
-    if (!source) return 1;
+    const char *file = NULL;
+    int emit_ir = 0;
+    const char *profile_use = NULL;
+    for (int i = 2; i < argc; i++) {
+        if (strcmp(argv[i], "--time-report") == 0) {
+            report_mode = REPORT_TEXT;
+        } else if (strcmp(argv[i], "--time-report=json") == 0) {
+            report_mode = REPORT_JSON;
+        } else if (strcmp(argv[i], "--remarks") == 0) {
+            remarks_mode = REMARKS_TEXT;
+        } else if (strcmp(argv[i], "--remarks=json") == 0) {
+            remarks_mode = REMARKS_JSON;
+        } else if (strcmp(argv[i], "--remarks=yaml") == 0) {
+            remarks_mode = REMARKS_YAML;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            codegen_options.profile = 1;
+        } else if (strncmp(argv[i], "--profile=", 10) == 0) {
+            codegen_options.profile = 1;
+            snprintf(codegen_options.profile_path, PATH_MAX, "%s", argv[i] + 10);
+        } else if (strcmp(argv[i], "--profile-generate") == 0) {
+            codegen_options.pgo_generate = 1;
+            strcpy(codegen_options.pgo_path, PGO_DEFAULT_PATH);
+        } else if (strncmp(argv[i], "--profile-generate=", 19) == 0) {
+            codegen_options.pgo_generate = 1;
+            snprintf(codegen_options.pgo_path, PATH_MAX, "%s", argv[i] + 19);
+        } else if (strcmp(argv[i], "--profile-use") == 0) {
+            profile_use = PGO_DEFAULT_PATH;
+        } else if (strncmp(argv[i], "--profile-use=", 14) == 0) {
+            profile_use = argv[i] + 14;
+        } else if (strcmp(argv[i], "-g") == 0) {
+            codegen_options.debug = 1;
+        } else if (strcmp(argv[i], "-O") == 0) {
+            codegen_options.optimize = 1;
+        } else if (strcmp(argv[i], "--emit=ir") == 0) {
+            emit_ir = 1;
+        } else if (argv[i][0] == '-') {
+            error("Unknown option: %s", argv[i]);
+        } else {
+            file = argv[i];
+        }
+    }
+    if (!file) {
+        error("Missing source file");
+    }
 
-    info("B Compiler - Compiling %s...\n", argv[2]);
+    PhaseMark total, mark;
+    report_start(&total, 0);
+    info("B Compiler - Compiling %s...\n", file);
 
-    Lexer lexer;
-    lexer_init(&lexer, source);
+    report_start(&mark, 0);
+    ModuleGraph graph;
+    module_graph_build(&graph, file);
+    ASTNode *ast = graph.modules[0]->ast;
+    if (report_mode) {
+        for (int i = 0; i < graph.count; i++) {
+            PhaseReport *entry = report_add("lex", graph.modules[i]->path);
+            *entry = graph.modules[i]->lex;
+            strcpy(entry->phase, "lex");
+            strcpy(entry->module, graph.modules[i]->path);
+            entry = report_add("parse", graph.modules[i]->path);
+            *entry = graph.modules[i]->parse;
+            strcpy(entry->phase, "parse");
+            strcpy(entry->module, graph.modules[i]->path);
+        }
+        report_phase(&mark, "modules", file, -1, -1, -1);
+    }
 
-    Parser parser;
-    parser_init(&parser, &lexer);
-    ASTNode *ast = parser_parse_program(&parser);
+    // Antes del tree shaking: las funciones usadas solo en compilacion desaparecen
+    report_start(&mark, 0);
+    ASTNode **programs = (ASTNode**)malloc(graph.count * sizeof(ASTNode*));
+    for (int i = 0; i < graph.count; i++) {
+        programs[i] = graph.modules[i]->ast;
+    }
+    // Los contadores del perfil se numeran antes de plegar nada (pgo.c)
+    if (codegen_options.pgo_generate || profile_use) {
+        for (int i = 0; i < graph.count; i++) pgo_number(programs[i]);
+    }
+    unsigned long long *digests = (unsigned long long*)calloc(graph.count, sizeof(unsigned long long));
+    EvalReport evaluated;
+    eval_program(programs, graph.count, digests, &evaluated);
+    for (int i = 0; i < graph.count; i++) {
+        graph.modules[i]->folded = digests[i];
+    }
+    free(digests);
+    if (evaluated.calls > 0 || evaluated.tables > 0) {
+        info("Compile-time evaluation: folded %d calls and %d tables", evaluated.calls, evaluated.tables);
+    }
+    report_phase(&mark, "consteval", file, -1, -1, -1);
 
-    process_imports(ast, ".");
+    if (profile_use) {
+        report_start(&mark, 0);
+        PgoProfile *profile = pgo_load(profile_use);
+        if (!profile) {
+            warning("Could not read profile %s, compiling without it", profile_use);
+        } else {
+            unsigned long long *digests = (unsigned long long*)calloc(graph.count, sizeof(unsigned long long));
+            PgoReport applied;
+            pgo_apply(programs, graph.count, profile, digests, &applied);
+            for (int i = 0; i < graph.count; i++) {
+                graph.modules[i]->profiled = digests[i];
+            }
+            info("Profile %s: applied to %d functions", profile_use, applied.functions);
+            free(digests);
+            pgo_free(profile);
+        }
+        report_phase(&mark, "pgo", file, -1, -1, -1);
+    }
+
+    // Con el perfil ya aplicado (reparte el presupuesto) y antes del tree
+    // shaking, que quita las funciones a las que ya solo llaman las copias
+    if (codegen_options.optimize && !codegen_options.pgo_generate) {
+        report_start(&mark, 0);
+        unsigned long long *digests = (unsigned long long*)calloc(graph.count, sizeof(unsigned long long));
+        SpecReport specialized;
+        spec_program(programs, graph.count, digests, &specialized);
+        for (int i = 0; i < graph.count; i++) {
+            graph.modules[i]->specialized = digests[i];
+        }
+        free(digests);
+        if (specialized.clones > 0) {
+            info("Specialization: %d clones for %d call sites with constant arguments",
+                 specialized.clones, specialized.calls);
+        }
+        report_phase(&mark, "specialize", file, -1, -1, -1);
+    }
+
+    // En el informe, instructions de shake son las que se han eliminado
+    report_start(&mark, 0);
+    ShakeReport shake;
+    codegen_tree_shake(programs, graph.count, report_mode != REPORT_OFF, &shake);
+    codegen_mark_internal(programs, graph.count);
+    free(programs);
+    // Contadores de --profile y --profile-generate con lock (va en la clave
+    // de la cache con el resto de codegen_options)
+    codegen_options.threaded = (codegen_runtime_units & RUNTIME_PARALLEL) != 0;
+    if (shake.functions > 0 || shake.runtime > 0) {
+        info("Tree shaking: removed %d unused functions and %d runtime routines", shake.functions, shake.runtime);
+    }
+    report_phase(&mark, "shake", file, -1, -1, report_mode ? shake.instructions : -1);
+
+    // Despues del perfil (decide que bucles merecen la pena); con
+    // --profile-generate no, los contadores se numeran sobre el fuente
+    if (!codegen_options.pgo_generate) {
+        report_start(&mark, 0);
+        UnrollReport unrolled;
+        memset(&unrolled, 0, sizeof(unrolled));
+        for (int i = 0; i < graph.count; i++) {
+            unroll_program(graph.modules[i]->ast, codegen_options.optimize, &unrolled);
+        }
+        if (unrolled.full > 0 || unrolled.partial > 0) {
+            info("Loop unrolling: %d loops fully unrolled, %d partially", unrolled.full, unrolled.partial);
+        }
+        report_phase(&mark, "unroll", file, -1, -1, -1);
+    } else {
+        for (int i = 0; i < graph.count; i++) unroll_clear(graph.modules[i]->ast);
+    }
+
+    if (emit_ir) {
+        FILE *ir = fopen("output.ir", "w");
+        if (!ir) {
+            error("Could not create output.ir");
+        }
+        for (int i = 0; i < graph.count; i++) {
+            fprintf(ir, "; module %s\n\n", graph.modules[i]->path);
+            ir_dump_program(graph.modules[i]->ast, ir);
+        }
+        fclose(ir);
+        success("IR written: output.ir");
+    }
+
+    // asm produce un unico fichero autocontenido; compile y run enlazan
+    // un objeto por modulo
+    char *objects = NULL;
+    if (strcmp(command, "asm") == 0) {
+        module_graph_splice(&graph);
+    } else {
+        compile_imports(&graph, &objects);
+    }
 
     FILE *output = fopen("output.asm", "w");
     if (!output) {
@@ -122,32 +593,48 @@ int main(int argc, char **argv) {
         return 1;
     }
     info("Generating assembly code...");
+    report_start(&mark, 0);
     CodeGen codegen;
     codegen_init(&codegen, output);
     codegen_program(&codegen, ast);
 
     fclose(output);
-    free(source);
+    report_phase(&mark, "codegen", graph.modules[0]->path, -1, -1, codegen.instruction_count);
 
     success("Assembly generated: output.asm");
 
 
     if (strcmp(command, "compile") == 0 || strcmp(command, "run") == 0) {
         info("Assembling with NASM...");
-        int ret = system("nasm -f elf64 output.asm -o output.o");
+        report_start(&mark, 0);
+        char assemble[64];
+        sprintf(assemble, "nasm -f elf64%s output.asm -o output.o", nasm_debug_flags());
+        int ret = system(assemble);
         if (ret != 0) {
             error("NASM assembly failed");
         }
+        report_phase(&mark, "nasm", graph.modules[0]->path, -1, -1, -1);
         success("Object file created: output.o");
 
         info("Linking...");
-        ret = system("ld output.o -o program");
+        report_start(&mark, 0);
+        char *link = (char*)malloc(64 + (objects ? strlen(objects) : 0));
+        sprintf(link, "ld output.o%s -o program", objects ? objects : "");
+        ret = system(link);
+        free(link);
         if (ret != 0) {
             error("Linking failed");
         }
+        report_phase(&mark, "ld", "program", -1, -1, -1);
         success("Executable created: program");
 
         if (strcmp(command, "run") == 0) {
+            report_phase(&total, "total", file, -1, -1, -1);
+            report_print();
+            report_mode = REPORT_OFF;
+            remarks_print();
+            remarks_mode = REMARKS_OFF;
+
             info("Running program...");
             printf("\n%s--- Program Output ---%s\n", COLOR_MAGENTA, COLOR_RESET);
             ret = system("./program");
@@ -157,12 +644,15 @@ int main(int argc, char **argv) {
     } else if (strcmp(command, "asm") == 0) {
         success("Assembly code ready: output.asm");
         info("To assemble and run manually:");
-        printf("  nasm -f elf64 output.asm -o output.o\n");
+        printf("  nasm -f elf64%s output.asm -o output.o\n", nasm_debug_flags());
         printf("  ld output.o -o program\n");
         printf("  ./program\n");
     } else {
         error("Unknown command: %s", command);
     }
 
+    report_phase(&total, "total", file, -1, -1, -1);
+    report_print();
+    remarks_print();
     return 0;
 }
@@ -0,0 +1,638 @@
+section .data
+    newline db 10
+
+section .bss
+
+section .text
+global _start
+global format_int
+global str_len
+global write_iov
+
+format_int:
+    mov rax, rdi
+    mov r8, rsi
+    mov rcx, 10
+    test rax, rax
+    jns .convert
+    neg rax
+.convert:
+    xor edx, edx
+    div rcx
+    add dl, '0'
+    dec rsi
+    mov [rsi], dl
+    test rax, rax
+    jnz .convert
+    test rdi, rdi
+    jns .done
+    dec rsi
+    mov byte [rsi], '-'
+.done:
+    mov rax, rsi
+    mov rdx, r8
+    sub rdx, rsi
+    ret
+
+str_len:
+    xor eax, eax
+.scan:
+    cmp byte [rdi + rax], 0
+    je .done
+    inc rax
+    jmp .scan
+.done:
+    ret
+
+write_iov:
+    push rbx
+    push r12
+    mov rbx, rdi
+    mov r12, rsi
+.again:
+    test r12, r12
+    jz .done
+    mov rdx, r12
+    cmp rdx, 1024
+    jbe .write
+    mov rdx, 1024
+.write:
+    mov rax, 20
+    mov rdi, 1
+    mov rsi, rbx
+    syscall
+    cmp rax, -4
+    je .again
+    test rax, rax
+    js .done
+.consume:
+    test r12, r12
+    jz .done
+    mov rcx, [rbx + 8]
+    cmp rax, rcx
+    jb .partial
+    sub rax, rcx
+    add rbx, 16
+    dec r12
+    jmp .consume
+.partial:
+    add [rbx], rax
+    sub [rbx + 8], rax
+    jmp .again
+.done:
+    pop r12
+    pop rbx
+    ret
+
+global dense:function (dense.end - dense)
+dense:
+    push r10
+    mov r8, rdi
+.B0:
+    mov rax, r8
+    cmp rax, 5
+    ja .B6
+    lea rcx, [rel .L0]
+    jmp [rcx + rax*8]
+section .rodata
+align 8
+.L0:
+    dq .B2
+    dq .B3
+    dq .B3
+    dq .B4
+    dq .B6
+    dq .B5
+section .text
+.B5:
+    mov r9, 500
+    jmp .B1
+.B4:
+    mov r9, 300
+    jmp .B1
+.B3:
+    mov r10, r8
+    add r10, 200
+    mov r9, r10
+    jmp .B1
+.B2:
+    mov r9, 100
+    jmp .B1
+.B6:
+    mov r9, -1
+.B1:
+    mov rax, r9
+    pop r10
+    ret
+.end:
+
+global mixed:function (mixed.end - mixed)
+mixed:
+    push r10
+    mov r8, rdi
+.B0:
+    mov rax, r8
+    cmp rax, 11
+    je .B2
+    jl .L0
+    cmp rax, 14
+    je .B2
+    jl .L1
+    cmp rax, 100
+    je .B3
+    cmp rax, 200
+    je .B4
+    jmp .B7
+.L1:
+    cmp rax, 12
+    je .B2
+    cmp rax, 13
+    je .B2
+    jmp .B7
+.L0:
+    cmp rax, -3
+    je .B5
+    jl .L2
+    cmp rax, -2
+    je .B5
+    cmp rax, 10
+    je .B2
+    jmp .B7
+.L2:
+    cmp rax, -5
+    je .B5
+    cmp rax, -4
+    je .B5
+    jmp .B7
+.B5:
+    mov r9, r8
+    jmp .B1
+.B4:
+    mov r9, 200
+    jmp .B1
+.B3:
+    mov r9, 100
+    jmp .B1
+.B2:
+    mov r10, r8
+    sub r10, 10
+    mov r9, r10
+    jmp .B1
+.B7:
+    mov r9, 0
+.B1:
+    mov rax, r9
+    pop r10
+    ret
+.end:
+
+global main:function (main.end - main)
+main:
+    push rbx
+    push r12
+    push r13
+.B0:
+    mov rdi, -2
+    call dense
+    mov rbx, rax
+    sub rsp, 64
+    mov rdi, rbx
+    lea rsi, [rsp + 56]
+    call format_int
+    mov [rsp + 8], rdx
+    mov [rsp + 0], rax
+    lea rax, [rel str.0]
+    mov qword [rsp + 24], 1
+    mov [rsp + 16], rax
+    mov rdi, rsp
+    mov rsi, 2
+    call write_iov
+    add rsp, 64
+    mov rdi, -1
+    call dense
+    mov rbx, rax
+    sub rsp, 64
+    mov rdi, rbx
+    lea rsi, [rsp + 56]
+    call format_int
+    mov [rsp + 8], rdx
+    mov [rsp + 0], rax
+    lea rax, [rel str.0]
+    mov qword [rsp + 24], 1
+    mov [rsp + 16], rax
+    mov rdi, rsp
+    mov rsi, 2
+    call write_iov
+    add rsp, 64
+    xor rdi, rdi
+    call dense
+    mov rbx, rax
+    sub rsp, 64
+    mov rdi, rbx
+    lea rsi, [rsp + 56]
+    call format_int
+    mov [rsp + 8], rdx
+    mov [rsp + 0], rax
+    lea rax, [rel str.0]
+    mov qword [rsp + 24], 1
+    mov [rsp + 16], rax
+    mov rdi, rsp
+    mov rsi, 2
+    call write_iov
+    add rsp, 64
+    mov rdi, 1
+    call dense
+    mov rbx, rax
+    sub rsp, 64
+    mov rdi, rbx
+    lea rsi, [rsp + 56]
+    call format_int
+    mov [rsp + 8], rdx
+    mov [rsp + 0], rax
+    lea rax, [rel str.0]
+    mov qword [rsp + 24], 1
+    mov [rsp + 16], rax
+    mov rdi, rsp
+    mov rsi, 2
+    call write_iov
+    add rsp, 64
+    mov rdi, 2
+    call dense
+    mov rbx, rax
+    sub rsp, 64
+    mov rdi, rbx
+    lea rsi, [rsp + 56]
+    call format_int
+    mov [rsp + 8], rdx
+    mov [rsp + 0], rax
+    lea rax, [rel str.0]
+    mov qword [rsp + 24], 1
+    mov [rsp + 16], rax
+    mov rdi, rsp
+    mov rsi, 2
+    call write_iov
+    add rsp, 64
+    mov rdi, 3
+    call dense
+    mov rbx, rax
+    sub rsp, 64
+    mov rdi, rbx
+    lea rsi, [rsp + 56]
+    call format_int
+    mov [rsp + 8], rdx
+    mov [rsp + 0], rax
+    lea rax, [rel str.0]
+    mov qword [rsp + 24], 1
+    mov [rsp + 16], rax
+    mov rdi, rsp
+    mov rsi, 2
+    call write_iov
+    add rsp, 64
+    mov rdi, 4
+    call dense
+    mov rbx, rax
+    sub rsp, 64
+    mov rdi, rbx
+    lea rsi, [rsp + 56]
+    call format_int
+    mov [rsp + 8], rdx
+    mov [rsp + 0], rax
+    lea rax, [rel str.0]
+    mov qword [rsp + 24], 1
+    mov [rsp + 16], rax
+    mov rdi, rsp
+    mov rsi, 2
+    call write_iov
+    add rsp, 64
+    mov rdi, 5
+    call dense
+    mov rbx, rax
+    sub rsp, 64
+    mov rdi, rbx
+    lea rsi, [rsp + 56]
+    call format_int
+    mov [rsp + 8], rdx
+    mov [rsp + 0], rax
+    lea rax, [rel str.0]
+    mov qword [rsp + 24], 1
+    mov [rsp + 16], rax
+    mov rdi, rsp
+    mov rsi, 2
+    call write_iov
+    add rsp, 64
+    mov rdi, 6
+    call dense
+    mov rbx, rax
+    sub rsp, 64
+    mov rdi, rbx
+    lea rsi, [rsp + 56]
+    call format_int
+    mov [rsp + 8], rdx
+    mov [rsp + 0], rax
+    lea rax, [rel str.0]
+    mov qword [rsp + 24], 1
+    mov [rsp + 16], rax
+    mov rdi, rsp
+    mov rsi, 2
+    call write_iov
+    add rsp, 64
+    mov rdi, 7
+    call dense
+    mov rbx, rax
+    sub rsp, 64
+    mov rdi, rbx
+    lea rsi, [rsp + 56]
+    call format_int
+    mov [rsp + 8], rdx
+    mov [rsp + 0], rax
+    lea rax, [rel str.0]
+    mov qword [rsp + 24], 1
+    mov [rsp + 16], rax
+    mov rdi, rsp
+    mov rsi, 2
+    call write_iov
+    add rsp, 64
+    sub rsp, 16
+    lea rax, [rel str.1]
+    mov qword [rsp + 8], 1
+    mov [rsp + 0], rax
+    mov rdi, rsp
+    mov rsi, 1
+    call write_iov
+    add rsp, 16
+    sub rsp, 304
+    mov rdi, 1
+    lea rsi, [rsp + 152]
+    call format_int
+    mov [rsp + 8], rdx
+    mov [rsp + 0], rax
+    mov rdi, 2
+    lea rsi, [rsp + 176]
+    call format_int
+    mov [rsp + 24], rdx
+    mov [rsp + 16], rax
+    mov rdi, 3
+    lea rsi, [rsp + 200]
+    call format_int
+    mov [rsp + 40], rdx
+    mov [rsp + 32], rax
+    mov rdi, 4
+    lea rsi, [rsp + 224]
+    call format_int
+    mov [rsp + 56], rdx
+    mov [rsp + 48], rax
+    mov rdi, 5
+    lea rsi, [rsp + 248]
+    call format_int
+    mov [rsp + 72], rdx
+    mov [rsp + 64], rax
+    mov rdi, 6
+    lea rsi, [rsp + 272]
+    call format_int
+    mov [rsp + 88], rdx
+    mov [rsp + 80], rax
+    xor rdi, rdi
+    lea rsi, [rsp + 296]
+    call format_int
+    mov [rsp + 104], rdx
+    mov [rsp + 96], rax
+    lea rax, [rel str.1]
+    mov qword [rsp + 120], 1
+    mov [rsp + 112], rax
+    mov rdi, rsp
+    mov rsi, 8
+    call write_iov
+    add rsp, 304
+    mov r10, -6
+    mov r11, 0
+.B1:
+    mov r8, 3
+    add r8, r10
+    cmp r8, 210
+    jge .B3
+.B2:
+    mov rdi, r10
+    call mixed
+    mov r8, rax
+    mov r9, 3
+    imul r9, r11
+    mov rbx, r8
+    add rbx, r9
+    mov r8, 10
+    add r8, rbx
+    mov rax, r8
+    mov rcx, 1000003
+    xor rdx, rdx
+    idiv rcx
+    mov rbx, rdx
+    mov r12, 1
+    add r12, r10
+    mov rdi, r12
+    call mixed
+    mov r8, rax
+    mov r9, 3
+    imul r9, rbx
+    mov rbx, r8
+    add rbx, r9
+    mov r8, 10
+    add r8, rbx
+    mov rax, r8
+    mov rcx, 1000003
+    xor rdx, rdx
+    idiv rcx
+    mov rbx, rdx
+    mov r13, 1
+    add r13, r12
+    mov rdi, r13
+    call mixed
+    mov r8, rax
+    mov r9, 3
+    imul r9, rbx
+    mov rbx, r8
+    add rbx, r9
+    mov r8, 10
+    add r8, rbx
+    mov rax, r8
+    mov rcx, 1000003
+    xor rdx, rdx
+    idiv rcx
+    mov rbx, rdx
+    mov r12, 1
+    add r12, r13
+    mov rdi, r12
+    call mixed
+    mov r8, rax
+    mov r9, 3
+    imul r9, rbx
+    mov rbx, r8
+    add rbx, r9
+    mov r8, 10
+    add r8, rbx
+    mov rax, r8
+    mov rcx, 1000003
+    xor rdx, rdx
+    idiv rcx
+    mov r9, rdx
+    mov r8, 1
+    add r8, r12
+    mov r10, r8
+    mov r11, r9
+    jmp .B1
+.B3:
+    mov rbx, r10
+    mov r12, r11
+.B4:
+    cmp rbx, 210
+    jge .B6
+.B5:
+    mov rdi, rbx
+    call mixed
+    mov r8, rax
+    mov r9, 3
+    imul r9, r12
+    mov r10, r8
+    add r10, r9
+    mov r8, 10
+    add r8, r10
+    mov rax, r8
+    mov rcx, 1000003
+    xor rdx, rdx
+    idiv rcx
+    mov r9, rdx
+    mov r8, 1
+    add r8, rbx
+    mov rbx, r8
+    mov r12, r9
+    jmp .B4
+.B6:
+    sub rsp, 64
+    mov rdi, r12
+    lea rsi, [rsp + 56]
+    call format_int
+    mov [rsp + 8], rdx
+    mov [rsp + 0], rax
+    lea rax, [rel str.1]
+    mov qword [rsp + 24], 1
+    mov [rsp + 16], rax
+    mov rdi, rsp
+    mov rsi, 2
+    call write_iov
+    add rsp, 64
+    mov r8, 0
+    mov r9, 0
+    mov rbx, 0
+.B7:
+    mov rax, 1
+    test rax, rax
+    je .B22
+.B8:
+    mov r10, 1
+    add r10, r8
+    mov rax, r9
+    mov rcx, 4
+    xor rdx, rdx
+    idiv rcx
+    mov r11, rdx
+    mov rax, r11
+    cmp rax, 3
+    ja .B23
+    lea rcx, [rel .L0]
+    jmp [rcx + rax*8]
+section .rodata
+align 8
+.L0:
+    dq .B11
+    dq .B12
+    dq .B13
+    dq .B14
+section .text
+.B14:
+    mov r11, 1
+    add r11, r9
+    mov r8, r10
+    mov r9, r11
+    jmp .B7
+.B13:
+    cmp rbx, 1000
+    jg .B15
+.B16:
+    mov r11, rbx
+    jmp .B10
+.B15:
+    mov r12, r10
+    jmp .B9
+.B12:
+    mov r13, 2
+    imul r13, rbx
+    mov r11, r13
+    jmp .B10
+.B11:
+    mov r13, 3
+    add r13, rbx
+    mov r11, r13
+    jmp .B10
+.B23:
+    mov r11, rbx
+.B10:
+    mov r13, 1
+    add r13, r9
+    mov r8, r10
+    mov r9, r13
+    mov rbx, r11
+    jmp .B7
+.B22:
+    mov r12, r8
+.B9:
+    sub rsp, 112
+    mov rdi, rbx
+    lea rsi, [rsp + 88]
+    call format_int
+    mov [rsp + 8], rdx
+    mov [rsp + 0], rax
+    lea rax, [rel str.0]
+    mov qword [rsp + 24], 1
+    mov [rsp + 16], rax
+    mov rdi, r12
+    lea rsi, [rsp + 112]
+    call format_int
+    mov [rsp + 40], rdx
+    mov [rsp + 32], rax
+    lea rax, [rel str.1]
+    mov qword [rsp + 56], 1
+    mov [rsp + 48], rax
+    mov rdi, rsp
+    mov rsi, 4
+    call write_iov
+    add rsp, 112
+    mov rax, 3
+    jmp .B19
+.B19:
+    mov rax, 4
+    jmp .B21
+.B21:
+    sub rsp, 16
+    lea rax, [rel str.2]
+    mov qword [rsp + 8], 13
+    mov [rsp + 0], rax
+    mov rdi, rsp
+    mov rsi, 1
+    call write_iov
+    add rsp, 16
+.B20:
+    xor rax, rax
+    pop r13
+    pop r12
+    pop rbx
+    ret
+.end:
+
+_start:
+    call main
+    mov rdi, rax
+    mov rax, 231
+    syscall
+
+section .rodata
+str.0: db 32, 0
+str.2: db 111, 110, 108, 121, 32, 100, 101, 102, 97, 117, 108, 116, 10, 0
+str.1 equ str.2 + 12
@@ -2,34 +2,47 @@
 
 typedef struct {
     Lexer *lexer;
-    Token current_token;
-    Token peek_token;
+    int pos;
+    Token *current_token;
+    Token *peek_token;
+    char text[256];
 } Parser;
 
 void parser_init(Parser *parser, Lexer *lexer) {
     parser->lexer = lexer;
-    parser->current_token = lexer_next_token(lexer);
-    parser->peek_token = lexer_next_token(lexer);
+    parser->pos = 0;
+    parser->current_token = &lexer->tokens[0];
+    parser->peek_token = lexer->token_count > 1 ? &lexer->tokens[1] : parser->current_token;
+    ast_line = parser->current_token->line;
 }
 
+// El ultimo token es siempre EOF: el parser se queda en el y no avanza mas
 void parser_advance(Parser *parser) {
-    parser->current_token = parser->peek_token;
-    parser->peek_token = lexer_next_token(parser->lexer);
+    if (parser->current_token->type != TOKEN_EOF) parser->pos++;
+    parser->current_token = &parser->lexer->tokens[parser->pos];
+    parser->peek_token = parser->current_token->type == TOKEN_EOF ?
+                         parser->current_token : parser->current_token + 1;
+    ast_line = parser->current_token->line;
+}
+
+// Texto del token actual; valido hasta la siguiente llamada
+char* parser_text(Parser *parser) {
+    return lexer_token_text(parser->lexer, parser->current_token, parser->text);
 }
 
 void parser_skip_newlines(Parser *parser) {
-    while (parser->current_token.type == TOKEN_NEWLINE) {
+    while (parser->current_token->type == TOKEN_NEWLINE) {
         parser_advance(parser);
     }
 }
 
 int parser_expect(Parser *parser, TokenType type) {
-    if (parser->current_token.type == type) {
+    if (parser->current_token->type == type) {
         parser_advance(parser);
         return 1;
     }
     error("Expected token type %d but got %d at line %d\n",
-          type, parser->current_token.type, parser->current_token.line);
+          type, parser->current_token->type, parser->current_token->line);
     return 0;
 }
 
@@ -38,10 +51,10 @@ ASTNode* parser_parse_statement(Parser *parser);
 ASTNode* parser_parse_primary(Parser *parser);
 
 ASTNode* parser_parse_unary(Parser *parser) {
-    if (parser->current_token.type == TOKEN_NOT ||
-        parser->current_token.type == TOKEN_MINUS) {
+    if (parser->current_token->type == TOKEN_NOT ||
+        parser->current_token->type == TOKEN_MINUS) {
         char op[8];
-    strcpy(op, parser->current_token.value);
+    strcpy(op, parser_text(parser));
     parser_advance(parser);
 
     ASTNode *operand = parser_parse_unary(parser);
@@ -56,24 +69,24 @@ ASTNode* parser_parse_unary(Parser *parser) {
 ASTNode* parser_parse_primary(Parser *parser) {
     ASTNode *node = NULL;
 
-    if (parser->current_token.type == TOKEN_NUMBER) {
-        node = ast_create_node(AST_NUMBER, parser->current_token.value);
+    if (parser->current_token->type == TOKEN_NUMBER) {
+        node = ast_create_node(AST_NUMBER, parser_text(parser));
         parser_advance(parser);
         return node;
     }
 
-    if (parser->current_token.type == TOKEN_STRING_LITERAL) {
-        node = ast_create_node(AST_STRING, parser->current_token.value);
+    if (parser->current_token->type == TOKEN_STRING_LITERAL) {
+        node = ast_create_node(AST_STRING, parser_text(parser));
         parser_advance(parser);
         return node;
     }
 
-    if (parser->current_token.type == TOKEN_IDENTIFIER) {
+    if (parser->current_token->type == TOKEN_IDENTIFIER) {
         char name[256];
-        strcpy(name, parser->current_token.value);
+        strcpy(name, parser_text(parser));
         parser_advance(parser);
 
-        if (parser->current_token.type == TOKEN_LBRACKET) {
+        if (parser->current_token->type == TOKEN_LBRACKET) {
             parser_advance(parser);
             ASTNode *index = parser_parse_expression(parser);
             parser_expect(parser, TOKEN_RBRACKET);
@@ -83,15 +96,15 @@ ASTNode* parser_parse_primary(Parser *parser) {
             return node;
         }
 
-        if (parser->current_token.type == TOKEN_LPAREN) {
+        if (parser->current_token->type == TOKEN_LPAREN) {
             node = ast_create_node(AST_CALL, name);
             parser_advance(parser);
 
-            while (parser->current_token.type != TOKEN_RPAREN) {
+            while (parser->current_token->type != TOKEN_RPAREN) {
                 ASTNode *arg = parser_parse_expression(parser);
                 ast_add_child(node, arg);
 
-                if (parser->current_token.type == TOKEN_COMMA) {
+                if (parser->current_token->type == TOKEN_COMMA) {
                     parser_advance(parser);
                 }
             }
@@ -104,7 +117,7 @@ ASTNode* parser_parse_primary(Parser *parser) {
         return node;
     }
 
-    if (parser->current_token.type == TOKEN_LPAREN) {
+    if (parser->current_token->type == TOKEN_LPAREN) {
         parser_advance(parser);
         node = parser_parse_expression(parser);
         parser_expect(parser, TOKEN_RPAREN);
@@ -112,18 +125,18 @@ ASTNode* parser_parse_primary(Parser *parser) {
     }
 
     error("Unexpected token in primary expression at line %d\n",
-          parser->current_token.line);
+          parser->current_token->line);
     return NULL;
 }
 
 ASTNode* parser_parse_term(Parser *parser) {
     ASTNode *left = parser_parse_unary(parser);
 
-    while (parser->current_token.type == TOKEN_MULTIPLY ||
-        parser->current_token.type == TOKEN_DIVIDE ||
-        parser->current_token.type == TOKEN_MODULO) {
+    while (parser->current_token->type == TOKEN_MULTIPLY ||
+        parser->current_token->type == TOKEN_DIVIDE ||
+        parser->current_token->type == TOKEN_MODULO) {
         char op[8];
-    strcpy(op, parser->current_token.value);
+    strcpy(op, parser_text(parser));
     parser_advance(parser);
 
     ASTNode *right = parser_parse_unary(parser);
@@ -139,10 +152,10 @@ ASTNode* parser_parse_term(Parser *parser) {
 ASTNode* parser_parse_arithmetic(Parser *parser) {
     ASTNode *left = parser_parse_term(parser);
 
-    while (parser->current_token.type == TOKEN_PLUS ||
-        parser->current_token.type == TOKEN_MINUS) {
+    while (parser->current_token->type == TOKEN_PLUS ||
+        parser->current_token->type == TOKEN_MINUS) {
         char op[8];
-    strcpy(op, parser->current_token.value);
+    strcpy(op, parser_text(parser));
     parser_advance(parser);
 
     ASTNode *right = parser_parse_term(parser);
@@ -158,14 +171,14 @@ ASTNode* parser_parse_arithmetic(Parser *parser) {
 ASTNode* parser_parse_comparison(Parser *parser) {
     ASTNode *left = parser_parse_arithmetic(parser);
 
-    while (parser->current_token.type == TOKEN_EQUAL ||
-        parser->current_token.type == TOKEN_NOT_EQUAL ||
-        parser->current_token.type == TOKEN_LESS ||
-        parser->current_token.type == TOKEN_GREATER ||
-        parser->current_token.type == TOKEN_LESS_EQUAL ||
-        parser->current_token.type == TOKEN_GREATER_EQUAL) {
+    while (parser->current_token->type == TOKEN_EQUAL ||
+        parser->current_token->type == TOKEN_NOT_EQUAL ||
+        parser->current_token->type == TOKEN_LESS ||
+        parser->current_token->type == TOKEN_GREATER ||
+        parser->current_token->type == TOKEN_LESS_EQUAL ||
+        parser->current_token->type == TOKEN_GREATER_EQUAL) {
         char op[8];
-    strcpy(op, parser->current_token.value);
+    strcpy(op, parser_text(parser));
     parser_advance(parser);
 
     ASTNode *right = parser_parse_arithmetic(parser);
@@ -181,10 +194,10 @@ ASTNode* parser_parse_comparison(Parser *parser) {
 ASTNode* parser_parse_expression(Parser *parser) {
     ASTNode *left = parser_parse_comparison(parser);
 
-    while (parser->current_token.type == TOKEN_AND ||
-        parser->current_token.type == TOKEN_OR) {
+    while (parser->current_token->type == TOKEN_AND ||
+        parser->current_token->type == TOKEN_OR) {
         char op[8];
-    strcpy(op, parser->current_token.value);
+    strcpy(op, parser_text(parser));
     parser_advance(parser);
 
     ASTNode *right = parser_parse_comparison(parser);
@@ -199,25 +212,25 @@ ASTNode* parser_parse_expression(Parser *parser) {
 
 ASTNode* parser_parse_var_decl(Parser *parser) {
     char type[64];
-    strcpy(type, parser->current_token.value);
+    strcpy(type, parser_text(parser));
     parser_advance(parser);
 
     char name[256];
-    strcpy(name, parser->current_token.value);
+    strcpy(name, parser_text(parser));
     parser_expect(parser, TOKEN_IDENTIFIER);
 
     ASTNode *node;
 
-    if (parser->current_token.type == TOKEN_LBRACKET) {
+    if (parser->current_token->type == TOKEN_LBRACKET) {
         parser_advance(parser);
 
-        if (parser->current_token.type != TOKEN_NUMBER) {
+        if (parser->current_token->type != TOKEN_NUMBER) {
             printf("Error: Expected array size\n");
             return NULL;
         }
 
         char size[64];
-        strcpy(size, parser->current_token.value);
+        strcpy(size, parser_text(parser));
         parser_advance(parser);
 
         parser_expect(parser, TOKEN_RBRACKET);
@@ -226,13 +239,20 @@ ASTNode* parser_parse_var_decl(Parser *parser) {
         node->left = ast_create_node(AST_IDENTIFIER, type);
         node->right = ast_create_node(AST_NUMBER, size);
 
+        // Tabla: int t[N] = f  rellena t[i] = f(i)
+        if (parser->current_token->type == TOKEN_ASSIGN) {
+            parser_advance(parser);
+            ast_add_child(node, ast_create_node(AST_IDENTIFIER, parser_text(parser)));
+            parser_expect(parser, TOKEN_IDENTIFIER);
+        }
+
         return node;
     }
 
     node = ast_create_node(AST_VAR_DECL, name);
     node->left = ast_create_node(AST_IDENTIFIER, type);
 
-    if (parser->current_token.type == TOKEN_ASSIGN) {
+    if (parser->current_token->type == TOKEN_ASSIGN) {
         parser_advance(parser);
         node->right = parser_parse_expression(parser);
     }
@@ -242,12 +262,12 @@ ASTNode* parser_parse_var_decl(Parser *parser) {
 
 ASTNode* parser_parse_assignment(Parser *parser) {
     char name[256];
-    strcpy(name, parser->current_token.value);
+    strcpy(name, parser_text(parser));
     parser_expect(parser, TOKEN_IDENTIFIER);
 
     ASTNode *node;
 
-    if (parser->current_token.type == TOKEN_LBRACKET) {
+    if (parser->current_token->type == TOKEN_LBRACKET) {
         parser_advance(parser);
         ASTNode *index = parser_parse_expression(parser);
         parser_expect(parser, TOKEN_RBRACKET);
@@ -274,8 +294,8 @@ ASTNode* parser_parse_return(Parser *parser) {
 
     ASTNode *node = ast_create_node(AST_RETURN, "return");
 
-    if (parser->current_token.type != TOKEN_NEWLINE &&
-        parser->current_token.type != TOKEN_RBRACE) {
+    if (parser->current_token->type != TOKEN_NEWLINE &&
+        parser->current_token->type != TOKEN_RBRACE) {
         node->left = parser_parse_expression(parser);
         }
 
@@ -286,6 +306,11 @@ ASTNode* parser_parse_if(Parser *parser) {
     parser_expect(parser, TOKEN_IF);
 
     ASTNode *node = ast_create_node(AST_IF, "if");
+    // if likely / if unlikely: pista para colocar la rama fria fuera de linea
+    if (parser->current_token->type == TOKEN_LIKELY || parser->current_token->type == TOKEN_UNLIKELY) {
+        strcpy(node->value, parser->current_token->type == TOKEN_LIKELY ? "likely" : "unlikely");
+        parser_advance(parser);
+    }
     node->left = parser_parse_expression(parser);
 
     parser_skip_newlines(parser);
@@ -293,9 +318,9 @@ ASTNode* parser_parse_if(Parser *parser) {
     parser_skip_newlines(parser);
 
     ASTNode *then_block = ast_create_node(AST_BLOCK, "then");
-    while (parser->current_token.type != TOKEN_RBRACE) {
+    while (parser->current_token->type != TOKEN_RBRACE) {
         parser_skip_newlines(parser);
-        if (parser->current_token.type == TOKEN_RBRACE) break;
+        if (parser->current_token->type == TOKEN_RBRACE) break;
         ast_add_child(then_block, parser_parse_statement(parser));
         parser_skip_newlines(parser);
     }
@@ -304,11 +329,11 @@ ASTNode* parser_parse_if(Parser *parser) {
     ast_add_child(node, then_block);
 
     parser_skip_newlines(parser);
-    if (parser->current_token.type == TOKEN_ELSE) {
+    if (parser->current_token->type == TOKEN_ELSE) {
         parser_advance(parser);
         parser_skip_newlines(parser);
 
-        if (parser->current_token.type == TOKEN_IF) {
+        if (parser->current_token->type == TOKEN_IF) {
             ASTNode *else_if = parser_parse_if(parser);
             ASTNode *else_block = ast_create_node(AST_BLOCK, "else");
             ast_add_child(else_block, else_if);
@@ -318,9 +343,9 @@ ASTNode* parser_parse_if(Parser *parser) {
             parser_skip_newlines(parser);
 
             ASTNode *else_block = ast_create_node(AST_BLOCK, "else");
-            while (parser->current_token.type != TOKEN_RBRACE) {
+            while (parser->current_token->type != TOKEN_RBRACE) {
                 parser_skip_newlines(parser);
-                if (parser->current_token.type == TOKEN_RBRACE) break;
+                if (parser->current_token->type == TOKEN_RBRACE) break;
                 ast_add_child(else_block, parser_parse_statement(parser));
                 parser_skip_newlines(parser);
             }
@@ -344,9 +369,9 @@ ASTNode* parser_parse_loop(Parser *parser) {
     parser_skip_newlines(parser);
 
     ASTNode *body = ast_create_node(AST_BLOCK, "body");
-    while (parser->current_token.type != TOKEN_RBRACE) {
+    while (parser->current_token->type != TOKEN_RBRACE) {
         parser_skip_newlines(parser);
-        if (parser->current_token.type == TOKEN_RBRACE) break;
+        if (parser->current_token->type == TOKEN_RBRACE) break;
         ast_add_child(body, parser_parse_statement(parser));
         parser_skip_newlines(parser);
     }
@@ -357,44 +382,195 @@ ASTNode* parser_parse_loop(Parser *parser) {
     return node;
 }
 
-ASTNode* parser_parse_statement(Parser *parser) {
+// switch x { case 1, 2 { ... } case -1 { ... } default { ... } }
+// Sin caida de un caso al siguiente: break y continue siguen refiriendose
+// al loop que contiene el switch
+ASTNode* parser_parse_switch(Parser *parser) {
+    parser_expect(parser, TOKEN_SWITCH);
+
+    ASTNode *node = ast_create_node(AST_SWITCH, "switch");
+    node->left = parser_parse_expression(parser);
+
+    parser_skip_newlines(parser);
+    parser_expect(parser, TOKEN_LBRACE);
+    parser_skip_newlines(parser);
+
+    int has_default = 0;
+    while (parser->current_token->type != TOKEN_RBRACE) {
+        ASTNode *item;
+        if (parser->current_token->type == TOKEN_DEFAULT) {
+            if (has_default) {
+                error("Duplicate default at line %d", parser->current_token->line);
+            }
+            has_default = 1;
+            parser_advance(parser);
+            item = ast_create_node(AST_CASE, "default");
+        } else {
+            parser_expect(parser, TOKEN_CASE);
+            item = ast_create_node(AST_CASE, "case");
+            for (;;) {
+                int line = parser->current_token->line;
+                ASTNode *value = parser_parse_unary(parser);
+                if (value->type == AST_UNARY_OP && strcmp(value->value, "-") == 0 &&
+                    value->left->type == AST_NUMBER) {
+                    char negated[256];
+                    snprintf(negated, sizeof(negated), "-%.250s", value->left->value);
+                    value = ast_create_node(AST_NUMBER, negated);
+                }
+                if (value->type != AST_NUMBER) {
+                    error("Case value must be an integer constant at line %d", line);
+                }
+                ast_add_child(item, value);
+                if (parser->current_token->type != TOKEN_COMMA) break;
+                parser_advance(parser);
+            }
+        }
+
+        parser_skip_newlines(parser);
+        parser_expect(parser, TOKEN_LBRACE);
+        parser_skip_newlines(parser);
+
+        ASTNode *body = ast_create_node(AST_BLOCK, "case");
+        while (parser->current_token->type != TOKEN_RBRACE) {
+            parser_skip_newlines(parser);
+            if (parser->current_token->type == TOKEN_RBRACE) break;
+            ast_add_child(body, parser_parse_statement(parser));
+            parser_skip_newlines(parser);
+        }
+        parser_expect(parser, TOKEN_RBRACE);
+
+        item->right = body;
+        ast_add_child(node, item);
+        parser_skip_newlines(parser);
+    }
+    parser_expect(parser, TOKEN_RBRACE);
+
+    return node;
+}
+
+// parallel loop i < n [reduce + sum, min lo, max hi] { ... }
+ASTNode* parser_parse_parallel_loop(Parser *parser) {
+    parser_expect(parser, TOKEN_PARALLEL);
+    parser_expect(parser, TOKEN_LOOP);
+
+    char name[256];
+    strcpy(name, parser_text(parser));
+    parser_expect(parser, TOKEN_IDENTIFIER);
+    parser_expect(parser, TOKEN_LESS);
+
+    ASTNode *node = ast_create_node(AST_PARALLEL_LOOP, name);
+    node->left = parser_parse_arithmetic(parser);
+
+    if (parser->current_token->type == TOKEN_IDENTIFIER &&
+        strcmp(parser_text(parser), "reduce") == 0) {
+        parser_advance(parser);
+
+        while (1) {
+            char op[8];
+            if (parser->current_token->type == TOKEN_PLUS) {
+                strcpy(op, "+");
+            } else if (parser->current_token->type == TOKEN_IDENTIFIER &&
+                       (strcmp(parser_text(parser), "min") == 0 ||
+                        strcmp(parser_text(parser), "max") == 0)) {
+                strcpy(op, parser_text(parser));
+            } else {
+                error("Expected reduction operator (+, min, max) at line %d\n",
+                      parser->current_token->line);
+            }
+            parser_advance(parser);
+
+            ASTNode *reduce = ast_create_node(AST_REDUCE, op);
+            reduce->left = ast_create_node(AST_IDENTIFIER, parser_text(parser));
+            parser_expect(parser, TOKEN_IDENTIFIER);
+            ast_add_child(node, reduce);
+
+            if (parser->current_token->type != TOKEN_COMMA) break;
+            parser_advance(parser);
+        }
+    }
+
     parser_skip_newlines(parser);
+    parser_expect(parser, TOKEN_LBRACE);
+    parser_skip_newlines(parser);
+
+    ASTNode *body = ast_create_node(AST_BLOCK, "body");
+    while (parser->current_token->type != TOKEN_RBRACE) {
+        parser_skip_newlines(parser);
+        if (parser->current_token->type == TOKEN_RBRACE) break;
+        ast_add_child(body, parser_parse_statement(parser));
+        parser_skip_newlines(parser);
+    }
+    parser_expect(parser, TOKEN_RBRACE);
+
+    node->right = body;
 
-    if (parser->current_token.type == TOKEN_INT ||
-        parser->current_token.type == TOKEN_FLOAT ||
-        parser->current_token.type == TOKEN_BOOL ||
-        parser->current_token.type == TOKEN_STRING) {
+    return node;
+}
+
+ASTNode* parser_parse_statement_body(Parser *parser) {
+
+    if (parser->current_token->type == TOKEN_INT ||
+        parser->current_token->type == TOKEN_FLOAT ||
+        parser->current_token->type == TOKEN_BOOL ||
+        parser->current_token->type == TOKEN_STRING) {
         return parser_parse_var_decl(parser);
         }
 
-        if (parser->current_token.type == TOKEN_RETURN) {
+        if (parser->current_token->type == TOKEN_RETURN) {
             return parser_parse_return(parser);
         }
 
-        if (parser->current_token.type == TOKEN_IF) {
+        if (parser->current_token->type == TOKEN_IF) {
             return parser_parse_if(parser);
         }
 
-        if (parser->current_token.type == TOKEN_LOOP) {
+        if (parser->current_token->type == TOKEN_LOOP) {
             return parser_parse_loop(parser);
         }
 
-        if (parser->current_token.type == TOKEN_BREAK) {
+        // #unroll N antes de un loop: el factor queda en el valor del nodo
+        if (parser->current_token->type == TOKEN_UNROLL) {
+            int line = parser->current_token->line;
+            parser_advance(parser);
+            char factor[256];
+            strcpy(factor, parser_text(parser));
+            parser_expect(parser, TOKEN_NUMBER);
+            if (strchr(factor, '.') || atoi(factor) < 1) {
+                error("#unroll needs a factor of at least 1 at line %d", line);
+            }
+            parser_skip_newlines(parser);
+            if (parser->current_token->type != TOKEN_LOOP) {
+                error("#unroll must be followed by a loop at line %d", line);
+            }
+            ASTNode *loop = parser_parse_loop(parser);
+            strcpy(loop->value, factor);
+            return loop;
+        }
+
+        if (parser->current_token->type == TOKEN_PARALLEL) {
+            return parser_parse_parallel_loop(parser);
+        }
+
+        if (parser->current_token->type == TOKEN_SWITCH) {
+            return parser_parse_switch(parser);
+        }
+
+        if (parser->current_token->type == TOKEN_BREAK) {
             ASTNode *node = ast_create_node(AST_BREAK, "break");
             parser_advance(parser);
             return node;
         }
 
-        if (parser->current_token.type == TOKEN_CONTINUE) {
+        if (parser->current_token->type == TOKEN_CONTINUE) {
             ASTNode *node = ast_create_node(AST_CONTINUE, "continue");
             parser_advance(parser);
             return node;
         }
 
-        if (parser->current_token.type == TOKEN_IDENTIFIER) {
-            if (parser->peek_token.type == TOKEN_INCREMENT) {
+        if (parser->current_token->type == TOKEN_IDENTIFIER) {
+            if (parser->peek_token->type == TOKEN_INCREMENT) {
                 char name[256];
-                strcpy(name, parser->current_token.value);
+                strcpy(name, parser_text(parser));
                 parser_advance(parser);
                 parser_advance(parser);
 
@@ -402,9 +578,9 @@ ASTNode* parser_parse_statement(Parser *parser) {
                 return node;
             }
 
-            if (parser->peek_token.type == TOKEN_DECREMENT) {
+            if (parser->peek_token->type == TOKEN_DECREMENT) {
                 char name[256];
-                strcpy(name, parser->current_token.value);
+                strcpy(name, parser_text(parser));
                 parser_advance(parser);
                 parser_advance(parser);
 
@@ -412,8 +588,8 @@ ASTNode* parser_parse_statement(Parser *parser) {
                 return node;
             }
 
-            if (parser->peek_token.type == TOKEN_ASSIGN ||
-                parser->peek_token.type == TOKEN_LBRACKET) {
+            if (parser->peek_token->type == TOKEN_ASSIGN ||
+                parser->peek_token->type == TOKEN_LBRACKET) {
                 return parser_parse_assignment(parser);
                 } else {
                     return parser_parse_expression(parser);
@@ -423,41 +599,53 @@ ASTNode* parser_parse_statement(Parser *parser) {
         return parser_parse_expression(parser);
 }
 
+// La linea de una sentencia es la de su primer token, aunque el nodo se
+// cree al final (declaraciones, asignaciones)
+ASTNode* parser_parse_statement(Parser *parser) {
+    parser_skip_newlines(parser);
+    int line = parser->current_token->line;
+    ASTNode *node = parser_parse_statement_body(parser);
+    if (node) node->line = line;
+    return node;
+}
+
 ASTNode* parser_parse_import(Parser *parser) {
     parser_expect(parser, TOKEN_IMPORT);
 
-    if (parser->current_token.type != TOKEN_STRING_LITERAL) {
+    if (parser->current_token->type != TOKEN_STRING_LITERAL) {
         error("Expected string literal after import\n");
         return NULL;
     }
 
-    ASTNode *node = ast_create_node(AST_IMPORT, parser->current_token.value);
+    ASTNode *node = ast_create_node(AST_IMPORT, parser_text(parser));
     parser_advance(parser);
 
     return node;
 }
 
 ASTNode* parser_parse_function(Parser *parser) {
+    int line = parser->current_token->line;
     parser_expect(parser, TOKEN_FUNC);
 
     char name[256];
-    strcpy(name, parser->current_token.value);
+    strcpy(name, parser_text(parser));
     parser_expect(parser, TOKEN_IDENTIFIER);
 
     ASTNode *node = ast_create_node(AST_FUNCTION, name);
+    node->line = line;
 
     parser_expect(parser, TOKEN_LPAREN);
 
     ASTNode *params = ast_create_node(AST_BLOCK, "params");
-    while (parser->current_token.type != TOKEN_RPAREN) {
-        if (parser->current_token.type == TOKEN_INT ||
-            parser->current_token.type == TOKEN_FLOAT ||
-            parser->current_token.type == TOKEN_BOOL ||
-            parser->current_token.type == TOKEN_STRING) {
+    while (parser->current_token->type != TOKEN_RPAREN) {
+        if (parser->current_token->type == TOKEN_INT ||
+            parser->current_token->type == TOKEN_FLOAT ||
+            parser->current_token->type == TOKEN_BOOL ||
+            parser->current_token->type == TOKEN_STRING) {
             ast_add_child(params, parser_parse_var_decl(parser));
             }
 
-            if (parser->current_token.type == TOKEN_COMMA) {
+            if (parser->current_token->type == TOKEN_COMMA) {
                 parser_advance(parser);
             }
     }
@@ -470,9 +658,9 @@ ASTNode* parser_parse_function(Parser *parser) {
     parser_skip_newlines(parser);
 
     ASTNode *body = ast_create_node(AST_BLOCK, "body");
-    while (parser->current_token.type != TOKEN_RBRACE) {
+    while (parser->current_token->type != TOKEN_RBRACE) {
         parser_skip_newlines(parser);
-        if (parser->current_token.type == TOKEN_RBRACE) break;
+        if (parser->current_token->type == TOKEN_RBRACE) break;
         ast_add_child(body, parser_parse_statement(parser));
         parser_skip_newlines(parser);
     }
@@ -488,13 +676,20 @@ ASTNode* parser_parse_program(Parser *parser) {
 
     parser_skip_newlines(parser);
 
-    while (parser->current_token.type != TOKEN_EOF) {
-        if (parser->current_token.type == TOKEN_IMPORT) {
+    while (parser->current_token->type != TOKEN_EOF) {
+        if (parser->current_token->type == TOKEN_IMPORT) {
             ast_add_child(program, parser_parse_import(parser));
         }
-        else if (parser->current_token.type == TOKEN_FUNC) {
+        else if (parser->current_token->type == TOKEN_FUNC) {
             ast_add_child(program, parser_parse_function(parser));
         }
+        else if (parser->current_token->type == TOKEN_CONST) {
+            // const func: pura, se evalua al compilar si los argumentos son constantes
+            parser_advance(parser);
+            ASTNode *function = parser_parse_function(parser);
+            function->left = ast_create_node(AST_IDENTIFIER, "const");
+            ast_add_child(program, function);
+        }
         parser_skip_newlines(parser);
     }
 
@@ -0,0 +1,178 @@
+// ==================== PGO ====================
+// --profile-generate numera los contadores de cada funcion: el 0 cuenta
+// entradas, cada if dos (veces que se evalua, veces que va al then), cada
+// loop dos (veces que se entra, iteraciones) y cada llamada a una funcion
+// del programa uno. pgo_dump (runtime) añade al salir una linea por
+// contador al fichero de perfil:
+//
+//   <funcion> <checksum> <contador> <valor>
+//
+// --profile-use suma las lineas de todas las ejecuciones y deja las cuentas
+// en node->count (el else de un if y el bloque de un loop incluidos). El
+// checksum resume la forma de la funcion: si no coincide el perfil es de
+// otra version del fuente y se ignora.
+//
+// Se numera sobre el fuente recien leido, antes de la evaluacion en
+// compilacion: lo que esta pliega depende de -O, y asi un perfil generado
+// sin -O sirve para compilar con -O. Los nodos que se crean despues (el
+// bucle que rellena una tabla) no tienen contador.
+
+#define PGO_DEFAULT_PATH "b.profdata"
+
+unsigned int pgo_mix(unsigned int hash, int value) {
+    return (hash ^ (unsigned int)value) * 16777619u;
+}
+
+// Numera en preorden a partir de next
+int pgo_walk(ASTNode *node, int next, unsigned int *checksum) {
+    if (!node) return next;
+    switch (node->type) {
+        case AST_IF:
+        case AST_LOOP:
+            node->site = next;
+            *checksum = pgo_mix(*checksum, node->type);
+            next += 2;
+            break;
+        case AST_CALL:
+            if (codegen_is_builtin(node->value)) break;
+            node->site = next;
+            *checksum = pgo_mix(*checksum, node->type);
+            next++;
+            break;
+        default:
+            break;
+    }
+    next = pgo_walk(node->left, next, checksum);
+    next = pgo_walk(node->right, next, checksum);
+    for (int i = 0; i < node->child_count; i++) {
+        next = pgo_walk(node->children[i], next, checksum);
+    }
+    return next;
+}
+
+// Deja en cada funcion el numero de contadores y el checksum
+void pgo_number(ASTNode *program) {
+    for (int i = 0; i < program->child_count; i++) {
+        ASTNode *function = program->children[i];
+        if (function->type != AST_FUNCTION) continue;
+        unsigned int checksum = 2166136261u;
+        function->site = pgo_walk(function->children[1], 1, &checksum);
+        function->checksum = pgo_mix(checksum, function->site);
+    }
+}
+
+// Anota las cuentas en los nodos numerados que siguen en el AST
+void pgo_annotate(ASTNode *node, const long long *counts) {
+    if (!node) return;
+    if (node->site >= 0) {
+        switch (node->type) {
+            case AST_IF:
+                node->count = counts[node->site];
+                node->children[0]->count = counts[node->site + 1];
+                if (node->child_count > 1) node->children[1]->count = counts[node->site] - counts[node->site + 1];
+                break;
+            case AST_LOOP:
+                node->count = counts[node->site];
+                node->right->count = counts[node->site + 1];
+                break;
+            case AST_CALL:
+                node->count = counts[node->site];
+                break;
+            default:
+                break;
+        }
+    }
+    pgo_annotate(node->left, counts);
+    pgo_annotate(node->right, counts);
+    for (int i = 0; i < node->child_count; i++) pgo_annotate(node->children[i], counts);
+}
+
+typedef struct {
+    unsigned int checksum;
+    long long *counts;
+    int size;
+} PgoEntry;
+
+typedef struct {
+    StringPool *names;
+    PgoEntry *entries;
+} PgoProfile;
+
+typedef struct {
+    int functions;      // funciones con cuentas aplicadas
+    int stale;          // con perfil de otra version, ignoradas
+} PgoReport;
+
+PgoProfile* pgo_load(const char *path) {
+    FILE *file = fopen(path, "r");
+    if (!file) return NULL;
+    PgoProfile *profile = (PgoProfile*)calloc(1, sizeof(PgoProfile));
+    profile->names = string_pool_create();
+    char name[256];
+    unsigned int checksum;
+    int counter;
+    long long value;
+    while (fscanf(file, "%255s %x %d %lld", name, &checksum, &counter, &value) == 4) {
+        if (counter < 0) continue;
+        int index = string_pool_find(profile->names, name);
+        if (index < 0) {
+            index = string_pool_intern(profile->names, name);
+            profile->entries = (PgoEntry*)realloc(profile->entries, profile->names->count * sizeof(PgoEntry));
+            memset(&profile->entries[index], 0, sizeof(PgoEntry));
+            profile->entries[index].checksum = checksum;
+        }
+        PgoEntry *entry = &profile->entries[index];
+        // Las ejecuciones se añaden en orden: una version nueva sustituye
+        if (entry->checksum != checksum) {
+            entry->checksum = checksum;
+            entry->size = 0;
+        }
+        if (counter >= entry->size) {
+            int size = counter + 1;
+            entry->counts = (long long*)realloc(entry->counts, size * sizeof(long long));
+            memset(entry->counts + entry->size, 0, (size - entry->size) * sizeof(long long));
+            entry->size = size;
+        }
+        entry->counts[counter] += value;
+    }
+    fclose(file);
+    return profile;
+}
+
+void pgo_free(PgoProfile *profile) {
+    for (int i = 0; i < profile->names->count; i++) free(profile->entries[i].counts);
+    free(profile->entries);
+    string_pool_free(profile->names);
+    free(profile);
+}
+
+// Anota las funciones de todos los modulos; digests[m] resume las cuentas
+// aplicadas al modulo m, que entran en la clave de su objeto en la cache
+void pgo_apply(ASTNode **programs, int count, PgoProfile *profile,
+               unsigned long long *digests, PgoReport *report) {
+    memset(report, 0, sizeof(PgoReport));
+    for (int m = 0; m < count; m++) {
+        unsigned long long digest = 14695981039346656037ull;
+        for (int i = 0; i < programs[m]->child_count; i++) {
+            ASTNode *function = programs[m]->children[i];
+            if (function->type != AST_FUNCTION) continue;
+            int index = string_pool_find(profile->names, function->value);
+            if (index < 0) continue;
+            PgoEntry *entry = &profile->entries[index];
+            int counters = function->site;
+            if (function->checksum != entry->checksum || counters != entry->size) {
+                warning("%s:%d: profile for %s() does not match the source, ignored",
+                        function->file ? function->file : "?", function->line, function->value);
+                report->stale++;
+                continue;
+            }
+            function->count = entry->counts[0];
+            pgo_annotate(function->children[1], entry->counts);
+            for (int c = 0; c < counters; c++) {
+                digest = (digest ^ (unsigned long long)entry->counts[c]) * 1099511628211ull;
+            }
+            report->functions++;
+        }
+        digests[m] = digest;
+    }
+}
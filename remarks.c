@@ -0,0 +1,148 @@
+// ==================== REMARKS ====================
+// --remarks cuenta que ha hecho el optimizador con cada linea del fuente y,
+// cuando no ha podido, por que: llamadas evaluadas en compilacion o
+// especializadas, bucles desenrollados, variables en registros o en la
+// pila, stores eliminados y cargas reutilizadas. Cada pase llama a remark()
+// (desde varios hilos durante codegen); al final se ordenan por fichero y
+// linea. --remarks escribe texto en stdout, --remarks=json y
+// --remarks=yaml lo mismo en stderr.
+
+#define REMARKS_OFF 0
+#define REMARKS_TEXT 1
+#define REMARKS_JSON 2
+#define REMARKS_YAML 3
+
+typedef enum {
+    REMARK_PASSED,      // optimizacion hecha
+    REMARK_MISSED,      // no hecha, con el motivo
+    REMARK_ANALYSIS     // informacion (donde vive una variable)
+} RemarkKind;
+
+typedef struct {
+    RemarkKind kind;
+    char pass[16];
+    const char *file;
+    int line;
+    char function[64];
+    char message[256];
+    int order;
+    int repeat;         // remarks iguales juntadas (copias de un bucle)
+} Remark;
+
+int remarks_mode = REMARKS_OFF;
+Remark *remarks;
+int remark_count;
+pthread_mutex_t remarks_lock = PTHREAD_MUTEX_INITIALIZER;
+
+const char *remark_kinds[] = {"passed", "missed", "analysis"};
+
+void remark(RemarkKind kind, const char *pass, const char *file, int line,
+            const char *function, const char *format, ...) {
+    if (remarks_mode == REMARKS_OFF) return;
+    Remark entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.kind = kind;
+    snprintf(entry.pass, sizeof(entry.pass), "%s", pass);
+    entry.file = file;
+    entry.line = line;
+    if (function) snprintf(entry.function, sizeof(entry.function), "%s", function);
+    va_list args;
+    va_start(args, format);
+    vsnprintf(entry.message, sizeof(entry.message), format, args);
+    va_end(args);
+    entry.repeat = 1;
+
+    pthread_mutex_lock(&remarks_lock);
+    entry.order = remark_count;
+    remarks = (Remark*)realloc(remarks, (remark_count + 1) * sizeof(Remark));
+    remarks[remark_count++] = entry;
+    pthread_mutex_unlock(&remarks_lock);
+}
+
+int remark_compare(const void *a, const void *b) {
+    const Remark *x = (const Remark*)a;
+    const Remark *y = (const Remark*)b;
+    int files = strcmp(x->file ? x->file : "", y->file ? y->file : "");
+    if (files != 0) return files;
+    if (x->line != y->line) return x->line - y->line;
+    return x->order - y->order;
+}
+
+int remark_same(Remark *a, Remark *b) {
+    return a->kind == b->kind && a->line == b->line && strcmp(a->pass, b->pass) == 0 &&
+           strcmp(a->function, b->function) == 0 && strcmp(a->message, b->message) == 0 &&
+           strcmp(a->file ? a->file : "", b->file ? b->file : "") == 0;
+}
+
+// Ordena y junta las repetidas
+void remarks_sort() {
+    qsort(remarks, remark_count, sizeof(Remark), remark_compare);
+    int kept = 0;
+    for (int i = 0; i < remark_count; i++) {
+        int same = -1;
+        for (int k = kept - 1; k >= 0 && remarks[k].line == remarks[i].line; k--) {
+            if (remark_same(&remarks[k], &remarks[i])) {
+                same = k;
+                break;
+            }
+        }
+        if (same >= 0) remarks[same].repeat++;
+        else remarks[kept++] = remarks[i];
+    }
+    remark_count = kept;
+}
+
+void remarks_print_text() {
+    const char *colors[] = {COLOR_GREEN, COLOR_YELLOW, COLOR_CYAN};
+    printf("\n%sOptimization remarks:%s\n", COLOR_YELLOW, COLOR_RESET);
+    if (remark_count == 0) printf("  none (most passes only run with -O)\n");
+    for (int i = 0; i < remark_count; i++) {
+        Remark *r = &remarks[i];
+        printf("%s:%d: %s%s%s [%s] ", r->file ? r->file : "?", r->line,
+               colors[r->kind], remark_kinds[r->kind], COLOR_RESET, r->pass);
+        if (r->function[0]) printf("%s(): ", r->function);
+        printf("%s", r->message);
+        if (r->repeat > 1) printf(" (x%d)", r->repeat);
+        printf("\n");
+    }
+}
+
+void remarks_print_json() {
+    fprintf(stderr, "{\"remarks\": [\n");
+    for (int i = 0; i < remark_count; i++) {
+        Remark *r = &remarks[i];
+        fprintf(stderr, "  {\"kind\": \"%s\", \"pass\": \"%s\", \"file\": ", remark_kinds[r->kind], r->pass);
+        report_print_json_string(stderr, r->file ? r->file : "?");
+        fprintf(stderr, ", \"line\": %d, \"function\": ", r->line);
+        if (r->function[0]) report_print_json_string(stderr, r->function);
+        else fprintf(stderr, "null");
+        fprintf(stderr, ", \"message\": ");
+        report_print_json_string(stderr, r->message);
+        fprintf(stderr, ", \"count\": %d}%s\n", r->repeat, i + 1 < remark_count ? "," : "");
+    }
+    fprintf(stderr, "]}\n");
+}
+
+// Un documento por remark, como los de -fsave-optimization-record de clang
+void remarks_print_yaml() {
+    const char *tags[] = {"Passed", "Missed", "Analysis"};
+    for (int i = 0; i < remark_count; i++) {
+        Remark *r = &remarks[i];
+        fprintf(stderr, "--- !%s\nPass: %s\n", tags[r->kind], r->pass);
+        fprintf(stderr, "File: ");
+        report_print_json_string(stderr, r->file ? r->file : "?");
+        fprintf(stderr, "\nLine: %d\n", r->line);
+        if (r->function[0]) fprintf(stderr, "Function: %s\n", r->function);
+        fprintf(stderr, "Message: ");
+        report_print_json_string(stderr, r->message);
+        fprintf(stderr, "\nCount: %d\n...\n", r->repeat);
+    }
+}
+
+void remarks_print() {
+    if (remarks_mode == REMARKS_OFF) return;
+    remarks_sort();
+    if (remarks_mode == REMARKS_TEXT) remarks_print_text();
+    if (remarks_mode == REMARKS_JSON) remarks_print_json();
+    if (remarks_mode == REMARKS_YAML) remarks_print_yaml();
+}
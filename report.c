@@ -0,0 +1,186 @@
+// ==================== TIME REPORT ====================
+// --time-report mide cada fase del compilador (y cada modulo importado):
+// tiempo real, tiempo de CPU, pico de RSS, numero de reservas de memoria,
+// tokens, nodos del AST e instrucciones emitidas. --time-report=json
+// escribe lo mismo en stderr como JSON.
+
+#include <time.h>
+#include <sys/resource.h>
+
+long alloc_count;
+__thread long thread_alloc_count;
+
+void* report_malloc(size_t size) {
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+    thread_alloc_count++;
+    return malloc(size);
+}
+
+void* report_calloc(size_t count, size_t size) {
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+    thread_alloc_count++;
+    return calloc(count, size);
+}
+
+void* report_realloc(void *ptr, size_t size) {
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+    thread_alloc_count++;
+    return realloc(ptr, size);
+}
+
+char* report_strdup(const char *value) {
+    __atomic_fetch_add(&alloc_count, 1, __ATOMIC_RELAXED);
+    thread_alloc_count++;
+    return strdup(value);
+}
+
+// El resto del compilador se incluye despues: sus reservas pasan por aqui
+#define malloc(size) report_malloc(size)
+#define calloc(count, size) report_calloc(count, size)
+#define realloc(ptr, size) report_realloc(ptr, size)
+#define strdup(value) report_strdup(value)
+
+#define REPORT_OFF 0
+#define REPORT_TEXT 1
+#define REPORT_JSON 2
+
+typedef struct {
+    char phase[32];
+    char module[PATH_MAX];
+    double wall_ms;
+    double cpu_ms;
+    long peak_rss_kb;
+    long allocs;
+    long tokens;
+    long nodes;
+    long instructions;
+} PhaseReport;
+
+typedef struct {
+    double wall;
+    double cpu;
+    long allocs;
+    int thread;
+} PhaseMark;
+
+int report_mode = REPORT_OFF;
+PhaseReport *report_phases;
+int report_count;
+
+double report_clock(clockid_t clock) {
+    struct timespec ts;
+    clock_gettime(clock, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+// CPU del proceso mas la de los hijos ya esperados (nasm, ld)
+double report_process_cpu() {
+    struct rusage usage;
+    getrusage(RUSAGE_CHILDREN, &usage);
+    return report_clock(CLOCK_PROCESS_CPUTIME_ID) +
+           usage.ru_utime.tv_sec * 1000.0 + usage.ru_utime.tv_usec / 1000.0 +
+           usage.ru_stime.tv_sec * 1000.0 + usage.ru_stime.tv_usec / 1000.0;
+}
+
+long report_peak_rss() {
+    struct rusage self, children;
+    getrusage(RUSAGE_SELF, &self);
+    getrusage(RUSAGE_CHILDREN, &children);
+    return self.ru_maxrss > children.ru_maxrss ? self.ru_maxrss : children.ru_maxrss;
+}
+
+// thread = 1 mide solo el hilo actual (parseo de un modulo en un worker)
+void report_start(PhaseMark *mark, int thread) {
+    mark->thread = thread;
+    mark->wall = report_clock(CLOCK_MONOTONIC);
+    mark->cpu = thread ? report_clock(CLOCK_THREAD_CPUTIME_ID) : report_process_cpu();
+    mark->allocs = thread ? thread_alloc_count : alloc_count;
+}
+
+void report_stop(PhaseMark *mark, PhaseReport *phase) {
+    phase->wall_ms = report_clock(CLOCK_MONOTONIC) - mark->wall;
+    phase->cpu_ms = (mark->thread ? report_clock(CLOCK_THREAD_CPUTIME_ID) : report_process_cpu()) - mark->cpu;
+    phase->allocs = (mark->thread ? thread_alloc_count : alloc_count) - mark->allocs;
+    phase->peak_rss_kb = report_peak_rss();
+}
+
+// Registra una fase; tokens, nodes e instructions valen -1 si no aplican
+PhaseReport* report_add(const char *phase, const char *module) {
+    report_phases = (PhaseReport*)realloc(report_phases, (report_count + 1) * sizeof(PhaseReport));
+    PhaseReport *entry = &report_phases[report_count++];
+    memset(entry, 0, sizeof(PhaseReport));
+    snprintf(entry->phase, sizeof(entry->phase), "%s", phase);
+    snprintf(entry->module, sizeof(entry->module), "%s", module);
+    entry->tokens = -1;
+    entry->nodes = -1;
+    entry->instructions = -1;
+    return entry;
+}
+
+void report_phase(PhaseMark *mark, const char *phase, const char *module,
+                  long tokens, long nodes, long instructions) {
+    if (report_mode == REPORT_OFF) return;
+    PhaseReport *entry = report_add(phase, module);
+    report_stop(mark, entry);
+    entry->tokens = tokens;
+    entry->nodes = nodes;
+    entry->instructions = instructions;
+}
+
+void report_print_count(FILE *out, long value) {
+    if (value < 0) fprintf(out, " %10s", "-");
+    else fprintf(out, " %10ld", value);
+}
+
+void report_print_text() {
+    printf("\n%sTime report:%s\n", COLOR_YELLOW, COLOR_RESET);
+    printf("  %-10s %10s %10s %10s %10s %10s %10s %10s  %s\n", "phase", "wall ms",
+           "cpu ms", "rss KiB", "allocs", "tokens", "nodes", "instrs", "module");
+    for (int i = 0; i < report_count; i++) {
+        PhaseReport *p = &report_phases[i];
+        printf("  %-10s %10.3f %10.3f %10ld %10ld", p->phase, p->wall_ms, p->cpu_ms,
+               p->peak_rss_kb, p->allocs);
+        report_print_count(stdout, p->tokens);
+        report_print_count(stdout, p->nodes);
+        report_print_count(stdout, p->instructions);
+        printf("  %s\n", p->module);
+    }
+}
+
+void report_print_json_string(FILE *out, const char *value) {
+    fputc('"', out);
+    for (; *value; value++) {
+        if (*value == '"' || *value == '\\') fputc('\\', out);
+        if ((unsigned char)*value < 0x20) fprintf(out, "\\u%04x", *value);
+        else fputc(*value, out);
+    }
+    fputc('"', out);
+}
+
+void report_print_json_count(FILE *out, const char *key, long value) {
+    if (value < 0) fprintf(out, ", \"%s\": null", key);
+    else fprintf(out, ", \"%s\": %ld", key, value);
+}
+
+void report_print_json() {
+    fprintf(stderr, "{\"phases\": [\n");
+    for (int i = 0; i < report_count; i++) {
+        PhaseReport *p = &report_phases[i];
+        fprintf(stderr, "  {\"phase\": ");
+        report_print_json_string(stderr, p->phase);
+        fprintf(stderr, ", \"module\": ");
+        report_print_json_string(stderr, p->module);
+        fprintf(stderr, ", \"wall_ms\": %.3f, \"cpu_ms\": %.3f, \"peak_rss_kb\": %ld, \"allocs\": %ld",
+                p->wall_ms, p->cpu_ms, p->peak_rss_kb, p->allocs);
+        report_print_json_count(stderr, "tokens", p->tokens);
+        report_print_json_count(stderr, "nodes", p->nodes);
+        report_print_json_count(stderr, "instructions", p->instructions);
+        fprintf(stderr, "}%s\n", i + 1 < report_count ? "," : "");
+    }
+    fprintf(stderr, "]}\n");
+}
+
+void report_print() {
+    if (report_mode == REPORT_TEXT) report_print_text();
+    if (report_mode == REPORT_JSON) report_print_json();
+}
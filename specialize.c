@@ -0,0 +1,325 @@
+// ==================== SPECIALIZATION ====================
+// Con -O, las llamadas a funciones del programa con algun argumento
+// numerico constante (format(x, 16)) pasan a llamar a una copia de la
+// funcion para esos valores, format.spec.1(x), sin esos parametros: en la copia
+// el parametro se sustituye por el numero (o, si la funcion lo modifica,
+// se declara como variable local con ese valor) y el resto del pipeline lo
+// pliega como cualquier otra constante. Las llamadas que quedan con todos
+// los argumentos constantes las ha resuelto antes la evaluacion en
+// compilacion, si la funcion es pura.
+//
+// Cada combinacion distinta (funcion, posiciones y valores constantes) da
+// una copia, dentro de un presupuesto: por funcion, por tamaño y en total.
+// Con --profile-use se reparten primero a las llamadas mas ejecutadas y no
+// se especializan las que no se ejecutan. Se repite sobre las copias: una
+// llamada recursiva con el mismo argumento constante va a la misma copia.
+
+#define SPEC_MAX_NODES 400      // funciones mas grandes no se copian
+#define SPEC_MAX_CLONES 4       // copias por funcion
+#define SPEC_BUDGET 4000        // nodos nuevos en todo el programa
+#define SPEC_ROUNDS 4
+
+typedef struct {
+    int clones;             // copias creadas
+    int calls;              // llamadas que van a una copia
+} SpecReport;
+
+typedef struct {
+    ASTNode *call;
+    int module;
+    int group;
+    const char *function;   // funcion que hace la llamada
+} SpecSite;
+
+typedef struct {
+    int callee;
+    long long weight;       // llamadas segun el perfil (o sitios sin el)
+    int first;              // orden de aparicion, para desempatar
+    const char *missed;     // por que no tiene copia
+} SpecGroup;
+
+typedef struct {
+    StringPool *names;
+    ASTNode **functions;
+    int *modules;           // modulo de cada funcion (-1 si esta repetida)
+    int *clones;            // copias hechas de cada funcion
+    StringPool *keys;       // firma -> copia ya hecha
+    char **clone_names;
+    ASTNode **programs;
+    unsigned long long *digests;
+    int budget;
+    int counter;
+    SpecSite *sites;
+    int site_count;
+    SpecGroup *groups;
+    int group_count;
+} Specializer;
+
+int spec_constant(ASTNode *node) {
+    long long value;
+    return unroll_number(node, &value);
+}
+
+void spec_digest(Specializer *sp, int module, const char *text) {
+    for (const char *c = text; *c; c++) {
+        sp->digests[module] = (sp->digests[module] ^ (unsigned char)*c) * 1099511628211ull;
+    }
+}
+
+void spec_register(Specializer *sp, ASTNode *function, int module) {
+    int index = string_pool_find(sp->names, function->value);
+    if (index >= 0) {
+        // Definida dos veces: no se sabe cual se llama
+        sp->modules[index] = -1;
+        return;
+    }
+    index = string_pool_intern(sp->names, function->value);
+    sp->functions = (ASTNode**)realloc(sp->functions, sp->names->count * sizeof(ASTNode*));
+    sp->modules = (int*)realloc(sp->modules, sp->names->count * sizeof(int));
+    sp->clones = (int*)realloc(sp->clones, sp->names->count * sizeof(int));
+    sp->functions[index] = function;
+    sp->modules[index] = module;
+    sp->clones[index] = 0;
+}
+
+// Firma de la llamada: "f(,16,)" con las posiciones constantes; 0 si no
+// hay ninguna que se pueda especializar
+int spec_key(Specializer *sp, ASTNode *call, int callee, char *key, size_t size) {
+    ASTNode *params = sp->functions[callee]->children[0];
+    if (params->child_count != call->child_count) return 0;
+    int constants = 0;
+    int length = snprintf(key, size, "%s(", call->value);
+    for (int i = 0; i < call->child_count; i++) {
+        ASTNode *arg = call->children[i];
+        if (spec_constant(arg) && strcmp(params->children[i]->left->value, "string") != 0) {
+            long long value;
+            unroll_number(arg, &value);
+            length += snprintf(key + length, size - length, "%lld", value);
+            constants++;
+        }
+        length += snprintf(key + length, size - length, i + 1 < call->child_count ? "," : ")");
+        if (length >= (int)size - 1) return 0;
+    }
+    return constants;
+}
+
+void spec_collect(Specializer *sp, ASTNode *node, int module, const char *function) {
+    if (!node) return;
+    if (node->type == AST_CALL && !codegen_is_builtin(node->value)) {
+        int callee = string_pool_find(sp->names, node->value);
+        char key[512];
+        int candidate = callee >= 0 && sp->modules[callee] >= 0 && strcmp(node->value, "main") != 0 &&
+                        spec_key(sp, node, callee, key, sizeof(key));
+        if (candidate && node->count == 0) {
+            remark(REMARK_MISSED, "specialize", node->file, node->line, function,
+                   "call to %s() not specialized: the profile shows it never runs", node->value);
+        } else if (candidate) {
+            int group = string_pool_intern(sp->keys, key);
+            if (group >= sp->group_count) {
+                sp->groups = (SpecGroup*)realloc(sp->groups, (group + 1) * sizeof(SpecGroup));
+                sp->clone_names = (char**)realloc(sp->clone_names, (group + 1) * sizeof(char*));
+                sp->clone_names[group] = NULL;
+                sp->groups[group].callee = callee;
+                sp->groups[group].weight = 0;
+                sp->groups[group].first = group;
+                sp->groups[group].missed = NULL;
+                sp->group_count = group + 1;
+            }
+            sp->groups[group].weight += node->count > 0 ? node->count : 1;
+            sp->sites = (SpecSite*)realloc(sp->sites, (sp->site_count + 1) * sizeof(SpecSite));
+            sp->sites[sp->site_count].call = node;
+            sp->sites[sp->site_count].module = module;
+            sp->sites[sp->site_count].group = group;
+            sp->sites[sp->site_count].function = function;
+            sp->site_count++;
+        }
+    }
+    spec_collect(sp, node->left, module, function);
+    spec_collect(sp, node->right, module, function);
+    for (int i = 0; i < node->child_count; i++) {
+        spec_collect(sp, node->children[i], module, function);
+    }
+}
+
+// Sustituye las lecturas de name por value (name no se modifica)
+void spec_substitute(ASTNode *node, const char *name, ASTNode *value) {
+    if (!node) return;
+    if (node->type == AST_IDENTIFIER && strcmp(node->value, name) == 0) {
+        ASTNode *copy = ast_clone(value);
+        copy->line = node->line;
+        copy->file = node->file;
+        *node = *copy;
+        free(copy);
+        return;
+    }
+    // El left de las declaraciones es el tipo, no una lectura
+    if (node->type == AST_ARRAY_DECL) return;
+    if (node->type != AST_VAR_DECL) spec_substitute(node->left, name, value);
+    spec_substitute(node->right, name, value);
+    for (int i = 0; i < node->child_count; i++) {
+        spec_substitute(node->children[i], name, value);
+    }
+}
+
+// Copia la funcion para los argumentos constantes de call
+ASTNode* spec_clone(Specializer *sp, int callee, ASTNode *call) {
+    ASTNode *function = sp->functions[callee];
+    ASTNode *clone = ast_clone(function);
+    // No f.N: prof.f.N es la etiqueta del bucle N de f con --profile
+    snprintf(clone->value, sizeof(clone->value), "%.200s.spec.%d", function->value, ++sp->counter);
+
+    ASTNode *params = clone->children[0];
+    ASTNode *body = clone->children[1];
+    int kept = 0;
+    for (int i = 0; i < params->child_count; i++) {
+        ASTNode *param = params->children[i];
+        ASTNode *arg = call->children[i];
+        if (!spec_constant(arg) || strcmp(param->left->value, "string") == 0) {
+            params->children[kept++] = param;
+            continue;
+        }
+        if (unroll_writes(body, param->value)) {
+            ast_line = body->line;
+            ast_file = body->file;
+            ASTNode *local = ast_create_node(AST_VAR_DECL, param->value);
+            local->left = param->left;
+            local->right = ast_clone(arg);
+            unroll_insert(body, 0, local);
+        } else {
+            spec_substitute(body, param->value, arg);
+        }
+    }
+    params->child_count = kept;
+    return clone;
+}
+
+// La llamada pasa a la copia y pierde los argumentos constantes
+void spec_redirect(Specializer *sp, SpecSite *site, const char *name) {
+    ASTNode *call = site->call;
+    ASTNode *params = sp->functions[sp->groups[site->group].callee]->children[0];
+    int kept = 0;
+    for (int i = 0; i < call->child_count; i++) {
+        ASTNode *arg = call->children[i];
+        if (spec_constant(arg) && strcmp(params->children[i]->left->value, "string") != 0) continue;
+        call->children[kept++] = arg;
+    }
+    call->child_count = kept;
+    strcpy(call->value, name);
+    spec_digest(sp, site->module, name);
+}
+
+int spec_compare_groups(const void *a, const void *b) {
+    const SpecGroup *x = (const SpecGroup*)a;
+    const SpecGroup *y = (const SpecGroup*)b;
+    if (x->weight != y->weight) return x->weight > y->weight ? -1 : 1;
+    return x->first - y->first;
+}
+
+// Una ronda sobre las llamadas de las funciones [start, end)
+void spec_round(Specializer *sp, int start, int end, SpecReport *report) {
+    sp->site_count = 0;
+    for (int f = start; f < end; f++) {
+        if (sp->modules[f] >= 0) {
+            spec_collect(sp, sp->functions[f]->children[1], sp->modules[f], sp->functions[f]->value);
+        }
+    }
+
+    // Por peso, sin perder el indice de cada grupo
+    int total = sp->group_count;
+    SpecGroup *order = (SpecGroup*)malloc((total ? total : 1) * sizeof(SpecGroup));
+    memcpy(order, sp->groups, total * sizeof(SpecGroup));
+    qsort(order, total, sizeof(SpecGroup), spec_compare_groups);
+
+    for (int g = 0; g < total; g++) {
+        int group = order[g].first;
+        if (sp->clone_names[group]) continue;
+        int callee = order[g].callee;
+        int size = ast_count_nodes(sp->functions[callee]);
+        if (sp->clones[callee] >= SPEC_MAX_CLONES) {
+            sp->groups[group].missed = "the function already has the maximum number of clones";
+            continue;
+        }
+        if (size > SPEC_MAX_NODES) {
+            sp->groups[group].missed = "the function is too large";
+            continue;
+        }
+        if (size > sp->budget) {
+            sp->groups[group].missed = "the code size budget is exhausted";
+            continue;
+        }
+
+        SpecSite *site = NULL;
+        for (int s = 0; s < sp->site_count && !site; s++) {
+            if (sp->sites[s].group == group) site = &sp->sites[s];
+        }
+        if (!site) continue;
+        int module = sp->modules[callee];
+        ASTNode *clone = spec_clone(sp, callee, site->call);
+        ast_add_child(sp->programs[module], clone);
+        sp->clone_names[group] = strdup(clone->value);
+        spec_digest(sp, module, sp->keys->values[group]);
+        spec_digest(sp, module, clone->value);
+        sp->clones[callee]++;
+        sp->budget -= size;
+        report->clones++;
+
+        // La copia tambien se puede especializar (y llamarse a si misma)
+        spec_register(sp, clone, module);
+        sp->clones[string_pool_find(sp->names, clone->value)] = SPEC_MAX_CLONES;
+    }
+    free(order);
+
+    for (int s = 0; s < sp->site_count; s++) {
+        SpecSite *site = &sp->sites[s];
+        ASTNode *call = site->call;
+        char *name = sp->clone_names[site->group];
+        if (!name) {
+            const char *missed = sp->groups[site->group].missed;
+            if (missed) {
+                remark(REMARK_MISSED, "specialize", call->file, call->line, site->function,
+                       "call to %s() not specialized: %s", call->value, missed);
+            }
+            continue;
+        }
+        remark(REMARK_PASSED, "specialize", call->file, call->line, site->function,
+               "call to %s() specialized as %s for %s", call->value, name, sp->keys->values[site->group]);
+        spec_redirect(sp, site, name);
+        report->calls++;
+    }
+}
+
+void spec_program(ASTNode **programs, int count, unsigned long long *digests, SpecReport *report) {
+    memset(report, 0, sizeof(SpecReport));
+    Specializer sp;
+    memset(&sp, 0, sizeof(sp));
+    sp.names = string_pool_create();
+    sp.keys = string_pool_create();
+    sp.programs = programs;
+    sp.digests = digests;
+    sp.budget = SPEC_BUDGET;
+    for (int m = 0; m < count; m++) {
+        digests[m] = 14695981039346656037ull;
+        for (int i = 0; i < programs[m]->child_count; i++) {
+            ASTNode *child = programs[m]->children[i];
+            if (child->type == AST_FUNCTION) spec_register(&sp, child, m);
+        }
+    }
+
+    // Cada ronda mira las copias que ha creado la anterior
+    int start = 0;
+    for (int round = 0; round < SPEC_ROUNDS && start < sp.names->count; round++) {
+        int end = sp.names->count;
+        spec_round(&sp, start, end, report);
+        start = end;
+    }
+
+    for (int i = 0; i < sp.group_count; i++) free(sp.clone_names[i]);
+    free(sp.clone_names);
+    free(sp.sites);
+    free(sp.groups);
+    free(sp.functions);
+    free(sp.modules);
+    free(sp.clones);
+    string_pool_free(sp.names);
+    string_pool_free(sp.keys);
+}
@@ -1,6 +1,12 @@
+const func sq(int x) {
+    return x * x
+}
+
 func main() {
+    int t[8] = sq
     int x = 10
     int y = 20
     int result = x + y
     print(result,"\n")
+    print(t[3],"\n")
 }
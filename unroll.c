@@ -0,0 +1,382 @@
+// ==================== UNROLL ====================
+// Desenrollado de bucles contados sobre el AST, antes de generar codigo:
+//
+//   loop i < E { cuerpo; i++ }
+//
+// con E un numero o una variable que el cuerpo no toca, i modificado solo
+// por el i++ (o i--, con > y >=) del final y sin break ni continue del
+// propio bucle. Si el valor inicial de i se conoce (i = c justo antes, en
+// el mismo bloque) y E es constante, el bucle desaparece: las iteraciones
+// se copian una tras otra. Si no, se desenrolla por un factor U con un
+// bucle de resto que hace las ultimas iteraciones:
+//
+//   loop i + (U-1) < E { cuerpo; i++; ... U veces }
+//   loop i < E { cuerpo; i++ }
+//
+// Con -O se desenrollan solos los bucles pequeños (el factor sale del
+// tamaño del cuerpo y, con --profile-use, se descartan los bucles que no se
+// ejecutan o dan pocas vueltas). #unroll N fija el factor de un bucle, con
+// o sin -O; #unroll 1 lo deja como esta. Las declaraciones del cuerpo se
+// duplican en cada copia, asi que tampoco se pasa de las CODEGEN_MAX_VARS
+// variables que admite el generador por funcion.
+
+#define UNROLL_MAX_TRIP 16      // vueltas de un bucle que se copia entero
+#define UNROLL_BUDGET 256       // nodos del cuerpo por el numero de copias
+#define UNROLL_MAX_DECLS 16     // declaraciones que se pueden duplicar
+#define UNROLL_SMALL_BODY 24    // hasta aqui x4, hasta el doble x2
+#define UNROLL_MAX_HINT 64
+
+typedef struct {
+    int full;               // bucles copiados enteros
+    int partial;            // desenrollados con bucle de resto
+    int ignored;            // #unroll que no se ha podido aplicar
+} UnrollReport;
+
+typedef struct {
+    const char *var;        // contador
+    int step;               // 1 (i++) o -1 (i--)
+    ASTNode *bound;
+    int nodes;              // tamaño del cuerpo
+    int decls;              // declaraciones del cuerpo
+    int loops;              // bucles anidados
+} UnrollLoop;
+
+typedef struct {
+    int optimize;
+    const char *function;
+    int room;               // variables que aun caben en la funcion
+    UnrollReport report;
+} Unroller;
+
+// node modifica la variable name (o declara otra con el mismo nombre)
+int unroll_writes(ASTNode *node, const char *name) {
+    if (!node) return 0;
+    switch (node->type) {
+        case AST_VAR_DECL:
+        case AST_ARRAY_DECL:
+        case AST_INCREMENT:
+        case AST_DECREMENT:
+        case AST_PARALLEL_LOOP:
+            if (strcmp(node->value, name) == 0) return 1;
+            break;
+        case AST_ASSIGNMENT:
+            if (!node->left && strcmp(node->value, name) == 0) return 1;
+            break;
+        case AST_REDUCE:
+            if (strcmp(node->left->value, name) == 0) return 1;
+            break;
+        default:
+            break;
+    }
+    if (unroll_writes(node->left, name) || unroll_writes(node->right, name)) return 1;
+    for (int i = 0; i < node->child_count; i++) {
+        if (unroll_writes(node->children[i], name)) return 1;
+    }
+    return 0;
+}
+
+// break/continue que salen del bucle que contiene a node (los de un switch
+// tambien: se refieren al loop)
+int unroll_escapes(ASTNode *node) {
+    if (!node) return 0;
+    if (node->type == AST_BREAK || node->type == AST_CONTINUE) return 1;
+    if (node->type == AST_LOOP || node->type == AST_PARALLEL_LOOP) return 0;
+    if (unroll_escapes(node->left) || unroll_escapes(node->right)) return 1;
+    for (int i = 0; i < node->child_count; i++) {
+        if (unroll_escapes(node->children[i])) return 1;
+    }
+    return 0;
+}
+
+int unroll_count(ASTNode *node, ASTNodeType type) {
+    if (!node) return 0;
+    int count = node->type == type;
+    count += unroll_count(node->left, type) + unroll_count(node->right, type);
+    for (int i = 0; i < node->child_count; i++) {
+        count += unroll_count(node->children[i], type);
+    }
+    return count;
+}
+
+// Variables que el generador reserva para node (ver codegen_push_var)
+int unroll_vars(ASTNode *node) {
+    if (!node) return 0;
+    int count = node->type == AST_VAR_DECL || node->type == AST_ARRAY_DECL;
+    if (node->type == AST_PARALLEL_LOOP) count += 2 + node->child_count;
+    count += unroll_vars(node->left) + unroll_vars(node->right);
+    for (int i = 0; i < node->child_count; i++) {
+        count += unroll_vars(node->children[i]);
+    }
+    return count;
+}
+
+int unroll_number(ASTNode *node, long long *value) {
+    if (node->type == AST_NUMBER) {
+        *value = strtoll(node->value, NULL, 10);
+        return 1;
+    }
+    if (node->type == AST_UNARY_OP && strcmp(node->value, "-") == 0 && node->left->type == AST_NUMBER) {
+        *value = -strtoll(node->left->value, NULL, 10);
+        return 1;
+    }
+    return 0;
+}
+
+// Paso de la sentencia sobre var: 1 (i++, i = i + 1), -1 (i--, i = i - 1) o 0
+int unroll_step(ASTNode *node, const char *var) {
+    if (node->type == AST_INCREMENT && strcmp(node->value, var) == 0) return 1;
+    if (node->type == AST_DECREMENT && strcmp(node->value, var) == 0) return -1;
+    if (node->type == AST_ASSIGNMENT && !node->left && strcmp(node->value, var) == 0) {
+        ASTNode *value = node->right;
+        if (value->type == AST_BINARY_OP && value->left->type == AST_IDENTIFIER &&
+            strcmp(value->left->value, var) == 0 && value->right->type == AST_NUMBER &&
+            strcmp(value->right->value, "1") == 0) {
+            if (strcmp(value->value, "+") == 0) return 1;
+            if (strcmp(value->value, "-") == 0) return -1;
+        }
+    }
+    return 0;
+}
+
+// Reconoce un bucle contado; si no lo es, deja el motivo en reason
+int unroll_counted(ASTNode *loop, UnrollLoop *info, const char **reason) {
+    ASTNode *cond = loop->left;
+    ASTNode *body = loop->right;
+    *reason = "the condition is not a comparison of a counter";
+    if (cond->type != AST_BINARY_OP || cond->left->type != AST_IDENTIFIER) return 0;
+    int up = strcmp(cond->value, "<") == 0 || strcmp(cond->value, "<=") == 0;
+    int down = strcmp(cond->value, ">") == 0 || strcmp(cond->value, ">=") == 0;
+    if (!up && !down) return 0;
+    info->var = cond->left->value;
+    info->bound = cond->right;
+
+    long long value;
+    *reason = "the bound may change inside the loop";
+    if (!unroll_number(info->bound, &value)) {
+        if (info->bound->type != AST_IDENTIFIER || strcmp(info->bound->value, info->var) == 0 ||
+            unroll_writes(body, info->bound->value)) return 0;
+    }
+
+    *reason = "the counter does not step by one at the end of the body";
+    if (body->child_count == 0) return 0;
+    info->step = unroll_step(body->children[body->child_count - 1], info->var);
+    if (info->step != (up ? 1 : -1)) return 0;
+    *reason = "the counter is modified inside the body";
+    for (int i = 0; i + 1 < body->child_count; i++) {
+        if (unroll_writes(body->children[i], info->var)) return 0;
+    }
+    *reason = "the body has break or continue";
+    for (int i = 0; i < body->child_count; i++) {
+        if (unroll_escapes(body->children[i])) return 0;
+    }
+    *reason = "the body has parallel loops or arrays";
+    if (unroll_count(body, AST_PARALLEL_LOOP) || unroll_count(body, AST_ARRAY_DECL)) return 0;
+
+    info->nodes = ast_count_nodes(body);
+    info->decls = unroll_count(body, AST_VAR_DECL);
+    info->loops = unroll_count(body, AST_LOOP);
+    return 1;
+}
+
+// Valor de var al entrar en el bucle block->children[index], si es constante
+int unroll_start(ASTNode *block, int index, const char *var, long long *start) {
+    for (int i = index - 1; i >= 0; i--) {
+        ASTNode *node = block->children[i];
+        if ((node->type == AST_VAR_DECL || (node->type == AST_ASSIGNMENT && !node->left)) &&
+            strcmp(node->value, var) == 0) {
+            return node->right && unroll_number(node->right, start);
+        }
+        if (unroll_writes(node, var)) return 0;
+    }
+    return 0;
+}
+
+// Vueltas del bucle desde start; -1 si son demasiadas para copiarlas
+long long unroll_trips(UnrollLoop *info, const char *op, long long start) {
+    long long bound;
+    if (!unroll_number(info->bound, &bound)) return -1;
+    if (start < -(1LL << 40) || start > (1LL << 40) || bound < -(1LL << 40) || bound > (1LL << 40)) return -1;
+    long long trips = info->step > 0 ? bound - start : start - bound;
+    if (strcmp(op, "<=") == 0 || strcmp(op, ">=") == 0) trips++;
+    return trips < 0 ? 0 : trips;
+}
+
+void unroll_insert(ASTNode *block, int index, ASTNode *node) {
+    ast_add_child(block, node);
+    memmove(&block->children[index + 1], &block->children[index],
+            (block->child_count - 1 - index) * sizeof(ASTNode*));
+    block->children[index] = node;
+}
+
+void unroll_remove(ASTNode *block, int index) {
+    memmove(&block->children[index], &block->children[index + 1],
+            (block->child_count - 1 - index) * sizeof(ASTNode*));
+    block->child_count--;
+}
+
+// Añade a target copies copias de las sentencias de body
+void unroll_copy(ASTNode *target, int index, ASTNode *body, int copies) {
+    for (int c = 0; c < copies; c++) {
+        for (int i = 0; i < body->child_count; i++) {
+            unroll_insert(target, index++, ast_clone(body->children[i]));
+        }
+    }
+}
+
+// Motivo por el que un bucle no se desenrolla: aviso si tenia #unroll
+void unroll_missed(Unroller *un, ASTNode *loop, int hint, const char *reason) {
+    if (hint) {
+        warning("%s:%d: #unroll ignored: %s", loop->file ? loop->file : "?", loop->line, reason);
+        un->report.ignored++;
+    }
+    remark(REMARK_MISSED, "unroll", loop->file, loop->line, un->function, "loop not unrolled: %s", reason);
+}
+
+// Intenta desenrollar block->children[index]; devuelve cuantas sentencias
+// ocupa despues
+int unroll_loop(Unroller *un, ASTNode *block, int index) {
+    ASTNode *loop = block->children[index];
+    int hint = strcmp(loop->value, "loop") == 0 ? 0 : atoi(loop->value);
+    if (hint == 1) {
+        remark(REMARK_MISSED, "unroll", loop->file, loop->line, un->function, "loop not unrolled: #unroll 1");
+        return 1;
+    }
+    if (!hint && !un->optimize) return 1;
+    strcpy(loop->value, "loop");
+    if (hint > UNROLL_MAX_HINT) hint = UNROLL_MAX_HINT;
+
+    UnrollLoop info;
+    const char *reason;
+    if (!unroll_counted(loop, &info, &reason)) {
+        unroll_missed(un, loop, hint, reason);
+        return 1;
+    }
+
+    // Entero: con las vueltas conocidas y pocas (o las que pide el #unroll)
+    int vars = unroll_vars(loop->right);
+    long long start;
+    if (unroll_start(block, index, info.var, &start)) {
+        long long trips = unroll_trips(&info, loop->left->value, start);
+        int fits = trips >= 0 && trips * info.decls <= UNROLL_MAX_DECLS &&
+                   (trips - 1) * vars <= un->room &&
+                   (hint ? trips <= hint
+                         : trips <= UNROLL_MAX_TRIP && trips * info.nodes <= UNROLL_BUDGET);
+        if (fits) {
+            ASTNode *body = loop->right;
+            un->room -= (int)(trips - 1) * vars;
+            unroll_remove(block, index);
+            unroll_copy(block, index, body, (int)trips);
+            un->report.full++;
+            remark(REMARK_PASSED, "unroll", loop->file, loop->line, un->function,
+                   "loop fully unrolled (%lld iteration%s)", trips, trips == 1 ? "" : "s");
+            return (int)trips * body->child_count;
+        }
+    }
+
+    int factor = hint;
+    if (!factor) {
+        // Solo los bucles internos, y no los que el perfil dice que no se
+        // ejecutan o dan pocas vueltas
+        if (info.loops > 0) {
+            unroll_missed(un, loop, 0, "only inner loops are unrolled without #unroll");
+            return 1;
+        }
+        if (loop->count == 0) {
+            unroll_missed(un, loop, 0, "the profile shows it never runs");
+            return 1;
+        }
+        factor = info.nodes <= UNROLL_SMALL_BODY ? 4 : info.nodes <= 2 * UNROLL_SMALL_BODY ? 2 : 1;
+        if (loop->count > 0 && loop->right->count >= 0 && loop->right->count < factor * loop->count) {
+            remark(REMARK_MISSED, "unroll", loop->file, loop->line, un->function,
+                   "loop not unrolled: the profile shows %lld iterations per entry",
+                   loop->right->count / loop->count);
+            return 1;
+        }
+        if (factor * info.nodes > UNROLL_BUDGET) factor = 1;
+        if (factor < 2) {
+            unroll_missed(un, loop, 0, "the body is too large");
+            return 1;
+        }
+    }
+    if (factor * info.decls > UNROLL_MAX_DECLS) {
+        unroll_missed(un, loop, hint, "the body declares too many variables");
+        return 1;
+    }
+    if (factor * vars > un->room) {
+        unroll_missed(un, loop, hint, "the function would have too many variables");
+        return 1;
+    }
+    un->room -= factor * vars;
+
+    ast_line = loop->line;
+    ast_file = loop->file;
+    char last[32];
+    snprintf(last, sizeof(last), "%d", factor - 1);
+    ASTNode *ahead = ast_create_node(AST_BINARY_OP, info.step > 0 ? "+" : "-");
+    ahead->left = ast_create_node(AST_IDENTIFIER, (char*)info.var);
+    ahead->right = ast_create_node(AST_NUMBER, last);
+
+    ASTNode *unrolled = ast_create_node(AST_LOOP, "loop");
+    unrolled->left = ast_create_node(AST_BINARY_OP, loop->left->value);
+    unrolled->left->left = ahead;
+    unrolled->left->right = ast_clone(info.bound);
+    unrolled->right = ast_create_node(AST_BLOCK, "body");
+    unroll_copy(unrolled->right, 0, loop->right, factor);
+    unrolled->count = loop->count;
+    if (loop->right->count >= 0) unrolled->right->count = loop->right->count / factor;
+
+    // El original queda como bucle de resto
+    unroll_insert(block, index, unrolled);
+    un->report.partial++;
+    remark(REMARK_PASSED, "unroll", loop->file, loop->line, un->function,
+           "loop unrolled by %d%s, with a remainder loop", factor, hint ? " (#unroll)" : "");
+    return 2;
+}
+
+void unroll_block(Unroller *un, ASTNode *block) {
+    for (int i = 0; i < block->child_count; ) {
+        ASTNode *node = block->children[i];
+        switch (node->type) {
+            case AST_IF:
+                for (int k = 0; k < node->child_count; k++) unroll_block(un, node->children[k]);
+                break;
+            case AST_SWITCH:
+                for (int k = 0; k < node->child_count; k++) unroll_block(un, node->children[k]->right);
+                break;
+            case AST_PARALLEL_LOOP:
+                unroll_block(un, node->right);
+                break;
+            case AST_LOOP:
+                // Primero los internos: si desaparecen, el externo puede caber
+                unroll_block(un, node->right);
+                i += unroll_loop(un, block, i);
+                continue;
+            default:
+                break;
+        }
+        i++;
+    }
+}
+
+void unroll_program(ASTNode *program, int optimize, UnrollReport *report) {
+    Unroller un;
+    un.optimize = optimize;
+    un.report = *report;
+    for (int i = 0; i < program->child_count; i++) {
+        ASTNode *child = program->children[i];
+        if (child->type != AST_FUNCTION) continue;
+        un.function = child->value;
+        un.room = CODEGEN_MAX_VARS - 1 - child->children[0]->child_count - unroll_vars(child->children[1]);
+        unroll_block(&un, child->children[1]);
+    }
+    *report = un.report;
+}
+
+// Sin el pase (--profile-generate) los #unroll se quitan sin aplicarlos
+void unroll_clear(ASTNode *node) {
+    if (!node) return;
+    if (node->type == AST_LOOP) strcpy(node->value, "loop");
+    unroll_clear(node->left);
+    unroll_clear(node->right);
+    for (int i = 0; i < node->child_count; i++) unroll_clear(node->children[i]);
+}